@@ -17,11 +17,77 @@
 #include "ctype.h"
 #include "time.h"
 #include "interpretor.h"
+#include "pins.h"
 #include "expressions.h"
+#include "verifier.h"
+#include "lexer.h"
 
 static file_info_t m_files_stack[100];
 static int m_files_stack_index = -1;
 
+/*
+ * Text of each file in m_parsed_files (freed once compiling is done).
+ */
+static char *m_source_texts[100];
+
+/*
+ * For loops (and their subscripts) whose bounds checks might be removed
+ * (see bounds_check_loop_begin).
+ */
+#define MAX_BOUNDS_CHECK_LOOPS		32
+#define MAX_BOUNDS_CHECK_SITES		256
+
+typedef struct tag_bounds_check_loop bounds_check_loop_t;
+
+struct tag_bounds_check_loop
+{
+	int counter_level;
+	int counter_address;
+	int array_level;
+	int array_address;
+
+	/*
+	 * TRUE once the body's bounds checks have been removed.
+	 */
+	BOOL removed;
+
+	/*
+	 * Index of the loop's first subscript in m_bounds_check_sites.
+	 */
+	int first_site;
+	int code_addresses_taken;
+};
+
+typedef struct tag_bounds_check_site bounds_check_site_t;
+
+struct tag_bounds_check_site
+{
+	/*
+	 * Address of the subscript's ACK instruction.
+	 */
+	int address;
+
+	/*
+	 * Index of the subscript's loop in m_bounds_check_loops.
+	 */
+	int loop;
+	int line;
+	char name[MAX_IDENT_LEN + 1];
+};
+
+static bounds_check_loop_t m_bounds_check_loops[MAX_BOUNDS_CHECK_LOOPS];
+static int m_bounds_check_loops_count = 0;
+static bounds_check_site_t m_bounds_check_sites[MAX_BOUNDS_CHECK_SITES];
+static int m_bounds_check_sites_count = 0;
+static int m_bounds_checks_kept = 0;
+static int m_bounds_checks_removed = 0;
+
+/*
+ * Counts the lambdas and labels compiled.  Code that has taken the address
+ * of one of these can't be moved.
+ */
+static int m_code_addresses_taken = 0;
+
 #ifndef WINDOWS
 char *_strdup(const char *s)
 {
@@ -117,18 +183,18 @@ void generate_call_sub(identinfo_t *ident_p, int level)
 
 void error_extra(int number, char *extra, BOOL show_code, BOOL last_line)
 {
-	char *line;
+	const char *line;
 	int i = 0, j = 0, len;
 	
 	m_number_of_errors++;
 
 	if (last_line)
 	{
-		line = m_last_line;
+		line = m_last_line_p;
 	}
 	else
 	{
-		line = m_line;
+		line = m_line_p;
 	}
 
 
@@ -137,11 +203,16 @@ void error_extra(int number, char *extra, BOOL show_code, BOOL last_line)
 		return;
 	}
 
-	len = strlen(line);
+	len = (int)strcspn(line, "\n");
+
+	if (line[len] == '\n')
+	{
+		len++;
+	}
 
 	for (i = i; i < len; i++)
 	{
-		if (m_line[i] != '\t')
+		if (line[i] != '\t')
 		{
 			printf("%c", line[i]);
 		}
@@ -316,8 +387,6 @@ var_function_t *var_function_clone(var_function_t *function_p)
 	int i;
 	var_function_t *function_p2 = var_function_new();
 
-	function_p2 = CALLOC(var_function_t, 1);
-
 	*function_p2 = *function_p;
 
 	function_p2->byref = function_p->byref;	
@@ -326,6 +395,18 @@ var_function_t *var_function_clone(var_function_t *function_p)
 	function_p2->return_var = ident_copy(function_p->return_var);	
 
 	function_p->default_p = function_p->default_p;
+
+	/*
+	 * The clone only needs room for the params it has.
+	 */
+	function_p2->params = NULL;
+	function_p2->params_size = 0;
+
+	if (function_p2->params_num > 0)
+	{
+		function_p2->params = MALLOC(identinfo_t, function_p2->params_num);
+		function_p2->params_size = function_p2->params_num;
+	}
 	
 	for (i = 0; i < function_p2->params_num; i++)
 	{
@@ -335,6 +416,44 @@ var_function_t *var_function_clone(var_function_t *function_p)
 	return function_p2;
 }
 
+/*
+ * Returns a function's param.  Params past the ones the function has (as
+ * with a call that has too many arguments) are m_no_ident.
+ */
+identinfo_t *var_function_param(var_function_t *function_p, int index)
+{
+	if (index < 0 || index >= function_p->params_num)
+	{
+		return &m_no_ident;
+	}
+
+	return &function_p->params[index];
+}
+
+/*
+ * Returns a function's param for setting, making room for it if the
+ * function doesn't have that many params yet (new params are cleared).
+ */
+identinfo_t *var_function_param_add(var_function_t *function_p, int index)
+{
+	int size;
+
+	if (index >= function_p->params_size)
+	{
+		size = MAX(function_p->params_size * 2, 4);
+		size = MAX(size, index + 1);
+
+		function_p->params = (identinfo_t*)realloc(function_p->params, sizeof(identinfo_t) * size);
+
+		memset(function_p->params + function_p->params_size, 0,
+			sizeof(identinfo_t) * (size - function_p->params_size));
+
+		function_p->params_size = size;
+	}
+
+	return &function_p->params[index];
+}
+
 /*
  * Deletes a function.
  */
@@ -349,6 +468,7 @@ void var_function_delete(var_function_t *function_p)
 
 	identinfo_delete(&function_p->return_var);
 
+	free(function_p->params);
 	free(function_p);
 }
 
@@ -373,45 +493,6 @@ void identinfo_delete(identinfo_t *ident_p)
 	}
 }
 
-/*
- * Creates a new word.
- */
-word_t *word_new(const char* name_p, UINT symbol)
-{
-	word_t *word_p;
-
-	word_p = MALLOC(word_t, 1);
-
-	if (!word_p)
-	{
-		return NULL;
-	}
-
-	strncpy(word_p->name, name_p, MAX_WORD_NAME);
-
-	word_p->symbol = symbol;
-
-	return word_p;
-}
-
-/*
- * Adds a symbol to the symbol hashtable.
- */
-word_t *add_symbol(hashtable_t *hashtable_p, const char* name_p, UINT symbol)
-{
-	word_t *word_p;
-	variant_t var, key;
-
-	word_p = word_new(name_p, symbol);
-
-	variant_init_pointer(&var, VT_PVOID, (void*)word_p);
-	variant_init_pointer(&key, VT_PSTR, (void*)_strdup(word_p->name));
-
-	hashtable_put(hashtable_p, var, key);
-
-	return word_p;
-}
-
 /* 
  * Initializes all the variables.
  */
@@ -425,8 +506,19 @@ void init()
 
 	m_char = ' ';
 	m_line_count = 0;
+	m_line_p = "";
+	m_last_line_p = "";
 	m_num_level_gcidents = 0;
 	m_instructions_index = 0;
+	m_function_symbols_num = 0;
+
+	ident_index_reset();
+
+	/*
+	 * Symbol name offset 0 is always the empty string.
+	 */
+	m_symbol_names[0] = 0;
+	m_symbol_names_size = 1;
 
 	m_last_symbol_len = 0;
 	m_num_parsed_files = 0;
@@ -438,19 +530,36 @@ void init()
 	ZEROMEMORY(m_parsed_files);
 	ZEROMEMORY(m_literal_string);
 	
-	ZEROMEMORY(exp_integer);
-	ZEROMEMORY(exp_unknown);
-	ZEROMEMORY(exp_float);
-	ZEROMEMORY(exp_string);
-	ZEROMEMORY(exp_bignumber);
-	ZEROMEMORY(m_exp_null);
+	ZEROMEMORY(m_no_ident);
+	ZEROMEMORY(m_boolean_ident);
+	ZEROMEMORY(m_character_ident);
+	ZEROMEMORY(m_string_ident);
+	ZEROMEMORY(m_bignumber_ident);
 
 	ZEROMEMORY(m_empty_tag);
 	ZEROMEMORY(m_empty_res);
 
+	m_empty_res.ident_p = &m_no_ident;
+
+	exp_integer = m_empty_res;
+	exp_unknown = m_empty_res;
+	exp_float = m_empty_res;
+	m_exp_null = m_empty_res;
+
 	exp_integer.type = KIND_INTEGER;
 	exp_float.type = KIND_FLOAT;
 	exp_unknown.type = KIND_UNKNOWN;
+
+	/*
+	 * Integers that are booleans or characters.
+	 */
+	m_boolean_ident.data.int_val.is_boolean = TRUE;
+	m_character_ident.data.int_val.is_character = TRUE;
+
+	exp_boolean = exp_integer;
+	exp_boolean.ident_p = &m_boolean_ident;
+	exp_character = exp_integer;
+	exp_character.ident_p = &m_character_ident;
 	
 	/*
 	 * Used to indicate the type of expression is a literal string.
@@ -464,143 +573,28 @@ void init()
 	/*
 	 * Used to indicate the type of expression is a literal string.
 	 */
-	exp_string.type = KIND_ARRAY;
-	exp_string.ident.kind = KIND_ARRAY;	
-	exp_string.ident.data.array_val_p = var_array_new();
-	exp_string.ident.data.array_val_p->contains.kind = KIND_INTEGER;
-	exp_string.ident.data.array_val_p->contains.data.int_val.is_character = TRUE;
-
-	exp_bignumber.type = KIND_ARRAY;
-	exp_bignumber.ident.kind = KIND_ARRAY;	
-	exp_bignumber.ident.data.array_val_p = var_array_new();
-	exp_bignumber.ident.data.array_val_p->contains.kind = KIND_INTEGER;
-	exp_bignumber.ident.data.array_val_p->is_big_number = TRUE;
+	m_string_ident.kind = KIND_ARRAY;	
+	m_string_ident.data.array_val_p = var_array_new();
+	m_string_ident.data.array_val_p->contains.kind = KIND_INTEGER;
+	m_string_ident.data.array_val_p->contains.data.int_val.is_character = TRUE;
+	SET_EXP_RES(exp_string, m_string_ident);
+
+	m_bignumber_ident.kind = KIND_ARRAY;	
+	m_bignumber_ident.data.array_val_p = var_array_new();
+	m_bignumber_ident.data.array_val_p->contains.kind = KIND_INTEGER;
+	m_bignumber_ident.data.array_val_p->is_big_number = TRUE;
+	SET_EXP_RES(exp_bignumber, m_bignumber_ident);
 	
 	
 	m_exp_null.type = KIND_NULL;
 	
 		
 	/*
-	 * Initialize symbol hashtables.
+	 * Initialize the types hashtable (keywords and operators are static
+	 * tables, see lexer.h).
 	 */
 	m_types_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
-	m_syms_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
-	m_nonalpha_syms_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
-		
-	/*
-	 * Symbols for the P++ language.
-	 */
-	add_symbol(m_syms_p, "begin", SYM_BEGIN);
-	add_symbol(m_syms_p, "end", SYM_END);	
-	add_symbol(m_syms_p, "call", SYM_CALL);
-	add_symbol(m_syms_p, "const", SYM_CONST);
-	add_symbol(m_syms_p, "do", SYM_DO);	
-	add_symbol(m_syms_p, "if", SYM_IF);
-	add_symbol(m_syms_p, "else", SYM_ELSE);
-	add_symbol(m_syms_p, "odd", SYM_ODD);
-	add_symbol(m_syms_p, "procedure", SYM_PROCEDURE);
-	add_symbol(m_syms_p, "then", SYM_THEN);
-	add_symbol(m_syms_p, "var", SYM_VAR);
-	add_symbol(m_syms_p, "while", SYM_WHILE);	
-	add_symbol(m_syms_p, "integer", SYM_INTEGER);
-	add_symbol(m_syms_p, "for", SYM_FOR);
-	add_symbol(m_syms_p, "to", SYM_TO);
-	add_symbol(m_syms_p, "step", SYM_STEP);
-	add_symbol(m_syms_p, "exit", SYM_EXIT);
-	add_symbol(m_syms_p, "function", SYM_FUNCTION);
-	add_symbol(m_syms_p, "return", SYM_RETURN);
-	add_symbol(m_syms_p, "goto", SYM_GOTO);
-	add_symbol(m_syms_p, "include", SYM_INCLUDE);	
-	add_symbol(m_syms_p, "using", SYM_INCLUDE);
-	add_symbol(m_syms_p, "lambda", SYM_LAMBDA);
-	add_symbol(m_syms_p, "repeat", SYM_REPEAT);
-	add_symbol(m_syms_p, "which", SYM_WHICH);
-	add_symbol(m_syms_p, "case", SYM_CASE);
-	add_symbol(m_syms_p, "ref", SYM_REF);
-	add_symbol(m_syms_p, "val", SYM_VAL);	
-	add_symbol(m_syms_p, "asm", SYM_ASM);
-	add_symbol(m_syms_p, "machine_code", SYM_ASM);	
-	add_symbol(m_syms_p, "float", SYM_FLOAT);
-	add_symbol(m_syms_p, "void", SYM_VOID);		
-	add_symbol(m_syms_p, "handle", SYM_HANDLE);
-	add_symbol(m_syms_p, "string", SYM_STRING);
-	add_symbol(m_syms_p, "bignumber", SYM_BIGNUMBER);
-	add_symbol(m_syms_p, "array", SYM_ARRAY);
-	add_symbol(m_syms_p, "byte", SYM_INTEGER);
-	add_symbol(m_syms_p, "biginteger", SYM_BIGNUMBER);
-	add_symbol(m_syms_p, "character", SYM_CHARACTER);
-	add_symbol(m_syms_p, "boolean", SYM_BOOLEAN);
-	add_symbol(m_syms_p, "not", SYM_EXCLAMATION);	
-	add_symbol(m_syms_p, "or", SYM_LOR);	
-	add_symbol(m_syms_p, "and", SYM_LAND);	
-	add_symbol(m_syms_p, "pragma", SYM_PRAGMA);
-	add_symbol(m_syms_p, "option", SYM_PRAGMA);
-	add_symbol(m_syms_p, "boundary_check", SYM_BOUNDARY_CHECK);
-	add_symbol(m_syms_p, "optimize", SYM_OPTIMIZE);
-	add_symbol(m_syms_p, "continue", SYM_CONTINUE);
-	add_symbol(m_syms_p, "null", SYM_NULL);
-	add_symbol(m_syms_p, "declare", SYM_DECLARE);
-	add_symbol(m_syms_p, "type", SYM_TYPE);
-	add_symbol(m_syms_p, "clean", SYM_CLEAN);
-	add_symbol(m_syms_p, "abs", SYM_ABS);
-			
-	/*
-	 * None alphabetal symbols (operators).
-	 */
-	add_symbol(m_nonalpha_syms_p, "||", SYM_LOR);
-	add_symbol(m_nonalpha_syms_p, "!", SYM_EXCLAMATION);
-	add_symbol(m_nonalpha_syms_p, "&&", SYM_LAND);
-	add_symbol(m_nonalpha_syms_p, "[", SYM_LBRACKET);
-	add_symbol(m_nonalpha_syms_p, "]", SYM_RBRACKET);
-	add_symbol(m_nonalpha_syms_p, "~", SYM_TILD);
-	add_symbol(m_nonalpha_syms_p, "?", SYM_QMARK);
-	add_symbol(m_nonalpha_syms_p, "..", SYM_DOTDOT);
-	add_symbol(m_nonalpha_syms_p, "=>", SYM_EQMORE);
-	add_symbol(m_nonalpha_syms_p, "<-", SYM_LESSMINUS);	
-	add_symbol(m_nonalpha_syms_p, "<<", SYM_LCHEVRON);
-	add_symbol(m_nonalpha_syms_p, ">>", SYM_RCHEVRON);
-	add_symbol(m_nonalpha_syms_p, "{", SYM_BEGIN);
-	add_symbol(m_nonalpha_syms_p, "}", SYM_END);
-	add_symbol(m_nonalpha_syms_p, "+", SYM_PLUS);
-	add_symbol(m_nonalpha_syms_p, "++", SYM_PLUS_PLUS);
-	add_symbol(m_nonalpha_syms_p, "--", SYM_MINUS_MINUS);
-	add_symbol(m_nonalpha_syms_p, "+=", SYM_PLUS_EQL);
-	add_symbol(m_nonalpha_syms_p, "-=", SYM_MINUS_EQL);
-	add_symbol(m_nonalpha_syms_p, "*=", SYM_STAR_EQL);
-	add_symbol(m_nonalpha_syms_p, "/=", SYM_SLASH_EQL);
-	add_symbol(m_nonalpha_syms_p, "<<=", SYM_LCHEVRON_EQL);
-	add_symbol(m_nonalpha_syms_p, ">>=", SYM_RCHEVRON_EQL);
-	add_symbol(m_nonalpha_syms_p, "-", SYM_MINUS);
-	add_symbol(m_nonalpha_syms_p, "*", SYM_STAR);
-	add_symbol(m_nonalpha_syms_p, "/", SYM_SLASH);
-	add_symbol(m_nonalpha_syms_p, "(", SYM_LPAREN);
-	add_symbol(m_nonalpha_syms_p, ")", SYM_RPAREN);
-	add_symbol(m_nonalpha_syms_p, "=", SYM_EQL);
-	add_symbol(m_nonalpha_syms_p, ",", SYM_COMMA);
-	add_symbol(m_nonalpha_syms_p, ".", SYM_PERIOD);
-	add_symbol(m_nonalpha_syms_p, ";", SYM_SEMICOLON);
-	add_symbol(m_nonalpha_syms_p, ":", SYM_COLON);
-	add_symbol(m_nonalpha_syms_p, "&", SYM_AMPERSAND);
-	add_symbol(m_nonalpha_syms_p, "!=", SYM_NOT_EQL);
-	add_symbol(m_nonalpha_syms_p, "<", SYM_LESS);
-	add_symbol(m_nonalpha_syms_p, ">", SYM_GREATER);
-	add_symbol(m_nonalpha_syms_p, "<=", SYM_LES_EQL);
-	add_symbol(m_nonalpha_syms_p, ">=", SYM_GRE_EQL);	
-	add_symbol(m_nonalpha_syms_p, ">=", SYM_GRE_EQL);
-	add_symbol(m_nonalpha_syms_p, ":=", SYM_BECOMES);	
-	add_symbol(m_nonalpha_syms_p, "//", SYM_LINECOMMENT);
-	add_symbol(m_nonalpha_syms_p, "/*", SYM_LBLOCKCOMMENT);
-	add_symbol(m_nonalpha_syms_p, "*/", SYM_RBLOCKCOMMENT);
-	add_symbol(m_nonalpha_syms_p, "'", SYM_APOS);
-	add_symbol(m_nonalpha_syms_p, "^", SYM_HAT);
-	add_symbol(m_nonalpha_syms_p, "|", SYM_PIPE);
-	add_symbol(m_nonalpha_syms_p, "@", SYM_AT);	
-	add_symbol(m_nonalpha_syms_p, "$=", SYM_STR_EQUALS);
-	add_symbol(m_nonalpha_syms_p, "$!=", SYM_STR_NEQUALS);
-	add_symbol(m_nonalpha_syms_p, "^=", SYM_HAT_EQL);
-	add_symbol(m_nonalpha_syms_p, "|=", SYM_PIPE_EQL);
-	add_symbol(m_nonalpha_syms_p, "&=", SYM_AMPERSAND_EQL);		
-	add_symbol(m_nonalpha_syms_p, "%", SYM_PERCENT);
+	m_names_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
 }
 
 /* 
@@ -611,23 +605,82 @@ void deinit()
 	/*
 	 * Free hashtables.
 	 */
-	hashtable_delete(m_syms_p);
 	hashtable_delete(m_types_p);
-	hashtable_delete(m_nonalpha_syms_p);
-	var_array_delete(exp_string.ident.data.array_val_p);
-	var_array_delete(exp_bignumber.ident.data.array_val_p);
+	hashtable_delete(m_names_p);
+	var_array_delete(m_string_ident.data.array_val_p);
+	var_array_delete(m_bignumber_ident.data.array_val_p);
 	var_array_delete(m_literal_string.data.array_val_p);	
 }
 
+/*
+ * Reads a whole source file into memory.  A new line and a terminating 0
+ * are added after the text so that every line, including the last one,
+ * ends with a new line.
+ */
+static char *source_read(FILE *file_p, int *length_p)
+{
+	long size;
+	char *text_p;
+
+	fseek(file_p, 0, SEEK_END);
+	size = ftell(file_p);
+	fseek(file_p, 0, SEEK_SET);
+
+	if (size < 0)
+	{
+		return NULL;
+	}
+
+	text_p = MALLOC(char, size + 2);
+
+	if (!text_p)
+	{
+		return NULL;
+	}
+
+	/*
+	 * Reads in text mode can return less than the file's size (eg. when
+	 * line endings are translated).
+	 */
+	*length_p = (int)fread(text_p, 1, size, file_p);
+
+	text_p[*length_p] = '\n';
+	text_p[*length_p + 1] = 0;
+
+	return text_p;
+}
+
+/*
+ * Frees the text of every file that was compiled.
+ */
+void source_texts_free()
+{
+	int i;
+
+	for (i = 0; i < m_num_parsed_files; i++)
+	{
+		free(m_source_texts[i]);
+
+		m_source_texts[i] = NULL;
+	}
+
+	m_line_p = "";
+	m_last_line_p = "";
+}
+
 /*
  * Reads the next line of the current file.
+ *
+ * Lines aren't copied, m_line_p is just moved to the start of the next
+ * one in the file's text.
  */
 std_error_t read_next_line()
 {
-	char c;
+	file_info_t *file_p;
+	const char *end_p;
 	static BOOL revert = FALSE;
 
-	strcpy(m_last_line, m_line);
+	m_last_line_p = m_line_p;
 
 	if (revert)
 	{
@@ -641,46 +694,41 @@ std_error_t read_next_line()
 		}
 	}
 
-	m_files_stack[m_files_stack_index].line_index = 0;
-	m_files_stack[m_files_stack_index].line_length = 0;
+	file_p = &m_files_stack[m_files_stack_index];
 
-	while (((c = getc(m_files_stack[m_files_stack_index].file)) != 10))
+	m_line_p = file_p->text + file_p->text_index;
+	end_p = (const char*)memchr(m_line_p, '\n', file_p->text_length + 1 - file_p->text_index);
+
+	file_p->line_index = 0;
+	file_p->line_length = (int)(end_p - m_line_p) + 1;
+	file_p->line_count++;
+
+	if (m_options.list_source)
 	{
-		if (c == EOF)
-		{
-			m_line[m_files_stack[m_files_stack_index].line_length++] = '\n';
-			m_line[m_files_stack[m_files_stack_index].line_length] = 0;
-			m_files_stack[m_files_stack_index].line_count++;
-			
-			if (m_options.list_source)
-			{
-				printf("LINE %4d: %s", m_files_stack[m_files_stack_index].line_count, m_line);
-			}
+		printf("LINE %4d: %.*s", file_p->line_count, file_p->line_length, m_line_p);
+	}
 
-			if (m_files_stack_index == 0)
-			{
-				return std_error;
-			}
-			else
-			{
-				revert = TRUE;
-				return std_success;
-			}
+	/*
+	 * The new line added after the text ends the last line.
+	 */
+	if (end_p - file_p->text == file_p->text_length)
+	{
+		file_p->text_index = file_p->text_length;
+
+		if (m_files_stack_index == 0)
+		{
+			return std_error;
+		}
+		else
+		{
+			revert = TRUE;
+			return std_success;
 		}
-		
-		m_line[m_files_stack[m_files_stack_index].line_length++] = c;
 	}
 
-	m_line[m_files_stack[m_files_stack_index].line_length++] = c;
-	m_line[m_files_stack[m_files_stack_index].line_length] = 0;
-	m_files_stack[m_files_stack_index].line_count++;
+	file_p->text_index += file_p->line_length;
 	m_line_count++;
 
-	if (m_options.list_source)
-	{
-		printf("LINE %4d: %s", m_files_stack[m_files_stack_index].line_count, m_line);
-	}
-
 	return std_success;
 }
 
@@ -703,7 +751,7 @@ char get_next_char()
 
 	m_last_symbol_len++;
 
-	return m_line[m_files_stack[m_files_stack_index].line_index++];
+	return m_line_p[m_files_stack[m_files_stack_index].line_index++];
 }
 
 /*
@@ -729,27 +777,6 @@ BOOL valid_nonalpha_sym(char ch)
 		|| (ch >=91 && ch <=96) || (ch >= 123 && ch <= 126);
 }
 
-/*
- * Gets the integer symbol of a word symbol.
- */
-int get_word_symbol(hashtable_t *hashtable_p, const char *name)
-{
-	variant_t var;
-
-	var = hashtable_get_stringkey(hashtable_p, name);
-	
-	if (var.vt != VT_PVOID)
-	{
-		m_symbol = SYM_NOSYM;
-	}
-	else
-	{
-		m_symbol = ((word_t*)var.val.val_void_p)->symbol;
-	}
-
-	return m_symbol;
-}
-
 /*
  * Checks to see if a char is a non-symbol char.
  */
@@ -761,66 +788,50 @@ BOOL is_non_sym_char(char ch, BOOL includesemicolon)
 }
 
 /*
- * Tests to see if there are any reserved symbols that start with the supplied string.
+ * Reads away block comments.
  */
-BOOL any_symbol_starts_with(hashtable_t *hashtable, const char* str)
+BOOL comments()
 {
-	hashtable_iterator_t iterator;
-	word_t *word_p;
-
-	hashtable_init_iterator(hashtable, &iterator);
+	char c, last = 0;
+	file_info_t *file_p;
 
-	for (; hashtable_hasmore(&iterator); )
+	for (;;)
 	{
-		word_p = (word_t*)iterator.var_p->val.val_void_p;
+		/*
+		 * The line is in memory so run straight over the characters that
+		 * can't start or end a comment.
+		 */
+		file_p = &m_files_stack[m_files_stack_index];
 
-		if (!(strlen(word_p->name) == strlen(str)))
+		while (file_p->line_index < file_p->line_length
+			&& m_line_p[file_p->line_index] != '/' && m_line_p[file_p->line_index] != '*')
 		{
-			if (strncmp(word_p->name, str, strlen(str)) == 0)
-			{
-				return TRUE;
-			}
-		}
-	}
-
-	return FALSE;
-}
+			file_p->line_index++;
+			m_last_symbol_len++;
 
-/*
- * Reads away block comments.
- */
-BOOL comments()
-{
-	char chars[3];
-
-	memset(chars, 0, 3);
+			last = 0;
+		}
 
-	for (;;)
-	{
-		m_char = get_next_char();
+		c = m_char = get_next_char();
 
-		if (m_char == -1)
+		if (c == -1)
 		{
 			return FALSE;
 		}
 
-		chars[0] = chars[1];
-		chars[1] = m_char;
-		
-		if (strcmp(chars, "/*") == 0)
+		if (last == '/' && c == '*')
 		{
 			if (!comments())
 			{
 				return FALSE;
 			}
 		}
-		else if (strcmp(chars, "*/") == 0)
+		else if (last == '*' && c == '/')
 		{
 			return TRUE;
-
-			break;
 		}
 
+		last = c;
 	}
 }
 
@@ -832,7 +843,7 @@ void get_symbol()
 	char c, c2;
 	int k, b;
 	BOOL read_char;
-	char tmp[MAX_IDENTS + 1];
+	operator_node_t node;
 	
 get_symbol_start:
 
@@ -864,7 +875,7 @@ get_symbol_start:
 
 		m_ident_name[k] = 0;
 
-		m_symbol = get_word_symbol(m_syms_p, m_ident_name);	
+		m_symbol = keyword_symbol(m_ident_name, k);
 
 		if (m_symbol == SYM_NOSYM)
 		{
@@ -1052,45 +1063,30 @@ get_symbol_start:
 	}
 	else if (valid_nonalpha_sym(m_char) && m_char != '\"' && m_char != '\'')
 	{
-		k = 0;
+		operator_node_init(&node);
 
 		/*
 		 * My support for non-alphabet symbols that can be of any length
 		 * as long as the combinations don't conflict.
 		 *
 		 * eg. > >= >=$ are all valid different symbols that can be differentiated.
+		 *
+		 * Characters are read while a longer operator could still follow
+		 * (see lexer.h).  A character that no operator continues with is
+		 * left for the next symbol.
 		 */
 		do
 		{
-			if (k < MAX_IDENT_LEN)
+			if (!operator_node_next(&node, m_char))
 			{
-				tmp[k++] = m_char;
+				break;
 			}
 
-			tmp[k] = 0;
-
-			if (!any_symbol_starts_with(m_nonalpha_syms_p, tmp))
-			{
-				m_symbol = get_word_symbol(m_nonalpha_syms_p, tmp);
-
-				if (k >= 1 && m_symbol <= 0)
-				{
-					tmp[k - 1] = 0;
-				}
-				else
-				{
-					m_char = get_next_char();
-				}
-
-				break;
-			}		
-			
 			m_char = get_next_char();
-
 		}
-		while (valid_nonalpha_sym(m_char));
+		while (operator_node_extends(&node) && valid_nonalpha_sym(m_char));
 		
-		m_symbol = get_word_symbol(m_nonalpha_syms_p, tmp);
+		m_symbol = operator_node_symbol(&node);
 		
 		if (m_symbol == SYM_LINECOMMENT)
 		{
@@ -1775,51 +1771,191 @@ void instructions_add(int f, int l, LONGLONG a)
 }
 
 /*
- * Adds an instruction to the output opcodes.  Works with floats.
+ * Records the code address of a function in the symbol table written to
+ * .pins files.
+ *
+ * @returns The symbol's index (for filling in its stack size once the
+ *			function has been compiled) or -1 if the table is full.
  */
-void instructions_add_f(int f, float l, float a)
+int function_symbol_add(const char *name, int address)
 {
-	if (m_instructions_index >= MAX_INSTRUCTIONS)
-	{
-		error(30010);
-	}
-	else
+	int len = strlen(name) + 1;
+
+	if (m_function_symbols_num >= MAX_FUNCTION_SYMBOLS
+		|| m_symbol_names_size + len > MAX_SYMBOL_NAMES)
 	{
-		m_instructions[m_instructions_index].f = f;
-		memcpy(&m_instructions[m_instructions_index].l, &l, sizeof(int));
-		memcpy(&m_instructions[m_instructions_index].a, &a, sizeof(int));
+		return -1;
 	}
 
-	optimize();
+	memcpy(m_symbol_names + m_symbol_names_size, name, len);
 
-	m_instructions_index++;
+	m_function_symbols[m_function_symbols_num].name = m_symbol_names_size;
+	m_function_symbols[m_function_symbols_num].address = address;
+	m_function_symbols[m_function_symbols_num].stack_size = 0;
+
+	m_symbol_names_size += len;
+
+	return m_function_symbols_num++;
 }
 
 /*
- * Returns the position of an identifier in the identifier stack.
+ * Works out how much stack the function whose code runs from start to the
+ * last instruction added needs (see stack_use).  That's the most that's
+ * ever on the stack above the function's frame, locals included.  Falls
+ * back to the locals plus EXPRESSION_STACK_RESERVE if it can't be worked
+ * out.
  */
-int ident_position(char *name, int *ptx)
+int function_stack_size(int start, int locals)
 {
-	int i;
-	identinfo_t *ident_p;
+	int i, len, size;
+	instruction_t instruction;
+	decoded_instruction_t *code_p;
 
-	for (i = *ptx; i >= 0; i--)
+	len = m_instructions_index - start;
+	size = -1;
+
+	code_p = CALLOC(decoded_instruction_t, len);
+
+	if (code_p)
 	{
-		ident_p = &m_idents[i];
+		for (i = 0; i < len; i++)
+		{
+			instruction = m_instructions[start + i];
+
+			/*
+			 * Calls to functions that haven't been defined yet are
+			 * still flagged as negative.
+			 */
+			if (instruction.f < 0)
+			{
+				instruction.f = -instruction.f;
+			}
 
-		if (strcmp(name, ident_p->name) == 0)
+			/*
+			 * The function's code is walked on its own.
+			 */
+			if (instruction.f == OC_JMP || instruction.f == OC_JPC)
+			{
+				instruction.a -= start;
+			}
+
+			if (!decode_instruction(&instruction, &code_p[i]))
+			{
+				break;
+			}
+		}
+
+		if (i == len)
 		{
-			break;
+			size = stack_use(code_p, len);
 		}
+
+		free(code_p);
 	}
 
-	return i;
+	return size < 0 ? locals + EXPRESSION_STACK_RESERVE : size;
 }
 
 /*
- * Finds and returns an identifier in the identifier stack.
+ * Adds an instruction to the output opcodes.  Works with floats.
  */
-identinfo_t *ident_find(char *name, int *ptx)
+void instructions_add_f(int f, float l, float a)
+{
+	if (m_instructions_index >= MAX_INSTRUCTIONS)
+	{
+		error(30010);
+	}
+	else
+	{
+		m_instructions[m_instructions_index].f = f;
+		memcpy(&m_instructions[m_instructions_index].l, &l, sizeof(int));
+		memcpy(&m_instructions[m_instructions_index].a, &a, sizeof(int));
+	}
+
+	optimize();
+
+	m_instructions_index++;
+}
+
+/*
+ * Empties the identifier index.
+ */
+void ident_index_reset()
+{
+	int i;
+
+	for (i = 0; i < IDENT_INDEX_SIZE; i++)
+	{
+		m_ident_buckets[i] = -1;
+	}
+
+	m_ident_top = -1;
+}
+
+/*
+ * Adds the identifier just written to position i of the identifier stack
+ * to the identifier index.  Identifiers are only ever written to the top
+ * of the stack, so anything at i or above has gone out of scope and is
+ * unlinked first.  Each bucket's chain then stays in descending order of
+ * position, which is what keeps the shadowing rules of a linear search
+ * down the stack.
+ */
+void ident_index_add(int i)
+{
+	int j;
+	unsigned int hash;
+
+	if (i < 0 || i >= MAX_IDENTS)
+	{
+		return;
+	}
+
+	/*
+	 * Working down from the top, each identifier is the head of its
+	 * bucket's chain by the time it's reached.
+	 */
+	for (j = m_ident_top; j >= i; j--)
+	{
+		if (m_ident_buckets[m_ident_hashes[j] & (IDENT_INDEX_SIZE - 1)] == j)
+		{
+			m_ident_buckets[m_ident_hashes[j] & (IDENT_INDEX_SIZE - 1)] = m_ident_links[j];
+		}
+	}
+
+	hash = hash_string(m_idents[i].name);
+
+	m_ident_hashes[i] = hash;
+	m_ident_links[i] = m_ident_buckets[hash & (IDENT_INDEX_SIZE - 1)];
+	m_ident_buckets[hash & (IDENT_INDEX_SIZE - 1)] = i;
+	m_ident_top = i;
+}
+
+/*
+ * Returns the position of an identifier in the identifier stack (the
+ * highest position at or below *ptx, so inner scopes shadow outer ones).
+ */
+int ident_position(const char *name, int *ptx)
+{
+	int i;
+	unsigned int hash;
+
+	hash = hash_string(name);
+
+	for (i = m_ident_buckets[hash & (IDENT_INDEX_SIZE - 1)]; i >= 0; i = m_ident_links[i])
+	{
+		if (i <= *ptx && m_ident_hashes[i] == hash && strcmp(name, m_idents[i].name) == 0)
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+/*
+ * Finds and returns an identifier in the identifier stack.
+ */
+identinfo_t *ident_find(const char *name, int *ptx)
 {
 	int i;
 	
@@ -2009,12 +2145,55 @@ void type_add(identinfo_t *ident_p)
 	variant_t var, varkey;
 
 	variant_init_pointer(&var, VT_PVOID, ident_p);
-	variant_init_pointer(&varkey, VT_PSTR, ident_p->name);
+	variant_init_pointer(&varkey, VT_PSTR, (char*)ident_p->name);
 	varkey.destructor = NULL;
 
 	hashtable_put(m_types_p, var, varkey);
 }
 
+/*
+ * Returns the interned copy of a name (adding it if it's new).  Interned
+ * names last until the compiler is finished (see deinit).
+ *
+ * @returns "" (after reporting the error) if there isn't the memory to
+ *			intern the name.
+ */
+const char *name_intern(const char *name)
+{
+	char *name_p;
+	variant_t var, varkey;
+
+	var = hashtable_get_stringkey(m_names_p, name);
+
+	if (var.vt != VT_EMPTY)
+	{
+		return var.val.val_sz;
+	}
+
+	if (!(name_p = _strdup(name)))
+	{
+		error(30020);
+
+		return "";
+	}
+
+	/*
+	 * The key owns the name (and frees it if the put fails).
+	 */
+	variant_init_pointer(&var, VT_PSTR, name_p);
+	var.destructor = NULL;
+	variant_init_pointer(&varkey, VT_PSTR, name_p);
+
+	if (hashtable_put_fast(m_names_p, var, varkey) != std_success)
+	{
+		error(30020);
+
+		return "";
+	}
+
+	return name_p;
+}
+
 identinfo_t *type_find(const char* name)
 {
 	variant_t var, varkey;
@@ -2234,7 +2413,7 @@ identinfo_t *ident_process_var(int level, int *ptx, int *pdx, BOOL byref, BOOL s
 		return NULL;		
 	}
 	
-	strcpy(ident.name, m_ident_name);
+	ident.name = name_intern(m_ident_name);
 	ident.level = level;
 	ident.byref = byref;
 	ident.constant = FALSE;
@@ -2379,7 +2558,7 @@ identinfo_t *ident_process_var(int level, int *ptx, int *pdx, BOOL byref, BOOL s
 	{	
 		exp_res_t exp_res;
 
-		ZEROMEMORY(exp_res);
+		exp_res = m_empty_res;
 
 		SET_EXP_RES(exp_res, (*ident_p));
 
@@ -2458,6 +2637,8 @@ identinfo_t *ident_add_any(identinfo_t *ident_p, int *ptx, int *pdx)
 	{
 		
 		m_idents[++(*ptx)] = *ident_p;
+
+		ident_index_add(*ptx);
 				
 		(*pdx)++;		
 
@@ -2493,7 +2674,9 @@ identinfo_t *ident_add_function_ex(int level, int *ptx, int *pdx, BOOL byref, BO
 	ident_p->data.function_val_p->params_num = 0;
 	ident_p->data.function_val_p->byref = byref;
 
-	strcpy(ident_p->name, m_ident_name);
+	ident_p->name = name_intern(m_ident_name);
+
+	ident_index_add(*ptx);
 
 	if (ident_p->kind == KIND_PROCEDURE)
 	{
@@ -2511,12 +2694,16 @@ identinfo_t *ident_add_goto(int *ptx, int *address, int level)
 	identinfo_t *ident_p;
 
 	ident_p = &m_idents[++(*ptx)];
-	strcpy(ident_p->name, m_ident_name);
+	ident_p->name = name_intern(m_ident_name);
+
+	ident_index_add(*ptx);
 
 	ident_p->kind = KIND_LABEL;	
 	ident_p->level = level;
 	ident_p->address = *address;
 
+	m_code_addresses_taken++;
+
 	return ident_p;
 }
 
@@ -2673,7 +2860,7 @@ void do_garbage_collection(int level, int *ptx, int start, int end)
 	 * Do garbage collection.
 	 */
 
-	int i;
+	int i, release_address = 0, release_count = 0;
 
 	for (i = start; i <= end; i++)
 	{
@@ -2699,12 +2886,31 @@ void do_garbage_collection(int level, int *ptx, int start, int end)
 				&& !m_idents[i].refed == 0)				
 			{
 				/*
-				 * Then release the array.
+				 * Then release the array.  Arrays stored next to each
+				 * other are released with a single instruction.
 				 */
-				memory_release(&m_idents[i], level, ptx);
+				if (release_count > 0 && m_idents[i].address == release_address + release_count)
+				{
+					release_count++;
+				}
+				else
+				{
+					if (release_count > 0)
+					{
+						memory_release_range(release_address, release_count, ptx);
+					}
+
+					release_address = m_idents[i].address;
+					release_count = 1;
+				}
 			}
 		}
 	}
+
+	if (release_count > 0)
+	{
+		memory_release_range(release_address, release_count, ptx);
+	}
 }
 
 /*
@@ -2717,13 +2923,15 @@ exp_res_t expression_lambda(int level, int *ptx)
 	int cx1, cx2, jmp1, num_params, params_byte_len;
 	exp_res_t exp_res, exp_ret_res;
 
-	ZEROMEMORY(exp_res);
-	ZEROMEMORY(exp_ret_res);	
+	exp_res = m_empty_res;
+	exp_ret_res = m_empty_res;	
+
+	m_code_addresses_taken++;
 
 	ident_p = identinfo_new();
 		
 	ident_p->data.function_val_p = var_function_new();
-	strcpy(ident_p->name, "lambda");
+	ident_p->name = name_intern("lambda");
 	
 	otx = *ptx;
 
@@ -2756,9 +2964,11 @@ exp_res_t expression_lambda(int level, int *ptx)
 	params_byte_len = m_instructions_index - cx2;
 
 	/*
-	 * Fix the function's stack size.
+	 * Fix the size of the function's header and parameters (the stack it
+	 * needs is worked out once its code has been compiled).
 	 */
 	m_instructions[cx1].a = dx;
+	m_instructions[cx1].l = dx + EXPRESSION_STACK_RESERVE;
 	
 	/*
 	 * Right parenthesis of the parameter definitions.
@@ -2811,6 +3021,9 @@ exp_res_t expression_lambda(int level, int *ptx)
 	instructions_add(OC_SRV, 0, 1);
 	instructions_add(OC_OPR, 0, 0);
 
+	m_instructions[cx1].l = function_stack_size(cx1, dx);
+	ident_p->data.function_val_p->stack_size = m_instructions[cx1].l;
+
 	/*
 	 * Restore the variable top stack cause this function deallocates.
 	 */
@@ -2918,7 +3131,7 @@ exp_res_t function_procedure_caller(int level, int *ptx, identinfo_t *ident_p, B
 {		
 	exp_res_t exp_res;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 	
 	if (ident_p->kind == KIND_FUNCTION && ident_p->kind != KIND_VOID)
 	{
@@ -3051,7 +3264,7 @@ exp_res_t function_procedure_caller(int level, int *ptx, identinfo_t *ident_p, B
 			error(6002);
 		}
 
-		exp_res.ident = *ident_p;
+		exp_res.ident_p = ident_p;
 	}
 
 	return exp_res;
@@ -3082,20 +3295,20 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 {	
 	if (to.type == KIND_NULL)
 	{
-		from.ident.was_null = TRUE;
+		from.was_null = TRUE;
 
 		return from;
 	}
 	else if (from.type == KIND_NULL)
 	{
-		to.ident.was_null = TRUE;
+		to.was_null = TRUE;
 
 		return to;
 	}
 
 	
-	if (can_be_string(&to.ident) && !can_be_big_number(&to.ident)
-		&& can_be_big_number(&from.ident))
+	if (can_be_string(to.ident_p) && !can_be_big_number(to.ident_p)
+		&& can_be_big_number(from.ident_p))
 	{
 		/*
 		 * BigNumber -> String
@@ -3103,8 +3316,8 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 
 		return exp_string;
 	}
-	else if (can_be_string(&from.ident) && !can_be_big_number(&from.ident)
-		&& can_be_big_number(&to.ident))
+	else if (can_be_string(from.ident_p) && !can_be_big_number(from.ident_p)
+		&& can_be_big_number(to.ident_p))
 	{
 		/*
 		 * String -> BigNumber
@@ -3119,7 +3332,7 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 	{
 		if (from.type == KIND_FUNCTION)
 		{
-			if (!signatures_match(from.ident.data.function_val_p, to.ident.data.function_val_p))
+			if (!signatures_match(from.ident_p->data.function_val_p, to.ident_p->data.function_val_p))
 			{
 				error(11010);
 			}
@@ -3145,23 +3358,23 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 		return from;
 	}
 	
-	if (can_be_string(&to.ident) && from.type == KIND_INTEGER && !from.ident.data.int_val.is_handle)
+	if (can_be_string(to.ident_p) && from.type == KIND_INTEGER && !from.ident_p->data.int_val.is_handle)
 	{
 		xtos(level, ptx, from);
 	}
-	else if (can_be_string(&to.ident) && from.type == KIND_FLOAT)		
+	else if (can_be_string(to.ident_p) && from.type == KIND_FLOAT)		
 	{
 		xtos(level, ptx, from);
 	}
-	else if (can_be_string(&to.ident)
-		&& can_be_big_number(&from.ident))
+	else if (can_be_string(to.ident_p)
+		&& can_be_big_number(from.ident_p))
 	{
 		/*
 		 * Casting from a BigNumber to a String is ok.
 		 */
 	}
-	else if (can_be_string(&from.ident)
-		&& can_be_big_number(&to.ident))
+	else if (can_be_string(from.ident_p)
+		&& can_be_big_number(to.ident_p))
 	{
 		/*
 		 * Casting from a String to a BigNumber is ok.
@@ -3186,7 +3399,7 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 		  */
 		 
 		else if (from.type == KIND_INTEGER
-			&& from.ident.data.int_val.is_handle)
+			&& from.ident_p->data.int_val.is_handle)
 		{			
 		}
 		else
@@ -3195,22 +3408,22 @@ exp_res_t do_static_cast(int level, int *ptx, exp_res_t from, exp_res_t to)
 		}
 	}
 	else if (to.type == KIND_INTEGER && from.type == KIND_ARRAY
-		&& to.ident.data.int_val.is_handle)
+		&& to.ident_p->data.int_val.is_handle)
 	{
-		if (from.ident.data.array_val_p->is_literal)
+		if (from.ident_p->data.array_val_p->is_literal)
 		{
 			error(10550);
 		}
 	}
-	else if (from.type == KIND_INTEGER && from.ident.data.int_val.is_handle
+	else if (from.type == KIND_INTEGER && from.ident_p->data.int_val.is_handle
 		&& to.type == KIND_ARRAY)
 	{
 	}
-	else if (to.type == KIND_INTEGER && can_be_string(&from.ident))
+	else if (to.type == KIND_INTEGER && can_be_string(from.ident_p))
 	{
 		stoi(level, ptx);
 	}
-	else if (to.type == KIND_FLOAT && can_be_string(&from.ident))
+	else if (to.type == KIND_FLOAT && can_be_string(from.ident_p))
 	{
 		stof(level, ptx);
 	}
@@ -3346,17 +3559,17 @@ exp_res_t expression_ident_unary(int level, int *ptx, exp_res_t current_res)
 			}
 		}
 		
-		exp_res = expression_unary(&current_res.ident, m_symbol, level, ptx, exp_res, FALSE);
+		exp_res = expression_unary(current_res.ident_p, m_symbol, level, ptx, exp_res, FALSE);
 
 		if (!(symbol == SYM_PLUS_PLUS || symbol == SYM_MINUS_MINUS))
 		{			
-			if (current_res.ident.kind == KIND_ARRAY)
+			if (current_res.ident_p->kind == KIND_ARRAY)
 			{				
-				expression_pure_array_element(&current_res.ident, level, ptx, FALSE);				
+				expression_pure_array_element(current_res.ident_p, level, ptx, FALSE);				
 			}
 			else
 			{
-				load_ident(&current_res.ident, level, ptx);
+				load_ident(current_res.ident_p, level, ptx);
 			}
 		}
 	}
@@ -3364,7 +3577,7 @@ exp_res_t expression_ident_unary(int level, int *ptx, exp_res_t current_res)
 	{
 		if (current_res.type == KIND_ARRAY)
 		{
-			SET_EXP_RES(exp_res, current_res.ident.data.array_val_p->contains);
+			SET_EXP_RES(exp_res, current_res.ident_p->data.array_val_p->contains);
 		}
 	}
 
@@ -3391,7 +3604,11 @@ exp_res_t load_number(int level, int *ptx)
 	else if (exp_res.type == KIND_INTEGER)
 	{
 		instructions_add(OC_LIT, 0, (LONGLONG)m_number);
-		exp_res.ident.data.int_val.is_character = m_is_char;		
+
+		if (m_is_char)
+		{
+			exp_res = exp_character;
+		}
 	}
 	else
 	{
@@ -3679,7 +3896,7 @@ void stoi(int level, int *ptx)
 		/*
 		 * Load the second argument (radix).
 		 */
-		instructions_add(OC_LIT, 0, funcident_p->data.function_val_p->params[1].data.int_val.default_val);
+		instructions_add(OC_LIT, 0, var_function_param(funcident_p->data.function_val_p, 1)->data.int_val.default_val);
 
 		/*
 		 * Store the params.
@@ -3713,11 +3930,11 @@ void xtos(int level, int *ptx, exp_res_t exp_res)
 {
 	if (exp_res.type == KIND_INTEGER)
 	{
-		if (exp_res.ident.data.int_val.is_boolean)
+		if (exp_res.ident_p->data.int_val.is_boolean)
 		{
 			btos(level, ptx);
 		}
-		else if (exp_res.ident.data.int_val.is_character)
+		else if (exp_res.ident_p->data.int_val.is_character)
 		{
 			ctos(level, ptx);
 		}
@@ -3773,7 +3990,7 @@ void itos(int level, int *ptx)
 		/*
 		 * Load the second argument (radix).
 		 */
-		instructions_add(OC_LIT, 0, funcident_p->data.function_val_p->params[1].data.int_val.default_val);
+		instructions_add(OC_LIT, 0, var_function_param(funcident_p->data.function_val_p, 1)->data.int_val.default_val);
 
 		/*
 		 * Store the params.
@@ -3818,7 +4035,7 @@ void ftos(int level, int *ptx)
 		/*
 		 * Load the second argument (decimal places).
 		 */
-		instructions_add(OC_LIT, 0, funcident_p->data.function_val_p->params[1].data.int_val.default_val);
+		instructions_add(OC_LIT, 0, var_function_param(funcident_p->data.function_val_p, 1)->data.int_val.default_val);
 
 		/*
 		 * Store the params.
@@ -3899,7 +4116,7 @@ void new_integer_array_copy(int level, int *ptx)
 		/*
 		 * Load up the default length.
 		 */
-		instructions_add(OC_LIT, 0, funcident_p->data.function_val_p->params[1].data.int_val.default_val);
+		instructions_add(OC_LIT, 0, var_function_param(funcident_p->data.function_val_p, 1)->data.int_val.default_val);
 
 		generate_stp(funcident_p);
 		generate_stp(funcident_p);	
@@ -3923,9 +4140,9 @@ exp_res_t expression_plus_minus(int level, int *ptx, tag_t tag)
 	exp_res = expression_bitwise(level, ptx, tag);
 	
 	if (exp_res.type == KIND_FLOAT || exp_res.type == KIND_INTEGER || exp_res.type == KIND_UNKNOWN
-		|| can_be_big_number(&exp_res.ident))
+		|| can_be_big_number(exp_res.ident_p))
 	{
-		if ((exp_res.type == KIND_ARRAY && exp_res.ident.data.array_val_p->is_big_number))
+		if ((exp_res.type == KIND_ARRAY && exp_res.ident_p->data.array_val_p->is_big_number))
 		{
 			/*int x = 0;*/
 		}
@@ -3950,7 +4167,7 @@ exp_res_t expression_plus_minus(int level, int *ptx, tag_t tag)
 					instructions_add_itof(OC_OPR, 0, OPR_SUB, exp_res.type);
 				}
 			}
-			else if (can_be_big_number(&exp_res.ident))
+			else if (can_be_big_number(exp_res.ident_p))
 			{
 				if (symbol == SYM_PLUS)
 				{
@@ -3970,7 +4187,7 @@ exp_res_t expression_plus_minus(int level, int *ptx, tag_t tag)
 		}
 	}
 	
-	if (exp_res.type == KIND_ARRAY && !can_be_big_number(&exp_res.ident))
+	if (exp_res.type == KIND_ARRAY && !can_be_big_number(exp_res.ident_p))
 	{
 		/*
 		 * Adding of arrays.
@@ -3991,7 +4208,7 @@ exp_res_t expression_plus_minus(int level, int *ptx, tag_t tag)
 			 * to the literal string, since they don't have a reference to this.
 			 */
 			if (exp_res.type == KIND_ARRAY			
-				&& !exp_res.ident.data.array_val_p->is_literal)
+				&& !exp_res.ident_p->data.array_val_p->is_literal)
 			{
 				new_integer_array_copy(level, ptx);
 			}
@@ -4037,7 +4254,7 @@ exp_res_t expression_condition_worker(int level, int *ptx, exp_res_t exp_current
 	int op, symbol;
 	exp_res_t exp_res, exp_res2, ret_exp_res;
 
-	ZEROMEMORY(ret_exp_res);
+	ret_exp_res = m_empty_res;
 
 	/*
 	 * @author Thong Nguyen
@@ -4093,8 +4310,7 @@ exp_res_t expression_condition_worker(int level, int *ptx, exp_res_t exp_current
 				instructions_add(OC_OPR, 0, OPR_EQL);				
 			}
 
-			exp_res = exp_integer;
-			exp_res.ident.data.int_val.is_boolean = TRUE;
+			exp_res = exp_boolean;
 
 			return exp_res;
 		}
@@ -4153,8 +4369,7 @@ exp_res_t expression_condition_worker(int level, int *ptx, exp_res_t exp_current
 				
 				/*ret_exp_res.type = KIND_FLOAT;*/
 
-				ret_exp_res = exp_integer;
-				ret_exp_res.ident.data.int_val.is_boolean = TRUE;
+				ret_exp_res = exp_boolean;
 			}	
 			else if (exp_res2.type == KIND_INTEGER
 				|| (exp_res2.type == KIND_ARRAY && op == OPR_EQL)
@@ -4169,8 +4384,7 @@ exp_res_t expression_condition_worker(int level, int *ptx, exp_res_t exp_current
 				
 				/*ret_exp_res.type = KIND_INTEGER;*/
 				
-				ret_exp_res = exp_integer;
-				ret_exp_res.ident.data.int_val.is_boolean = TRUE;
+				ret_exp_res = exp_boolean;
 			}
 			else
 			{
@@ -4201,8 +4415,7 @@ exp_res_t expression_condition_worker(int level, int *ptx, exp_res_t exp_current
 
 			/*ret_exp_res.type = KIND_INTEGER;*/
 
-			ret_exp_res = exp_integer;
-			ret_exp_res.ident.data.int_val.is_boolean = TRUE;
+			ret_exp_res = exp_boolean;
 		}
 
 		
@@ -4266,194 +4479,647 @@ int condition_operator(int symbol, int kind, tag_t tag)
 			}
 			else
 			{
-				return OPR_LEQ;
+				return OPR_LEQ;
+			}
+
+		case SYM_GREATER:
+			
+			if (kind == KIND_FLOAT)
+			{
+				return FOP_GRE;
+			}
+			else
+			{
+				return OPR_GRE;
+			}
+
+		case SYM_GRE_EQL:
+
+			if (kind == KIND_FLOAT)
+			{
+				return FOP_GRQ;
+			}
+			else
+			{
+				return OPR_GRQ;
+			}
+			
+	}
+
+	return -1;
+}
+
+/*
+ * The opcodes for reference counting and array bounds checking are only
+ * emitted when the library that defines them is included (memory.p++ and
+ * array.p++).  The library functions are looked up to check this.
+ */
+static BOOL library_function_available(char *function_name, int *ptx)
+{
+	identinfo_t *funcident_p;
+
+	funcident_p = ident_find(function_name, ptx);
+
+	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
+	{
+		return TRUE;
+	}
+
+	error(16000);
+
+	return FALSE;
+}
+
+/*
+ * Makes sure an array can hold size + 1 elements.
+ *
+ * The handle of the array should be on top of the stack.
+ * The handle of the array will be popped off the stack.
+ */
+void array_realloc_by_handle_off_stack(int level, int *ptx, int size)
+{
+	if (library_function_available("__array_check", ptx))
+	{
+		/*
+		 * Load the size and check it like an index.
+		 */
+		instructions_add(OC_LIT, 0, size);
+		instructions_add(OC_SWS, 0, 0);
+		instructions_add(OC_ACK, 0, 0);
+		instructions_add(OC_DEC, 0, 1);
+	}
+}
+
+/*
+ * Reallocates an array reference given an array.
+ */
+void array_realloc(identinfo_t *ident_p, int level, int *ptx, int size)
+{
+	if (library_function_available("__array_check", ptx))
+	{
+		/*
+		 * Load the size and check it like an index.
+		 */
+		instructions_add(OC_LIT, 0, size);
+
+		generate_load(ident_p, level);
+
+		instructions_add(OC_ACK, 0, 0);
+		instructions_add(OC_DEC, 0, 1);
+	}
+}
+
+/*
+ * Addrefs an array reference given an array.
+ */
+void memory_addref(identinfo_t *ident_p, int level, int *ptx)
+{
+	if (library_function_available("__memory_addref", ptx))
+	{		
+		generate_load(ident_p, level);
+		
+		instructions_add(OC_ARF, 0, 0);
+	}
+}
+
+/*
+ * Releases an array reference given an array.
+ */
+void memory_release(identinfo_t *ident_p, int level, int *ptx)
+{
+	if (library_function_available("__memory_release", ptx))
+	{		
+		generate_load(ident_p, level);
+		
+		instructions_add(OC_RLS, 0, 0);
+	}
+}
+
+/*
+ * Releases count array references stored next to each other in the
+ * current frame, starting at address.
+ */
+void memory_release_range(int address, int count, int *ptx)
+{
+	if (library_function_available("__memory_release", ptx))
+	{
+		instructions_add(OC_RLM, count, address);
+	}
+}
+
+/*
+ * Addrefs an array reference.
+ *
+ * The handle of the array should be on top of the stack.
+ * The handle of the array will be popped off the stack.
+ */
+void memory_addref_by_handle_off_stack(int level, int *ptx)
+{
+	if (library_function_available("__memory_addref", ptx))
+	{	
+		instructions_add(OC_ARF, 0, 0);
+	}
+}
+
+/*
+ * Releases an array reference.
+ *
+ * The handle of the array should be on top of the stack.
+ * The handle of the array will be popped off the stack.
+ */
+void memory_release_by_handle_off_stack(int level, int *ptx)
+{
+	if (library_function_available("__memory_release", ptx))
+	{	
+		instructions_add(OC_RLS, 0, 0);
+	}
+}
+
+/*
+ * Bounds check elimination.
+ *
+ * A subscript s[i] inside "for i := c to array_length(s) - k" (c >= 0 and
+ * k >= 1 literals, no step) can't go out of range while the loop counts
+ * upwards because the "to" expression is evaluated again before every
+ * iteration.  The LOD/ACK pair emitted for each of these subscripts is
+ * removed once the loop's body has been compiled and it is known not to:
+ *
+ * - store to (or take the address of) i or s.
+ * - load s for anything other than a subscript or array_length.
+ * - call any function other than array_length or string_length, or call
+ *   through a pointer.
+ * - reallocate, free or copy memory in machine code (RAL, FRE, MCP).
+ * - create a lambda or label (the body's code can't move then).
+ *
+ * Other handles to the same array can only shrink it through a call or
+ * machine code, so the array's length can't change under the loop.
+ *
+ * When "to" is less than the starting value the loop counts upwards
+ * forever, so for those iterations s[i] is checked by a block after the
+ * loop (only there if checks were removed).
+ */
+
+/*
+ * Reports an array access that keeps its bounds check.
+ */
+static void bounds_check_kept(const char *name, int line, char *reason)
+{
+	m_bounds_checks_kept++;
+
+	if (m_options.report_bounds_checks)
+	{
+		printf("<bounds check kept in file [%s], line ~%d> %s[] (%s)\n", m_files_stack[m_files_stack_index].file_name, line, name, reason);
+	}
+}
+
+/*
+ * TRUE if an instruction refers to a variable (by level and address).
+ */
+static BOOL instruction_refers_to(instruction_t *instruction_p, int level, int var_level, int var_address)
+{
+	return level - instruction_p->l == var_level && instruction_p->a == var_address;
+}
+
+/*
+ * TRUE if an instruction calls array_length or string_length.
+ */
+static BOOL instruction_calls_length(instruction_t *instruction_p, int level, int *ptx)
+{
+	identinfo_t *ident_p;
+
+	if (instruction_p->f != OC_CAL)
+	{
+		return FALSE;
+	}
+
+	ident_p = ident_find("array_length", ptx);
+
+	if (ident_p && ident_p->kind == KIND_FUNCTION && instruction_refers_to(instruction_p, level, ident_p->level, ident_p->address))
+	{
+		return TRUE;
+	}
+
+	ident_p = ident_find("string_length", ptx);
+
+	if (ident_p && ident_p->kind == KIND_FUNCTION && instruction_refers_to(instruction_p, level, ident_p->level, ident_p->address))
+	{
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Starts a for loop whose subscripts might not need bounds checks.
+ *
+ * @param counter_p		The loop counter.
+ * @param becomes_start	Address of the counter's initial assignment.
+ * @param to_start		Address of the JMP before the "to" expression.
+ * @param to_end		Address of the JMP after the "to" expression.
+ * @param step			TRUE if the loop has a step.
+ *
+ * @returns TRUE if the loop was started (the body must be followed by
+ * bounds_check_loop_body and the loop by bounds_check_loop_end).
+ */
+BOOL bounds_check_loop_begin(identinfo_t *counter_p, int level, int becomes_start, int to_start, int to_end, BOOL step, int *ptx)
+{
+	int i;
+	instruction_t *to_p;
+	bounds_check_loop_t *loop_p;
+
+	if (!m_options.array_check_boundaries || step
+		|| m_bounds_check_loops_count >= MAX_BOUNDS_CHECK_LOOPS
+		|| counter_p->kind != KIND_INTEGER || counter_p->byref)
+	{
+		return FALSE;
+	}
+
+	/*
+	 * The counter must start at a literal >= 0 ("i := c").
+	 */
+	if (to_start - becomes_start != 2
+		|| m_instructions[becomes_start].f != OC_LIT
+		|| m_instructions[becomes_start].a < 0
+		|| m_instructions[becomes_start + 1].f != OC_STO
+		|| !instruction_refers_to(&m_instructions[becomes_start + 1], level, counter_p->level, counter_p->address))
+	{
+		return FALSE;
+	}
+
+	/*
+	 * The "to" expression must be "array_length(s) - k".
+	 *
+	 * LOD s; STP; LIT 0 0; CAL array_length; LIT k; OPR SUB
+	 *
+	 * A string argument (string_length) has a reference added first
+	 * (LOD s; ARF).
+	 */
+	to_p = &m_instructions[to_start + 1];
+
+	if (to_end - (to_start + 1) == 8
+		&& to_p[0].f == OC_LOD && to_p[1].f == OC_ARF
+		&& to_p[2].f == OC_LOD && to_p[0].l == to_p[2].l && to_p[0].a == to_p[2].a)
+	{
+		to_p += 2;
+	}
+
+	if (to_end - (to_p - m_instructions) != 6
+		|| to_p[0].f != OC_LOD
+		|| to_p[1].f != OC_STP
+		|| to_p[2].f != OC_LIT
+		|| !instruction_calls_length(&to_p[3], level, ptx)
+		|| to_p[4].f != OC_LIT || to_p[4].a < 1
+		|| to_p[5].f != OC_OPR || to_p[5].a != OPR_SUB)
+	{
+		return FALSE;
+	}
+
+	/*
+	 * Nothing may jump into the middle of the "to" expression.
+	 */
+	for (i = becomes_start; i < to_end; i++)
+	{
+		if ((m_instructions[i].f == OC_JMP || m_instructions[i].f == OC_JPC)
+			&& m_instructions[i].l == 0
+			&& m_instructions[i].a > to_start + 1 && m_instructions[i].a < to_end)
+		{
+			return FALSE;
+		}
+	}
+
+	loop_p = &m_bounds_check_loops[m_bounds_check_loops_count++];
+
+	loop_p->counter_level = counter_p->level;
+	loop_p->counter_address = counter_p->address;
+	loop_p->array_level = level - to_p[0].l;
+	loop_p->array_address = (int)to_p[0].a;
+	loop_p->removed = FALSE;
+	loop_p->first_site = m_bounds_check_sites_count;
+	loop_p->code_addresses_taken = m_code_addresses_taken;
+
+	return TRUE;
+}
+
+/*
+ * Records a subscript's bounds check (the last instruction added) and
+ * works out if it belongs to a loop that might remove it.
+ *
+ * @param ident_p		The array.
+ * @param index_start	Address of the first instruction of the index
+ *						expression.
+ */
+void bounds_check_site_add(identinfo_t *ident_p, int level, int index_start)
+{
+	int i;
+	instruction_t *index_p;
+	bounds_check_loop_t *loop_p;
+	bounds_check_site_t *site_p;
+	int line;
+
+	line = m_files_stack[m_files_stack_index].line_count;
+
+	index_p = &m_instructions[index_start];
+
+	if (m_instructions_index - index_start != 3 || index_p->f != OC_LOD)
+	{
+		bounds_check_kept(ident_p->name, line, "index isn't a variable");
+
+		return;
+	}
+
+	for (i = m_bounds_check_loops_count - 1; i >= 0; i--)
+	{
+		loop_p = &m_bounds_check_loops[i];
+
+		if (instruction_refers_to(index_p, level, loop_p->counter_level, loop_p->counter_address)
+			&& !ident_p->byref
+			&& ident_p->level == loop_p->array_level
+			&& ident_p->address == loop_p->array_address)
+		{
+			break;
+		}
+	}
+
+	if (i < 0)
+	{
+		bounds_check_kept(ident_p->name, line, "not the counter of a loop over the array");
+
+		return;
+	}
+
+	if (m_bounds_check_sites_count >= MAX_BOUNDS_CHECK_SITES)
+	{
+		bounds_check_kept(ident_p->name, line, "too many subscripts in the loop");
+
+		return;
+	}
+
+	site_p = &m_bounds_check_sites[m_bounds_check_sites_count++];
+
+	site_p->address = m_instructions_index - 1;
+	site_p->loop = i;
+	site_p->line = line;
+	strcpy(site_p->name, ident_p->name);
+}
+
+/*
+ * Works out why a loop body needs to keep its bounds checks.
+ *
+ * @returns NULL if the checks can be removed.
+ */
+static char *bounds_check_loop_body_reason(bounds_check_loop_t *loop_p, int level, int body_start, int *ptx)
+{
+	int i;
+	instruction_t *instruction_p;
+	BOOL counter, array;
+
+	if (m_code_addresses_taken != loop_p->code_addresses_taken)
+	{
+		return "loop body has a lambda or label";
+	}
+
+	for (i = body_start; i < m_instructions_index; i++)
+	{
+		instruction_p = &m_instructions[i];
+
+		counter = instruction_refers_to(instruction_p, level, loop_p->counter_level, loop_p->counter_address);
+		array = instruction_refers_to(instruction_p, level, loop_p->array_level, loop_p->array_address);
+
+		switch (instruction_p->f)
+		{
+		case OC_LOD:
+
+			/*
+			 * The array can only be loaded to check a subscript or to
+			 * get its length.
+			 */
+			if (array
+				&& !(i + 1 < m_instructions_index && m_instructions[i + 1].f == OC_ACK)
+				&& !(i + 3 < m_instructions_index && m_instructions[i + 1].f == OC_STP
+					&& instruction_calls_length(&m_instructions[i + 3], level, ptx)))
+			{
+				return "loop body uses the array";
 			}
 
-		case SYM_GREATER:
-			
-			if (kind == KIND_FLOAT)
+			break;
+
+		case OC_STO:
+		case OC_SID:
+		case OC_LDA:
+		case OC_LID:
+		case OC_ISL: case OC_ISR: case OC_IAD: case OC_ISU: case OC_IMU:
+		case OC_IDI: case OC_IXO: case OC_IOR: case OC_IAN:
+		case OC_IZL: case OC_IZR: case OC_IIA: case OC_IIS: case OC_IIM:
+		case OC_IID: case OC_IIX: case OC_IIO: case OC_IIB:
+
+			if (counter)
 			{
-				return FOP_GRE;
+				return "loop body changes the counter";
 			}
-			else
+
+			if (array)
 			{
-				return OPR_GRE;
+				return "loop body changes the array";
 			}
 
-		case SYM_GRE_EQL:
+			break;
 
-			if (kind == KIND_FLOAT)
-			{
-				return FOP_GRQ;
-			}
-			else
+		case OC_CAL:
+		case OC_TAC:
+		case OC_FN_CAL:
+
+			/*
+			 * Any other function could shrink the array through another
+			 * handle to it.
+			 */
+			if (!instruction_calls_length(instruction_p, level, ptx))
 			{
-				return OPR_GRQ;
+				return "loop body calls a function";
 			}
-			
-	}
 
-	return -1;
-}
+			break;
 
-void array_realloc_by_handle_off_stack(int level, int *ptx, int size)
-{
-	identinfo_t *funcident_p;
+		case OC_RAL:
+		case OC_FRE:
+		case OC_MCP:
 
-	funcident_p = ident_find("__array_check", ptx);
+			return "loop body reallocates, frees or copies memory";
 
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
-	{
-		/*
-		 * Load the size.
-		 */
-		instructions_add(OC_LIT, 0, size);
-		
-		generate_stp(funcident_p);
-		generate_stp(funcident_p);
+		case OC_CAI:
+		case OC_CII:
+		case OC_CAS:
 
-		generate_call_func(funcident_p, level);
+			return "loop body calls a function indirectly";
+		}
 	}
-	else
-	{
-		error(16000);
-	}	
+
+	return NULL;
 }
 
 /*
- * Reallocates an array reference given an array.
+ * Address of an instruction after the LOD/ACK pairs before it (ACK
+ * addresses in ascending order) have been removed.  A removed
+ * instruction's new address is that of the instruction after it.
  */
-void array_realloc(identinfo_t *ident_p, int level, int *ptx, int size)
+static int bounds_check_new_address(int address, int *addresses, int count)
 {
-	identinfo_t *funcident_p;
+	int i, result;
 
-	funcident_p = ident_find("__array_check", ptx);
+	result = address;
 
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
+	for (i = 0; i < count && addresses[i] - 1 < address; i++)
 	{
-		/*
-		 * Load the the array handle.
-		 */		
-		generate_load(ident_p, level);
-		
-		/*
-		 * Load the size.
-		 */
-		instructions_add(OC_LIT, 0, size);
-		
-		generate_stp(funcident_p);
-		generate_stp(funcident_p);
-
-		generate_call_func(funcident_p, level);
+		result -= addresses[i] < address ? 2 : 1;
 	}
-	else
-	{
-		error(16000);
-	}	
+
+	return result;
 }
 
 /*
- * Addrefs an array reference given an array.
+ * Removes the LOD/ACK pairs of the given subscripts (ACK addresses in
+ * ascending order) and moves the jumps and pending subscripts that come
+ * after them.
  */
-void memory_addref(identinfo_t *ident_p, int level, int *ptx)
+static void bounds_check_remove(int *addresses, int count)
 {
-	identinfo_t *funcident_p;
+	int i, j, first, dest;
 
-	funcident_p = ident_find("__memory_addref", ptx);
-	
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
-	{		
-		generate_load(ident_p, level);
-		
-		generate_stp(funcident_p);
+	first = addresses[0] - 1;
 
-		generate_call_sub(funcident_p, level);
+	for (i = 0; i < m_instructions_index; i++)
+	{
+		if ((m_instructions[i].f == OC_JMP || m_instructions[i].f == OC_JPC)
+			&& m_instructions[i].l == 0
+			&& m_instructions[i].a > first)
+		{
+			m_instructions[i].a = bounds_check_new_address((int)m_instructions[i].a, addresses, count);
+		}
 	}
-	else
+
+	for (i = 0; i < m_bounds_check_sites_count; i++)
 	{
-		error(16000);
+		if (m_bounds_check_sites[i].address > first)
+		{
+			m_bounds_check_sites[i].address = bounds_check_new_address(m_bounds_check_sites[i].address, addresses, count);
+		}
 	}
-}
 
-/*
- * Releases an array reference given an array.
- */
-void memory_release(identinfo_t *ident_p, int level, int *ptx)
-{
-	identinfo_t *funcident_p;
+	for (i = first, j = 0, dest = first; i < m_instructions_index; i++)
+	{
+		if (j < count && i == addresses[j] - 1)
+		{
+			continue;
+		}
 
-	funcident_p = ident_find("__memory_release", ptx);
-	
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
-	{		
-		generate_load(ident_p, level);
-		
-		generate_stp(funcident_p);
+		if (j < count && i == addresses[j])
+		{
+			j++;
 
-		generate_call_sub(funcident_p, level);
-	}
-	else
-	{
-		error(16000);
+			continue;
+		}
+
+		m_instructions[dest++] = m_instructions[i];
 	}
+
+	m_instructions_index = dest;
 }
 
 /*
- * Addrefs an array reference.
- *
- * The handle of the array should be on top of the stack.
- * The handle of the array will be popped off the stack.
+ * Removes the subscripts' bounds checks of a loop started with
+ * bounds_check_loop_begin (if it can) once its body has been compiled.
  */
-void memory_addref_by_handle_off_stack(int level, int *ptx)
+void bounds_check_loop_body(int level, int body_start, int *ptx)
 {
-	identinfo_t *funcident_p;
+	int i, j, loop, count;
+	char *reason;
+	int addresses[MAX_BOUNDS_CHECK_SITES];
+	bounds_check_loop_t *loop_p;
+	bounds_check_site_t *site_p;
 
-	funcident_p = ident_find("__memory_addref", ptx);
-	
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
-	{	
-		generate_stp(funcident_p);
+	loop = m_bounds_check_loops_count - 1;
+	loop_p = &m_bounds_check_loops[loop];
+
+	reason = bounds_check_loop_body_reason(loop_p, level, body_start, ptx);
+
+	count = 0;
+
+	for (i = loop_p->first_site; i < m_bounds_check_sites_count; i++)
+	{
+		site_p = &m_bounds_check_sites[i];
+
+		if (site_p->loop != loop)
+		{
+			continue;
+		}
+
+		if (reason)
+		{
+			bounds_check_kept(site_p->name, site_p->line, reason);
+		}
+		else
+		{
+			addresses[count++] = site_p->address;
+		}
+	}
+
+	if (count > 0)
+	{
+		bounds_check_remove(addresses, count);
 
-		generate_call_sub(funcident_p, level);
+		m_bounds_checks_removed += count;
+		loop_p->removed = TRUE;
 	}
-	else
+
+	/*
+	 * Forget this loop's subscripts (outer loops' ones are still pending).
+	 */
+	for (i = j = loop_p->first_site; i < m_bounds_check_sites_count; i++)
 	{
-		error(16000);
+		if (m_bounds_check_sites[i].loop != loop)
+		{
+			m_bounds_check_sites[j++] = m_bounds_check_sites[i];
+		}
 	}
+
+	m_bounds_check_sites_count = j;
 }
 
 /*
- * Releases an array reference.
+ * Finishes a loop started with bounds_check_loop_begin.  If its checks
+ * were removed the loop head's jump for counting upwards past "to" is
+ * sent through a check of s[i] (added here) on its way.
  *
- * The handle of the array should be on top of the stack.
- * The handle of the array will be popped off the stack.
+ * @param count_up_jump	Address of the loop head's jump for counting
+ *						upwards.
  */
-void memory_release_by_handle_off_stack(int level, int *ptx)
+void bounds_check_loop_end(int level, int count_up_jump)
 {
-	identinfo_t *funcident_p;
+	bounds_check_loop_t *loop_p;
 
-	funcident_p = ident_find("__memory_release", ptx);
-	
-	if (funcident_p && funcident_p->kind == KIND_FUNCTION)
-	{	
-		generate_stp(funcident_p);
+	loop_p = &m_bounds_check_loops[--m_bounds_check_loops_count];
 
-		generate_call_sub(funcident_p, level);
-	}
-	else
+	if (!loop_p->removed)
 	{
-		error(16000);
+		return;
 	}
+
+	instructions_add(OC_LOD, level - loop_p->counter_level, loop_p->counter_address);
+	instructions_add(OC_LOD, level - loop_p->array_level, loop_p->array_address);
+	instructions_add(OC_ACK, 0, 0);
+	instructions_add(OC_DEC, 0, 1);
+	instructions_add(OC_JMP, 0, m_instructions[count_up_jump].a);
+
+	m_instructions[count_up_jump].a = m_instructions_index - 5;
 }
 
+
 /*
  * Loads the memory offset of an array given an array index, and also does array
  * boundary check.
  */
 void array_load_offset(identinfo_t *ident_p, int level, int *ptx, BOOL aggregate)
 {	
-	int kind;
-	identinfo_t *ident_p2;
+	int kind, index_start;
 	exp_res_t exp_res;
 
 	if (ident_p->kind == KIND_ARRAY)
@@ -4467,21 +5133,16 @@ void array_load_offset(identinfo_t *ident_p, int level, int *ptx, BOOL aggregate
 		 * Expression pushes the array index on the stack.
 		 */
 
+		index_start = m_instructions_index;
+
 		exp_res = expression_raw(level, ptx, m_empty_tag);
 		
 		if (m_options.array_check_boundaries)
 		{
 			/*
-			 * Copy the index for bounds checking.
-			 */
-			instructions_add(OC_SLD, 0, 0);
-
-			/*
-			 * Check the size of the array is ok.
+			 * Check the size of the array is ok (growing it if needed).
 			 */
-			ident_p2 = ident_find("__array_check", ptx);
-
-			if (ident_p2 && ident_p2->kind == KIND_FUNCTION)
+			if (library_function_available("__array_check", ptx))
 			{				
 				if (!aggregate)
 				{
@@ -4489,45 +5150,25 @@ void array_load_offset(identinfo_t *ident_p, int level, int *ptx, BOOL aggregate
 					 * Load the array handle.
 					 */
 					generate_load(ident_p, level);
-
-					/*
-					 * Swap the array handle and index.
-					 */
-					instructions_add(OC_SWS, 0, 0);
-
-					/*
-					 * Store the index parameter.
-					 */
-					generate_stp(ident_p2);
-					/*
-					 * Store the array handle as an argument.
-					 */
-					generate_stp(ident_p2);
 				}
 				else
 				{
 					/*
 					 * Load the array handle (was on top stack before this function call).
 					 */
-					instructions_add(OC_SLD, 0, 2);
-
-					/*
-					 * Swap array handle and index.
-					 */
-					instructions_add(OC_SWS, 0, 0);
-
-					/*
-					 * Store index then array handle.
-					 */
-					generate_stp(ident_p2);
-					generate_stp(ident_p2);
+					instructions_add(OC_SLD, 0, 1);
 				}
 				
-				generate_call_sub(ident_p2, level);
-			}
-			else
-			{
-				error(16000);
+				instructions_add(OC_ACK, 0, 0);
+
+				if (!aggregate)
+				{
+					bounds_check_site_add(ident_p, level, index_start);
+				}
+				else
+				{
+					bounds_check_kept(ident_p->name, m_files_stack[m_files_stack_index].line_count, "array is an expression");
+				}
 			}
 		}
 
@@ -4555,7 +5196,7 @@ int* static_arraydef(identinfo_t *ident_p, int level, int *ptx)
 	int *i_p;	
 	exp_res_t exp_res;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	i_p = MALLOC(int, 255);
 
@@ -4615,7 +5256,7 @@ exp_res_t expression_arraydef(int level, int *ptx, tag_t tag)
 	identinfo_t *ident_p2;
 	exp_res_t exp_res, exp_wanted;
 	
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	if (m_symbol == SYM_BEGIN && tag.ident_p && tag.ident_p->kind == KIND_ARRAY)
 	{
@@ -4689,8 +5330,8 @@ exp_res_t statement_becomes(identinfo_t *ident_p, int level, int *ptx, BOOL push
 	BOOL in_memory_store = FALSE;
 	exp_res_t exp_res, exp_current;
 		
-	ZEROMEMORY(exp_res);
-	ZEROMEMORY(exp_current);
+	exp_res = m_empty_res;
+	exp_current = m_empty_res;
 	
 	if (ident_p->constant)
 	{
@@ -4804,7 +5445,7 @@ exp_res_t statement_becomes(identinfo_t *ident_p, int level, int *ptx, BOOL push
 		
 		if (ident_p->kind == KIND_ARRAY && ident_p->data.array_val_p->assigning_ref && push)
 		{
-			if (!(exp_res.type == KIND_ARRAY && exp_res.ident.was_null))
+			if (!(exp_res.type == KIND_ARRAY && exp_res.was_null))
 			{
 				memory_addref(ident_p, level, ptx);
 			}
@@ -4896,9 +5537,11 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 {	
 	identinfo_t *ident_p;	
 	exp_res_t exp_res;
-	int kind, cx1, cx2, cx3;
+	int kind, cx1, cx2, cx3, cx4;
 	int for_instructions_start, for_instructions_end;	
 	int to_start = -1, to_end = -1, step_start = -1, step_end = -1;
+	int becomes_start;
+	BOOL bounds_check;
 	
 	/*
 	 * The symbol after a for should be a counter variable.
@@ -4934,6 +5577,8 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	 */
 	get_symbol();
 
+	becomes_start = m_instructions_index;
+
 	statement_becomes(ident_p, level, ptx, FALSE, m_empty_tag);
 
 	/*
@@ -4972,7 +5617,7 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	 * a function cause it needs to be used in several places.
 	 */	
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	SET_EXP_RES(exp_res, (*ident_p));
 
@@ -5015,6 +5660,11 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 		}
 	}
 	
+	/*
+	 * Work out if the subscripts in the loop might not need bounds checks.
+	 */
+	bounds_check = bounds_check_loop_begin(ident_p, level, becomes_start, to_start, to_end, step_start >= 0, ptx);
+
 	/*
 	 * Fix the jump that skips the to and skip code.
 	 */
@@ -5049,6 +5699,11 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	 * If the "to" is more than the original starting value then.
 	 */
 	instructions_add(OC_OPR, 0, OPR_LEQ);
+
+	/*
+	 * cx4 is the address of the jump taken when counting upwards.
+	 */
+	cx4 = m_instructions_index;
 	instructions_add(OC_JPC, 0, m_instructions_index + 5);
 
 	/*
@@ -5092,6 +5747,11 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	 */
 	statement(level, ptx, pdx, func_ident_p);
 
+	if (bounds_check)
+	{
+		bounds_check_loop_body(level, for_instructions_start, ptx);
+	}
+
 	/*
 	 * for_instructions_end is the address of the first instruction after the for.
 	 */
@@ -5137,6 +5797,11 @@ void statement_for(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	 */
 	instructions_add(OC_JMP, 0, cx1);
 
+	if (bounds_check)
+	{
+		bounds_check_loop_end(level, cx4);
+	}
+
 	/*
 	 * Fix the destination of the address of the conditional jumps (above).
 	 */
@@ -5497,7 +6162,7 @@ void statement_which(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	exp_res_t exp_res;	
 	int cx1 = -1, cx2 = -1, start, op, sx1, sx2;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 	ZEROMEMORY(tag);
 
 	get_symbol();
@@ -6035,7 +6700,7 @@ void statement(int level, int *ptx, int *pdx, identinfo_t *func_ident_p)
 	identinfo_t *ident_p;
 	int cx1, symbol, symbol2;		
 
-	ZEROMEMORY(exp_res);	
+	exp_res = m_empty_res;	
 
 	if (m_symbol == SYM_LPAREN)
 	{
@@ -6327,7 +6992,7 @@ int process_param(int level, int *ptx, int *pdx, int paramx, identinfo_t *ident_
 		 */
 
 		ident_p2->is_param = TRUE;
-		ident_p->data.function_val_p->params[paramx] = ident_copy(*ident_p2);
+		*var_function_param_add(ident_p->data.function_val_p, paramx) = ident_copy(*ident_p2);
 		
 		if (ident_p2)
 		{
@@ -6368,7 +7033,7 @@ int process_params(int level, int *ptx, int *pdx, identinfo_t *ident_p)
 		{			
 			kind = process_param(level, ptx, pdx, num, ident_p);
 			
-			ident_p->data.function_val_p->params[num].kind = kind;
+			var_function_param_add(ident_p->data.function_val_p, num)->kind = kind;
 
 			num++;
 
@@ -6416,13 +7081,13 @@ int process_arg(int level, int *ptx, int paramx, identinfo_t *ident_p)
 	exp_res_t exp_res;
 	BOOL byref = FALSE;	
 
-	ZEROMEMORY(exp_res);	
+	exp_res = m_empty_res;	
 	
 	if (m_symbol == SYM_AMPERSAND || m_symbol == SYM_REF)
 	{
 		get_symbol();
 
-		if (!(ident_p->data.function_val_p->params[paramx].byref))
+		if (!(var_function_param(ident_p->data.function_val_p, paramx)->byref))
 		{
 			 /*
 			  * error(11058);
@@ -6438,7 +7103,7 @@ int process_arg(int level, int *ptx, int paramx, identinfo_t *ident_p)
 		byref = FALSE;
 	}
 
-	if (ident_p->data.function_val_p->params[paramx].byref)
+	if (var_function_param(ident_p->data.function_val_p, paramx)->byref)
 	{	
 		exp_res = expression_ref(level, ptx, m_empty_tag, TRUE);
 	}
@@ -6450,7 +7115,7 @@ int process_arg(int level, int *ptx, int paramx, identinfo_t *ident_p)
 		}
 		else
 		{
-			SET_EXP_RES(exp_res, ident_p->data.function_val_p->params[paramx]);
+			SET_EXP_RES(exp_res, *var_function_param(ident_p->data.function_val_p, paramx));
 
 			expression(level, ptx, exp_res, m_empty_tag);
 		}
@@ -6464,7 +7129,7 @@ exp_res_t expression_ref(int level, int *ptx, tag_t tag, BOOL ref)
 	exp_res_t exp_res;
 	identinfo_t *ident_p;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	if (m_symbol == SYM_NULL)
 	{
@@ -6558,9 +7223,9 @@ int process_args(int level, int *ptx, identinfo_t *ident_p /* the ident for the
 					 * If it's optional load it up, otherwise load a 0 and give an error
 					 */
 
-					if (ident_p->data.function_val_p->params[num].has_default)
+					if (var_function_param(ident_p->data.function_val_p, num)->has_default)
 					{
-						load_ident_default(&ident_p->data.function_val_p->params[num], level, ptx);
+						load_ident_default(var_function_param(ident_p->data.function_val_p, num), level, ptx);
 					}
 					else
 					{
@@ -6578,7 +7243,7 @@ int process_args(int level, int *ptx, identinfo_t *ident_p /* the ident for the
 				{
 					kind = process_arg(level, ptx, (no_args) ? 1 : num, ident_p);
 				
-					if (kind != ident_p->data.function_val_p->params[num].kind)
+					if (kind != var_function_param(ident_p->data.function_val_p, num)->kind)
 					{
 						/*
 						 * Expression should have casted, but obviously failed.
@@ -6619,11 +7284,11 @@ int process_args(int level, int *ptx, identinfo_t *ident_p /* the ident for the
 		
 	if (num != ident_p->data.function_val_p->params_num)
 	{
-		if (ident_p->data.function_val_p->params[num].has_default)
+		if (var_function_param(ident_p->data.function_val_p, num)->has_default)
 		{
 			for (i = num; i < ident_p->data.function_val_p->params_num; i++)
 			{
-				load_ident_default(&ident_p->data.function_val_p->params[i], level, ptx);
+				load_ident_default(var_function_param(ident_p->data.function_val_p, i), level, ptx);
 
 				num++;
 			}
@@ -6815,7 +7480,8 @@ void block_var(int level, int *ptx, int *pdx, BOOL statement)
 void process_block(int level, int tx, identinfo_t *ident_p)
 {	
 	BOOL root = FALSE, predeclare = TRUE;
-	int i, j, symbol, dx, otx, otx2, odx, cx, inx, vars = 0;
+	int i, j, symbol, dx, otx, otx2, odx, cx, cx_entry = -1, inx, vars = 0;
+	int function_symbol = -1;
 	identinfo_t *ident_p2 = NULL, *ident_p3 = NULL;
 	identinfo_t ident;	
 
@@ -6856,7 +7522,7 @@ void process_block(int level, int tx, identinfo_t *ident_p)
 				get_symbol();
 
 				ident_p2 = identinfo_new();
-				strcpy(ident_p2->name, m_ident_name);
+				ident_p2->name = name_intern(m_ident_name);
 				ident_read_type(ident_p2, level, &tx);
 
 				type_add(ident_p2);
@@ -6986,7 +7652,7 @@ void process_block(int level, int tx, identinfo_t *ident_p)
 					 */
 					ident = ident_copy(ident_p->data.function_val_p->return_var);
 
-					strcpy(ident.name, "retval");
+					ident.name = name_intern("retval");
 					ident.level = level;
 					ident.is_this = TRUE;
 					ident.address = - 1;
@@ -7110,10 +7776,18 @@ void process_block(int level, int tx, identinfo_t *ident_p)
 	{		
 		m_instructions[m_idents[otx].address].a = m_instructions_index;
 		m_idents[otx].address = m_instructions_index;
+
+		if (!root)
+		{
+			function_symbol = function_symbol_add(ident_p->name, m_instructions_index);
+		}
 		
 		/*
 		 * Increment enough space for the data segment header and parameters.
+		 * The frame size (l) is filled in once the whole function has been
+		 * compiled.
 		 */
+		cx_entry = m_instructions_index;
 		instructions_add(OC_INC, 0, dx - vars);
 
 		/*
@@ -7359,6 +8033,25 @@ void process_block(int level, int tx, identinfo_t *ident_p)
 	 * End of data segment.
 	 */
 	instructions_add(OC_OPR, 0, 0);
+
+	/*
+	 * Record the most stack the function uses so the stack only needs to
+	 * be checked (and grown) when the function is entered.
+	 */
+	if (cx_entry >= 0)
+	{
+		m_instructions[cx_entry].l = function_stack_size(cx_entry, dx);
+
+		if (!root)
+		{
+			ident_p->data.function_val_p->stack_size = m_instructions[cx_entry].l;
+		}
+
+		if (function_symbol >= 0)
+		{
+			m_function_symbols[function_symbol].stack_size = m_instructions[cx_entry].l;
+		}
+	}
 	
 	for (i = otx + 1; i <= tx; i++)
 	{
@@ -7514,6 +8207,8 @@ void fix_gotos(int start, int end, int level, int *ptx, BOOL warn)
 BOOL load_file(const char *file)
 {	
 	char file_path[MAX_PATH];
+	char *text_p;
+	int text_length;
 
 	FILE *file_p;
 
@@ -7604,6 +8299,23 @@ BOOL load_file(const char *file)
 		return FALSE;
 	}
 	
+	/*
+	 * The file is read once and then scanned in place.
+	 */
+	text_p = source_read(file_p, &text_length);
+
+	fclose(file_p);
+
+	if (!text_p)
+	{
+		if (m_files_stack_index >= 0)
+		{
+			error(14000);
+		}
+
+		return FALSE;
+	}
+
 	if (m_options.list_source)
 	{
 		printf("FILE     :[%s]\n", file);
@@ -7611,7 +8323,9 @@ BOOL load_file(const char *file)
 	
 	m_files_stack_index++;
 
-	m_files_stack[m_files_stack_index].file = file_p;
+	m_files_stack[m_files_stack_index].text = text_p;
+	m_files_stack[m_files_stack_index].text_length = text_length;
+	m_files_stack[m_files_stack_index].text_index = 0;
 	strcpy(m_files_stack[m_files_stack_index].file_name, file);
 
 	m_files_stack[m_files_stack_index].line_count = 0;
@@ -7620,6 +8334,7 @@ BOOL load_file(const char *file)
 
 	m_char = ' ';
 
+	m_source_texts[m_num_parsed_files] = text_p;
 	strncpy(m_parsed_files[m_num_parsed_files++], file_path, MAX_PATH);
 
 	return TRUE;
@@ -7630,9 +8345,7 @@ BOOL load_file(const char *file)
  */
 compiler_results_t compile(const char *file)
 {
-	int i;
 	char *pc;
-	FILE* pf;
 	char path[MAX_PATH];
 	compiler_results_t compiler_results;
 	
@@ -7653,27 +8366,20 @@ compiler_results_t compile(const char *file)
 			printf("Opening binary (%s)...\n\n", path);
 		}
 
-		pf = fopen(path, "rb");
+		compiler_results.instructions = m_instructions;
+		compiler_results.symbols = m_function_symbols;
+		compiler_results.symbol_names = m_symbol_names;
 
-		if (pf)
+		if (!pins_read(path, &compiler_results))
 		{
-			i = 0;
-
-			while (!feof(pf))
-			{
-				fread(&m_instructions[i].f, sizeof(int), 1, pf);
-				fread(&m_instructions[i].l, sizeof(int), 1, pf);
-				fread(&m_instructions[i].a, sizeof(int), 1, pf);
+			printf("\nFile (%s) is not a valid P++ binary.\n", path);
 
-				i++;
-			}
+			compiler_results.instructions = NULL;
 
-			fclose(pf);
+			return compiler_results;
 		}
 
-		compiler_results.instructions = m_instructions;
 		compiler_results.lines_compiled = -1;
-		compiler_results.opcodes_generated = i;
 		compiler_results.number_of_errors = 0;
 	}
 	else
@@ -7698,6 +8404,20 @@ compiler_results_t compile(const char *file)
 			m_files_stack_index--;
 		}
 
+		if (m_options.report_bounds_checks)
+		{
+			printf("Bounds checks: %d removed, %d kept.\n", m_bounds_checks_removed, m_bounds_checks_kept);
+		}
+
+		compiler_results.instructions = m_instructions;
+		compiler_results.lines_compiled = m_line_count;
+		compiler_results.opcodes_generated = m_instructions_index;
+		compiler_results.number_of_errors = m_number_of_errors;
+		compiler_results.symbols = m_function_symbols;
+		compiler_results.symbols_num = m_function_symbols_num;
+		compiler_results.symbol_names = m_symbol_names;
+		compiler_results.symbol_names_size = m_symbol_names_size;
+
 		if (m_options.write_binary)
 		{
 			pc = strrchr(path, '.');
@@ -7709,27 +8429,13 @@ compiler_results_t compile(const char *file)
 
 			strcat(path, ".pins");
 
-			pf = fopen(path, "w+b");
-
-			if (pf)
+			if (!pins_write(path, &compiler_results))
 			{
-				for (i = 0; i < m_instructions_index; i++)
-				{
-					fwrite(&m_instructions[i].f, sizeof(int), 1, pf);
-					fwrite(&m_instructions[i].l, sizeof(int), 1, pf);
-					fwrite(&m_instructions[i].a, sizeof(int), 1, pf);
-				}
-
-				fclose(pf);	
+				printf("\nUnable to write binary (%s).\n", path);
 			}
 		}
 
-		fclose(m_files_stack[0].file);
-
-		compiler_results.instructions = m_instructions;
-		compiler_results.lines_compiled = m_line_count;
-		compiler_results.opcodes_generated = m_instructions_index;
-		compiler_results.number_of_errors = m_number_of_errors;
+		source_texts_free();
 	}
 		
 	return compiler_results;
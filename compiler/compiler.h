@@ -36,13 +36,27 @@
 #define ZEROMEMORY(x) (memset(&(x), 0, sizeof(x)))
 
 #define MAX_IDENT_LEN				0x100
-#define MAX_WORD_NAME				0x100
 #define MAX_NUMBER_DIGITS			0x20
 #define MAX_INSTRUCTIONS			0x50000
 #define MAX_IDENTS					0x5000
+#define IDENT_INDEX_SIZE			0x2000
 #define MAX_LEVEL					0x100
 #define MAX_LITERAL_STRING_LEN		0x10000
 #define MAX_PATH					0x1000
+#define MAX_FUNCTION_SYMBOLS		0x4000
+#define MAX_SYMBOL_NAMES			0x40000
+
+/*
+ * Stack space a function reserves (on top of its data segment) for
+ * expression temporaries and the parameters of the calls it makes.
+ * The interpretor makes sure this much is available on entry.
+ */
+#define EXPRESSION_STACK_RESERVE	0x100
+
+/*
+ * Default maximum size the interpretor's stack can grow to (in integers).
+ */
+#define DEFAULT_MAX_STACK_SIZE		0x1000000
 
 /*
  * ARRAY_HEADER_SIZE includes the MEMORY_HEADER_SIZE (2)
@@ -50,6 +64,11 @@
 #define ARRAY_HEADER_SIZE			0x4
 #define ARRAY_LENGTH_OFFSET			0x2
 
+/*
+ * How many elements an array grows by past the wanted size (see array.p++).
+ */
+#define ARRAY_RESOLUTION			0x100
+
 #define EXIT_FOR			0x1
 #define EXIT_WHICH			0x4
 #define EXIT_REPEAT			0x5
@@ -68,7 +87,6 @@
 #define GOTO_LABEL			0x2000
 #define LITERAL_STRING			0x3000
 
-typedef struct tag_word_sym word_t; 
 typedef struct tag_instruction instruction_t;
 typedef struct tag_indentinfo identinfo_t;
 typedef struct tag_var var_t;
@@ -81,6 +99,7 @@ typedef struct tag_var_array var_array_t;
 typedef struct tag_paraminfo paraminfo_t;
 typedef struct tag_tag tag_t;
 typedef struct tag_options options_t;
+typedef struct tag_function_symbol function_symbol_t;
 typedef struct tag_compiler_results compiler_results_t;
 typedef struct tag_exp_res exp_res_t;
 
@@ -96,6 +115,26 @@ struct tag_compiler_results
 	int number_of_errors;
 	int opcodes_generated;
 	instruction_t *instructions;
+
+	/*
+	 * Functions and their code addresses (names are offsets into
+	 * symbol_names).
+	 */
+	int symbols_num;
+	function_symbol_t *symbols;
+	char *symbol_names;
+	int symbol_names_size;
+};
+
+struct tag_function_symbol
+{
+	int name;
+	int address;
+
+	/*
+	 * Most stack the function uses (what its entry reserves).
+	 */
+	int stack_size;
 };
 
 struct tag_options
@@ -110,29 +149,42 @@ struct tag_options
 	BOOL trace_stack;
 	BOOL array_check_boundaries;
 	BOOL optimize;
+	BOOL superinstructions;
+	BOOL verify;
+	BOOL profile_opcodes;
+	BOOL heap_statistics;
+	BOOL report_bounds_checks;
+	BOOL read_ahead;
 	BOOL write_binary;
 
+	int max_stack_size;
+
 	char source_path[2048];
 	char command_line[2048];
+	char server_address[MAX_PATH];
 };
 
 options_t m_options;
 
 struct tag_file_info
 {
-	FILE *file;
+	/*
+	 * The whole file (see source_read).
+	 */
+	char *text;
+	int text_length;
+
+	/*
+	 * Offset of the next line in text.
+	 */
+	int text_index;
+
 	int line_index;
 	int line_length;
 	int line_count;
 	char file_name[512];
 };
 
-struct tag_word_sym
-{
-	char name[MAX_WORD_NAME];
-	UINT symbol;
-};
-
 struct tag_instruction
 {
 	int f;
@@ -170,7 +222,10 @@ struct tag_paraminfo
 
 struct tag_indentinfo
 {
-	char name[MAX_IDENT_LEN + 1];
+	/*
+	 * Interned (see name_intern) so identifiers with the same name share it.
+	 */
+	const char *name;
 
 	int kind;  	
 	int level;
@@ -181,7 +236,6 @@ struct tag_indentinfo
 	int address;
 	BOOL is_this;
 	BOOL is_param;
-	BOOL was_null;
 	BOOL has_default;
 	BOOL clean;
 	
@@ -196,10 +250,25 @@ struct tag_indentinfo
 };
 
 
+/*
+ * Result of compiling an expression.
+ */
 struct tag_exp_res
 {	
 	int type;	
-	identinfo_t ident;
+
+	/*
+	 * The identifier (or type) the result has the type of.  This is never
+	 * NULL: results with no identifier (such as m_empty_res) point at
+	 * m_no_ident.  The identifier is shared, so it mustn't be changed
+	 * through here.
+	 */
+	identinfo_t *ident_p;
+
+	/*
+	 * The result was cast from null.
+	 */
+	BOOL was_null;
 };
 
 struct tag_var_function
@@ -209,8 +278,18 @@ struct tag_var_function
 	int params_num;
 	identinfo_t *default_p;
 	
-	identinfo_t params[32];	
+	/*
+	 * Params (see var_function_param), with room for params_size of them.
+	 */
+	identinfo_t *params;
+	int params_size;
 	identinfo_t return_var;
+
+	/*
+	 * Most stack the function uses, locals included (worked out once the
+	 * function has been compiled).
+	 */
+	int stack_size;
 };
 
 struct tag_var_array
@@ -265,8 +344,13 @@ int m_number_of_errors;
 BOOL m_ignore_esc_chars;
 identinfo_t m_literal_string;
 int m_line_count;
-char m_line[1024];
-char m_last_line[1024];
+
+/*
+ * The current and previous source lines.  They point into the source
+ * texts and end with a new line.
+ */
+const char *m_line_p;
+const char *m_last_line_p;
 int m_instructions_index;
 float m_number;
 tag_t m_empty_tag;
@@ -278,27 +362,57 @@ char m_string[MAX_LITERAL_STRING_LEN];
 int m_string_length;
 char m_ident_name[MAX_IDENT_LEN + 1];
 instruction_t m_instructions[MAX_INSTRUCTIONS];
+function_symbol_t m_function_symbols[MAX_FUNCTION_SYMBOLS];
+int m_function_symbols_num;
+char m_symbol_names[MAX_SYMBOL_NAMES];
+int m_symbol_names_size;
 identinfo_t m_idents[MAX_IDENTS];
 identinfo_t *m_level_gcidents[MAX_IDENTS];
 int m_num_level_gcidents;
 
+/*
+ * Hash index over m_idents (see ident_index_add).  Each bucket is a chain
+ * of identifier positions linked through m_ident_links (IDENT_INDEX_SIZE
+ * must be a power of 2).
+ */
+int m_ident_buckets[IDENT_INDEX_SIZE];
+int m_ident_links[MAX_IDENTS];
+unsigned int m_ident_hashes[MAX_IDENTS];
+int m_ident_top;
+
+/*
+ * Identifiers the results below point at.  m_no_ident is for results with
+ * no identifier.
+ */
+identinfo_t m_no_ident;
+identinfo_t m_boolean_ident;
+identinfo_t m_character_ident;
+identinfo_t m_string_ident;
+identinfo_t m_bignumber_ident;
+
 exp_res_t exp_float;
 exp_res_t exp_integer;
+exp_res_t exp_boolean;
+exp_res_t exp_character;
 exp_res_t exp_unknown;
 exp_res_t exp_string;
 exp_res_t exp_bignumber;
 exp_res_t m_empty_res;
 exp_res_t m_exp_null;
+
+/*
+ * Interned identifier names (see name_intern).
+ */
+hashtable_t *m_names_p;
 char m_message[MAX_IDENT_LEN * 2];
 
-hashtable_t *m_syms_p;
 hashtable_t *m_types_p;
-hashtable_t *m_nonalpha_syms_p;
 
 
 
 
 BOOL load_file(const char *file);
+void source_texts_free();
 void error(int number);
 void get_symbol();
 void error_extra(int number, char *extra, BOOL show_code, BOOL last_line);
@@ -314,6 +428,11 @@ void identinfo_delete(identinfo_t *ident_p);
 void identinfo_delete(identinfo_t *ident_p);
 void memory_addref(identinfo_t *ident_p, int level, int *ptx);
 void memory_release(identinfo_t *ident_p, int level, int *ptx);
+void memory_release_range(int address, int count, int *ptx);
+BOOL bounds_check_loop_begin(identinfo_t *counter_p, int level, int becomes_start, int to_start, int to_end, BOOL step, int *ptx);
+void bounds_check_loop_body(int level, int body_start, int *ptx);
+void bounds_check_loop_end(int level, int count_up_jump);
+void bounds_check_site_add(identinfo_t *ident_p, int level, int index_start);
 void ident_read_type(identinfo_t *ident_p, int level, int *ptx);
 char escape_char(char ch, BOOL *read_char);
 int condition_operator(int symbol, int kind, tag_t tag);
@@ -325,8 +444,10 @@ void statement(int level, int *ptx, int *pdx, identinfo_t *ident_p);
 exp_res_t statement_becomes(identinfo_t *ident_p, int level, int *ptx, BOOL push, tag_t tag);
 BOOL signatures_match(var_function_t *func_p1, var_function_t *func_p2);
 identinfo_t *ident_add_any(identinfo_t *ident_p, int *ptx, int *pdx);
-word_t *add_symbol(hashtable_t *hashtable_p, const char* name_p, UINT symbol);
 var_function_t *var_function_clone(var_function_t *function_p);
+identinfo_t *var_function_param(var_function_t *function_p, int index);
+identinfo_t *var_function_param_add(var_function_t *function_p, int index);
+const char *name_intern(const char *name);
 identinfo_t *ident_process_var(int level, int *ptx, int *pdx, BOOL byref, BOOL statement);
 var_array_t *var_array_clone(var_array_t *array_p);
 BOOL can_be_string(identinfo_t *ident_p);
@@ -360,8 +481,12 @@ void load_new_array(const int *string, int level, int *ptx);
 void block_var(int level, int *ptx, int *pdx, BOOL statement);
 void set_defaults(int level, int *ptx, int sx, int ex);
 void instructions_add(int f, int l, LONGLONG a);
+int function_symbol_add(const char *name, int address);
+void ident_index_reset();
+void ident_index_add(int i);
+int function_stack_size(int start, int locals);
 void pop_kind(int kind, int level, int *ptx);
-identinfo_t *ident_find(char *name, int *ptx);
+identinfo_t *ident_find(const char *name, int *ptx);
 void pass_or_return_function(identinfo_t *ident_p, int level, int *ptx);
 void load_array_memory_address(identinfo_t *ident_p, int level, int *ptx);
 void load_ident(identinfo_t* ident_p, int level, int *ptx);
@@ -378,7 +503,7 @@ exp_res_t expression_lambda(int level, int *ptx);
 #define MAX(a, b)	((a > b) ? a : b)
 #define MIN(a, b)	((a < b) ? a : b)
 
-#define SET_EXP_RES(er, id) er.type = (id).kind; er.ident = id;
+#define SET_EXP_RES(er, id) er.type = (id).kind; er.ident_p = &(id); er.was_null = FALSE;
 
 
 #endif
@@ -0,0 +1,784 @@
+/*
+ * @file decoder.c
+ *
+ * @description
+ *
+ * Decodes P++ machine instructions into the internal instruction stream
+ * that the interpretor executes.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "types.h"
+#include "symbols.h"
+#include "decoder.h"
+#include "verifier.h"
+
+/*
+ * Matches any operand in a superinstruction pattern.
+ */
+#define ANY_OPERAND		0x7FFFFFFF
+
+/*
+ * Longest chain of jumps followed when threading jumps.
+ */
+#define MAX_JUMP_CHAIN		16
+
+/*
+ * Names of the internal opcodes (used by the profiler).
+ */
+static const char *m_iop_names[IOP_COUNT] =
+{
+	[IOP_UNKNOWN] = "UNKNOWN",
+	[IOP_NOP] = "NOP",
+	[IOP_LIT] = "LIT",
+	[IOP_LOD] = "LOD",
+	[IOP_STO] = "STO",
+	[IOP_CAL] = "CAL",
+	[IOP_TAC] = "TAC",
+	[IOP_INC] = "INC",
+	[IOP_JMP] = "JMP",
+	[IOP_JPC] = "JPC",
+	[IOP_STP] = "STP",
+	[IOP_LID] = "LID",
+	[IOP_LDA] = "LDA",
+	[IOP_SID] = "SID",
+	[IOP_DEC] = "DEC",
+	[IOP_CAI] = "CAI",
+	[IOP_CII] = "CII",
+	[IOP_CAS] = "CAS",
+	[IOP_SLD] = "SLD",
+	[IOP_SWS] = "SWS",
+	[IOP_LIS] = "LIS",
+	[IOP_TRM] = "TRM",
+	[IOP_ISL] = "ISL",
+	[IOP_ISR] = "ISR",
+	[IOP_IAD] = "IAD",
+	[IOP_ISU] = "ISU",
+	[IOP_IMU] = "IMU",
+	[IOP_IDI] = "IDI",
+	[IOP_IXO] = "IXO",
+	[IOP_IOR] = "IOR",
+	[IOP_IAN] = "IAN",
+	[IOP_IZL] = "IZL",
+	[IOP_IZR] = "IZR",
+	[IOP_IIA] = "IIA",
+	[IOP_IIS] = "IIS",
+	[IOP_IIM] = "IIM",
+	[IOP_IID] = "IID",
+	[IOP_IIX] = "IIX",
+	[IOP_IIO] = "IIO",
+	[IOP_IIB] = "IIB",
+	[IOP_SRV] = "SRV",
+	[IOP_LRV] = "LRV",
+	[IOP_ENTER] = "ENTER",
+	[IOP_MAL] = "MAL",
+	[IOP_FRE] = "FRE",
+	[IOP_RAL] = "RAL",
+	[IOP_MSZ] = "MSZ",
+	[IOP_MLS] = "MLS",
+	[IOP_MSS] = "MSS",
+	[IOP_MLO] = "MLO",
+	[IOP_MST] = "MST",
+	[IOP_MLI] = "MLI",
+	[IOP_MSI] = "MSI",
+	[IOP_MCP] = "MCP",
+	[IOP_SLC] = "SLC",
+	[IOP_ARF] = "ARF",
+	[IOP_RLS] = "RLS",
+	[IOP_RLM] = "RLM",
+	[IOP_ACK] = "ACK",
+	[IOP_POP] = "POP",
+	[IOP_PUS] = "PUS",
+	[IOP_MOV] = "MOV",
+	[IOP_RIO] = "RIO",
+	[IOP_PAS] = "PAS",
+	[IOP_SRG] = "SRG",
+	[IOP_TME] = "TME",
+	[IOP_WRT] = "WRT",
+	[IOP_WRF] = "WRF",
+	[IOP_WRB] = "WRB",
+	[IOP_DEB] = "DEB",
+	[IOP_CLK] = "CLK",
+	[IOP_CLI] = "CLI",
+	[IOP_REB] = "REB",
+	[IOP_RCH] = "RCH",
+	[IOP_WRA] = "WRA",
+	[IOP_RDL] = "RDL",
+	[IOP_RDB] = "RDB",
+	[IOP_RDA] = "RDA",
+	[IOP_ENV] = "ENV",
+	[IOP_FOF] = "FOF",
+	[IOP_FCF] = "FCF",
+	[IOP_EOF] = "EOF",
+	[IOP_FMP] = "FMP",
+	[IOP_RET] = "RET",
+	[IOP_NOT_I] = "NOT_I",
+	[IOP_ADD_I] = "ADD_I",
+	[IOP_SUB_I] = "SUB_I",
+	[IOP_MUL_I] = "MUL_I",
+	[IOP_DIV_I] = "DIV_I",
+	[IOP_MOD_I] = "MOD_I",
+	[IOP_ODD_I] = "ODD_I",
+	[IOP_NEG_I] = "NEG_I",
+	[IOP_EQL_I] = "EQL_I",
+	[IOP_NEQ_I] = "NEQ_I",
+	[IOP_LES_I] = "LES_I",
+	[IOP_LEQ_I] = "LEQ_I",
+	[IOP_GRE_I] = "GRE_I",
+	[IOP_GRQ_I] = "GRQ_I",
+	[IOP_SHL_I] = "SHL_I",
+	[IOP_SHR_I] = "SHR_I",
+	[IOP_BOR_I] = "BOR_I",
+	[IOP_AND_I] = "AND_I",
+	[IOP_XOR_I] = "XOR_I",
+	[IOP_ADD_F] = "ADD_F",
+	[IOP_SUB_F] = "SUB_F",
+	[IOP_MUL_F] = "MUL_F",
+	[IOP_DIV_F] = "DIV_F",
+	[IOP_EQL_F] = "EQL_F",
+	[IOP_NEQ_F] = "NEQ_F",
+	[IOP_LES_F] = "LES_F",
+	[IOP_LEQ_F] = "LEQ_F",
+	[IOP_GRE_F] = "GRE_F",
+	[IOP_GRQ_F] = "GRQ_F",
+	[IOP_INT_F] = "INT_F",
+	[IOP_FLO_F] = "FLO_F",
+	[IOP_NEG_F] = "NEG_F",
+	[IOP_LIT_CAL] = "LIT_CAL",
+	[IOP_ENTER_LIS] = "ENTER_LIS",
+	[IOP_LOD_STP] = "LOD_STP",
+	[IOP_SRV_RET] = "SRV_RET",
+	[IOP_LOD_LIT] = "LOD_LIT",
+	[IOP_LIT_ADD] = "LIT_ADD",
+	[IOP_LIT_SUB] = "LIT_SUB",
+	[IOP_LIT_EQL] = "LIT_EQL",
+	[IOP_BOOL] = "BOOL",
+	[IOP_LNOT] = "LNOT",
+	[IOP_LOD_LIT_ADD_STO] = "LOD_LIT_ADD_STO",
+	[IOP_EQL_JPC] = "EQL_JPC",
+	[IOP_NEQ_JPC] = "NEQ_JPC",
+	[IOP_LES_JPC] = "LES_JPC",
+	[IOP_LEQ_JPC] = "LEQ_JPC",
+	[IOP_GRE_JPC] = "GRE_JPC",
+	[IOP_GRQ_JPC] = "GRQ_JPC",
+	[IOP_LOD_LOD_EQL_JPC] = "LOD_LOD_EQL_JPC",
+	[IOP_LOD_LOD_NEQ_JPC] = "LOD_LOD_NEQ_JPC",
+	[IOP_LOD_LOD_LES_JPC] = "LOD_LOD_LES_JPC",
+	[IOP_LOD_LOD_LEQ_JPC] = "LOD_LOD_LEQ_JPC",
+	[IOP_LOD_LOD_GRE_JPC] = "LOD_LOD_GRE_JPC",
+	[IOP_LOD_LOD_GRQ_JPC] = "LOD_LOD_GRQ_JPC",
+	[IOP_LOD_LIT_EQL] = "LOD_LIT_EQL",
+	[IOP_INC_U] = "INC_U",
+	[IOP_CAL_U] = "CAL_U",
+	[IOP_LIT_CAL_U] = "LIT_CAL_U",
+	[IOP_MLO_U] = "MLO_U",
+	[IOP_MST_U] = "MST_U",
+	[IOP_HNW] = "HNW",
+	[IOP_HFR] = "HFR",
+	[IOP_HPT] = "HPT",
+	[IOP_HGT] = "HGT",
+	[IOP_HRM] = "HRM",
+	[IOP_HCT] = "HCT",
+};
+
+typedef struct tag_superinstruction superinstruction_t;
+
+struct tag_superinstruction
+{
+	/*
+	 * The fused internal opcode.
+	 */
+	int op;
+
+	int length;
+
+	/*
+	 * The internal opcodes and operands (or ANY_OPERAND) of the
+	 * sequence being replaced.
+	 */
+	int ops[SUPERINSTRUCTION_MAX_LENGTH];
+	int operands[SUPERINSTRUCTION_MAX_LENGTH];
+};
+
+/*
+ * Superinstructions, longest sequences first.
+ *
+ * No sequence contains a call except as its last instruction so return
+ * addresses always land on the start of a sequence.
+ */
+static const superinstruction_t m_superinstructions[] =
+{
+	/* boolate_top: LIT 0; OPR EQL; OPR NOT; LIT 1; OPR AND */
+	{ IOP_BOOL, 5, { IOP_LIT, IOP_EQL_I, IOP_NOT_I, IOP_LIT, IOP_AND_I }, { 0, ANY_OPERAND, ANY_OPERAND, 1, ANY_OPERAND } },
+
+	/* logical_not_top: LIT 0; OPR EQL; LIT 1; OPR AND */
+	{ IOP_LNOT, 4, { IOP_LIT, IOP_EQL_I, IOP_LIT, IOP_AND_I }, { 0, ANY_OPERAND, 1, ANY_OPERAND } },
+
+	/* x := y + n */
+	{ IOP_LOD_LIT_ADD_STO, 4, { IOP_LOD, IOP_LIT, IOP_ADD_I, IOP_STO }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+
+	/* Loop and if tests comparing two variables */
+	{ IOP_LOD_LOD_EQL_JPC, 4, { IOP_LOD, IOP_LOD, IOP_EQL_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LOD_NEQ_JPC, 4, { IOP_LOD, IOP_LOD, IOP_NEQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LOD_LES_JPC, 4, { IOP_LOD, IOP_LOD, IOP_LES_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LOD_LEQ_JPC, 4, { IOP_LOD, IOP_LOD, IOP_LEQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LOD_GRE_JPC, 4, { IOP_LOD, IOP_LOD, IOP_GRE_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LOD_GRQ_JPC, 4, { IOP_LOD, IOP_LOD, IOP_GRQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+
+	/* x = n */
+	{ IOP_LOD_LIT_EQL, 3, { IOP_LOD, IOP_LIT, IOP_EQL_I }, { ANY_OPERAND, ANY_OPERAND, ANY_OPERAND } },
+
+	/* Any other comparison followed by a conditional jump */
+	{ IOP_EQL_JPC, 2, { IOP_EQL_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_NEQ_JPC, 2, { IOP_NEQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LES_JPC, 2, { IOP_LES_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LEQ_JPC, 2, { IOP_LEQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_GRE_JPC, 2, { IOP_GRE_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_GRQ_JPC, 2, { IOP_GRQ_I, IOP_JPC }, { ANY_OPERAND, ANY_OPERAND } },
+
+	/* Calls: pushing the return value slot, passing parameters and the prologue */
+	{ IOP_LIT_CAL, 2, { IOP_LIT, IOP_CAL }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_STP, 2, { IOP_LOD, IOP_STP }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_ENTER_LIS, 2, { IOP_ENTER, IOP_LIS }, { ANY_OPERAND, ANY_OPERAND } },
+
+	/* return x (the jump to the end of the function has been threaded) */
+	{ IOP_SRV_RET, 2, { IOP_SRV, IOP_RET }, { ANY_OPERAND, ANY_OPERAND } },
+
+	/* Arithmetic and comparisons with a constant */
+	{ IOP_LIT_ADD, 2, { IOP_LIT, IOP_ADD_I }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LIT_SUB, 2, { IOP_LIT, IOP_SUB_I }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LIT_EQL, 2, { IOP_LIT, IOP_EQL_I }, { ANY_OPERAND, ANY_OPERAND } },
+	{ IOP_LOD_LIT, 2, { IOP_LOD, IOP_LIT }, { ANY_OPERAND, ANY_OPERAND } },
+};
+
+#define NUMBER_OF_SUPERINSTRUCTIONS	(sizeof(m_superinstructions) / sizeof(superinstruction_t))
+
+/*
+ * Maps an OPR operation onto its internal opcode.
+ */
+static int decode_opr(int a)
+{
+	switch (a)
+	{
+	case 0:			return IOP_RET;
+	case OPR_NOT:	return IOP_NOT_I;
+	case OPR_ADD:	return IOP_ADD_I;
+	case OPR_SUB:	return IOP_SUB_I;
+	case OPR_MUL:	return IOP_MUL_I;
+	case OPR_DIV:	return IOP_DIV_I;
+	case OPR_MOD:	return IOP_MOD_I;
+	case OPR_ODD:	return IOP_ODD_I;
+	case OPR_NEG:	return IOP_NEG_I;
+	case OPR_EQL:	return IOP_EQL_I;
+	case OPR_NEQ:	return IOP_NEQ_I;
+	case OPR_LES:	return IOP_LES_I;
+	case OPR_LEQ:	return IOP_LEQ_I;
+	case OPR_GRE:	return IOP_GRE_I;
+	case OPR_GRQ:	return IOP_GRQ_I;
+	case OPR_SHL:	return IOP_SHL_I;
+	case OPR_SHR:	return IOP_SHR_I;
+	case OPR_BOR:	return IOP_BOR_I;
+	case OPR_AND:	return IOP_AND_I;
+	case OPR_XOR:	return IOP_XOR_I;
+	}
+
+	return IOP_UNKNOWN;
+}
+
+/*
+ * Maps a FOP operation onto its internal opcode.
+ */
+static int decode_fop(int a)
+{
+	switch (a)
+	{
+	case FOP_ADD:	return IOP_ADD_F;
+	case FOP_SUB:	return IOP_SUB_F;
+	case FOP_MUL:	return IOP_MUL_F;
+	case FOP_DIV:	return IOP_DIV_F;
+	case FOP_EQL:	return IOP_EQL_F;
+	case FOP_NEQ:	return IOP_NEQ_F;
+	case FOP_LES:	return IOP_LES_F;
+	case FOP_LEQ:	return IOP_LEQ_F;
+	case FOP_GRE:	return IOP_GRE_F;
+	case FOP_GRQ:	return IOP_GRQ_F;
+	case FOP_INT:	return IOP_INT_F;
+	case FOP_FLO:	return IOP_FLO_F;
+	case FOP_NEG:	return IOP_NEG_F;
+	}
+
+	return IOP_UNKNOWN;
+}
+
+/*
+ * Maps a P++ machine opcode onto its internal opcode.
+ */
+static int decode_opcode(int f)
+{
+	switch (f)
+	{
+	case OC_NOP:	return IOP_NOP;
+	case OC_LIT:	return IOP_LIT;
+	case OC_LOD:	return IOP_LOD;
+	case OC_STO:	return IOP_STO;
+	case OC_CAL:	return IOP_CAL;
+	case OC_TAC:	return IOP_TAC;
+	case OC_INC:	return IOP_INC;
+	case OC_JMP:	return IOP_JMP;
+	case OC_JPC:	return IOP_JPC;
+	case OC_STP:	return IOP_STP;
+	case OC_LID:	return IOP_LID;
+	case OC_LDA:	return IOP_LDA;
+	case OC_SID:	return IOP_SID;
+	case OC_DEC:	return IOP_DEC;
+	case OC_CAI:	return IOP_CAI;
+	case OC_CII:	return IOP_CII;
+	case OC_CAS:	return IOP_CAS;
+	case OC_SLD:	return IOP_SLD;
+	case OC_SWS:	return IOP_SWS;
+	case OC_LIS:	return IOP_LIS;
+	case OC_TRM:	return IOP_TRM;
+
+	case OC_ISL:	return IOP_ISL;
+	case OC_ISR:	return IOP_ISR;
+	case OC_IAD:	return IOP_IAD;
+	case OC_ISU:	return IOP_ISU;
+	case OC_IMU:	return IOP_IMU;
+	case OC_IDI:	return IOP_IDI;
+	case OC_IXO:	return IOP_IXO;
+	case OC_IOR:	return IOP_IOR;
+	case OC_IAN:	return IOP_IAN;
+
+	case OC_IZL:	return IOP_IZL;
+	case OC_IZR:	return IOP_IZR;
+	case OC_IIA:	return IOP_IIA;
+	case OC_IIS:	return IOP_IIS;
+	case OC_IIM:	return IOP_IIM;
+	case OC_IID:	return IOP_IID;
+	case OC_IIX:	return IOP_IIX;
+	case OC_IIO:	return IOP_IIO;
+	case OC_IIB:	return IOP_IIB;
+
+	case OC_SRV:	return IOP_SRV;
+	case OC_LRV:	return IOP_LRV;
+
+	case OC_MAL:	return IOP_MAL;
+	case OC_FRE:	return IOP_FRE;
+	case OC_RAL:	return IOP_RAL;
+	case OC_MSZ:	return IOP_MSZ;
+	case OC_MLS:	return IOP_MLS;
+	case OC_MSS:	return IOP_MSS;
+	case OC_MLO:	return IOP_MLO;
+	case OC_MST:	return IOP_MST;
+	case OC_MLI:	return IOP_MLI;
+	case OC_MSI:	return IOP_MSI;
+	case OC_MCP:	return IOP_MCP;
+	case OC_SLC:	return IOP_SLC;
+
+	case OC_ARF:	return IOP_ARF;
+	case OC_RLS:	return IOP_RLS;
+	case OC_RLM:	return IOP_RLM;
+
+	case OC_ACK:	return IOP_ACK;
+
+	case OC_POP:	return IOP_POP;
+	case OC_PUS:	return IOP_PUS;
+	case OC_MOV:	return IOP_MOV;
+	case OC_RIO:	return IOP_RIO;
+	case OC_PAS:	return IOP_PAS;
+	case OC_SRG:	return IOP_SRG;
+
+	case OC_TME:	return IOP_TME;
+	case OC_WRT:	return IOP_WRT;
+	case OC_WRF:	return IOP_WRF;
+	case OC_WRB:	return IOP_WRB;
+	case OC_WCH:	return IOP_WRB;
+	case OC_DEB:	return IOP_DEB;
+	case OC_CLK:	return IOP_CLK;
+	case OC_CLI:	return IOP_CLI;
+	case OC_REB:	return IOP_REB;
+	case OC_RCH:	return IOP_RCH;
+	case OC_WRA:	return IOP_WRA;
+	case OC_RDL:	return IOP_RDL;
+	case OC_RDB:	return IOP_RDB;
+	case OC_RDA:	return IOP_RDA;
+	case OC_ENV:	return IOP_ENV;
+
+	case OC_FOF:	return IOP_FOF;
+	case OC_FCF:	return IOP_FCF;
+	case OC_EOF:	return IOP_EOF;
+	case OC_FMP:	return IOP_FMP;
+
+	case OC_HNW:	return IOP_HNW;
+	case OC_HFR:	return IOP_HFR;
+	case OC_HPT:	return IOP_HPT;
+	case OC_HGT:	return IOP_HGT;
+	case OC_HRM:	return IOP_HRM;
+	case OC_HCT:	return IOP_HCT;
+	}
+
+	/*
+	 * Unknown instructions are only an error if they're executed.
+	 */
+	return IOP_UNKNOWN;
+}
+
+/*
+ * Points jumps that land on another jump straight at the final target.
+ * A jump to the end of a function becomes the return itself.
+ */
+static void thread_jumps(decoded_instruction_t *decoded_p, int len)
+{
+	int i, j, target;
+
+	for (i = 1; i < len; i++)
+	{
+		if (decoded_p[i].op != IOP_JMP && decoded_p[i].op != IOP_JPC)
+		{
+			continue;
+		}
+
+		target = decoded_p[i].a;
+
+		for (j = 0; j < MAX_JUMP_CHAIN; j++)
+		{
+			if (target <= 0 || target >= len || decoded_p[target].op != IOP_JMP)
+			{
+				break;
+			}
+
+			target = decoded_p[target].a;
+		}
+
+		if (target <= 0 || target >= len)
+		{
+			continue;
+		}
+
+		decoded_p[i].a = target;
+
+		if (decoded_p[i].op == IOP_JMP && decoded_p[target].op == IOP_RET)
+		{
+			decoded_p[i].op = IOP_RET;
+		}
+	}
+}
+
+/*
+ * Marks every instruction that control can be transferred to other than
+ * by falling through from the instruction before it.
+ */
+static void mark_targets(decoded_instruction_t *decoded_p, int len, char *targets_p)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		switch (decoded_p[i].op)
+		{
+		case IOP_JMP:
+		case IOP_JPC:
+		case IOP_CAL:
+		case IOP_TAC:
+
+			if (decoded_p[i].a >= 0 && decoded_p[i].a < len)
+			{
+				targets_p[decoded_p[i].a] = 1;
+			}
+
+			break;
+		}
+
+		/*
+		 * Return addresses.
+		 */
+		switch (decoded_p[i].op)
+		{
+		case IOP_CAL:
+		case IOP_CAI:
+		case IOP_CII:
+		case IOP_CAS:
+
+			targets_p[i + 1] = 1;
+
+			break;
+		}
+	}
+}
+
+/*
+ * Tests if a superinstruction's sequence starts at an instruction.
+ */
+static int superinstruction_matches(const superinstruction_t *super_p, decoded_instruction_t *decoded_p, int len, char *targets_p, int i)
+{
+	int j;
+
+	if (i + super_p->length > len)
+	{
+		return 0;
+	}
+
+	for (j = 0; j < super_p->length; j++)
+	{
+		if (decoded_p[i + j].op != super_p->ops[j])
+		{
+			return 0;
+		}
+
+		if (super_p->operands[j] != ANY_OPERAND && decoded_p[i + j].a != super_p->operands[j])
+		{
+			return 0;
+		}
+
+		/*
+		 * Can't fuse over an instruction that's jumped to.
+		 */
+		if (j > 0 && targets_p[i + j])
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Rewrites the first instruction of common sequences into superinstructions.
+ * The rest of each sequence is left in place so instruction indexes and
+ * operands don't change.
+ */
+static void fuse_superinstructions(decoded_instruction_t *decoded_p, int len)
+{
+	int i, j;
+	char *targets_p;
+
+	targets_p = CALLOC(char, len + 1);
+
+	if (!targets_p)
+	{
+		return;
+	}
+
+	thread_jumps(decoded_p, len);
+	mark_targets(decoded_p, len, targets_p);
+
+	for (i = 0; i < len; i++)
+	{
+		for (j = 0; j < (int)NUMBER_OF_SUPERINSTRUCTIONS; j++)
+		{
+			if (superinstruction_matches(&m_superinstructions[j], decoded_p, len, targets_p, i))
+			{
+				decoded_p[i].op = m_superinstructions[j].op;
+				i += m_superinstructions[j].length - 1;
+
+				break;
+			}
+		}
+	}
+
+	free(targets_p);
+}
+
+/*
+ * Switches a verified program over to the unchecked variants of the
+ * instructions whose checks the verifier made redundant.
+ */
+static void remove_checks(decoded_instruction_t *decoded_p, int len, const char *handles_checked_p)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		switch (decoded_p[i].op)
+		{
+		case IOP_INC:
+
+			decoded_p[i].op = IOP_INC_U;
+
+			break;
+
+		case IOP_CAL:
+
+			decoded_p[i].op = IOP_CAL_U;
+
+			break;
+
+		case IOP_LIT_CAL:
+
+			decoded_p[i].op = IOP_LIT_CAL_U;
+
+			break;
+
+		case IOP_MLO:
+
+			if (handles_checked_p[i])
+			{
+				decoded_p[i].op = IOP_MLO_U;
+			}
+
+			break;
+
+		case IOP_MST:
+
+			if (handles_checked_p[i])
+			{
+				decoded_p[i].op = IOP_MST_U;
+			}
+
+			break;
+		}
+	}
+}
+
+/*
+ * Decodes a single P++ machine instruction (without its handler).
+ *
+ * @returns FALSE if an operand doesn't fit in a decoded instruction.
+ */
+BOOL decode_instruction(const instruction_t *ip, decoded_instruction_t *decoded_p)
+{
+	int l, a;
+
+	/*
+	 * OPR and FOP are flattened so that the interpretor never has to
+	 * dispatch a second time on the operand.
+	 */
+
+	switch (ip->f)
+	{
+	case OC_OPR:
+
+		decoded_p->op = decode_opr((int)ip->a);
+
+		break;
+
+	case OC_FOP:
+
+		decoded_p->op = decode_fop((int)ip->a);
+
+		break;
+
+	case OC_INC:
+
+		decoded_p->op = ip->l ? IOP_ENTER : IOP_INC;
+
+		break;
+
+	default:
+
+		decoded_p->op = decode_opcode(ip->f);
+	}
+
+	l = ip->l;
+	a = (int)ip->a;
+
+	/*
+	 * The value a register is set to can be large (eg. an index into
+	 * a long literal string) so it goes in a and the register in l.
+	 */
+	if (decoded_p->op == IOP_SRG || decoded_p->op == IOP_RIO)
+	{
+		l = a;
+		a = ip->l;
+	}
+
+	if (l < DECODED_L_MIN || l > DECODED_L_MAX)
+	{
+		return FALSE;
+	}
+
+	decoded_p->l = (short)l;
+	decoded_p->a = a;
+
+	return TRUE;
+}
+
+/*
+ * Decodes a block of P++ machine instructions.
+ *
+ * @returns A new instruction stream the same length as the code
+ *			(free with decoded_delete) or NULL if out of memory or an
+ *			operand doesn't fit in a decoded instruction.
+ */
+decoded_instruction_t *decode(instruction_t *code, int len)
+{
+	int i, address;
+	const char *reason;
+	char *handles_checked_p;
+	decoded_instruction_t *decoded_p;
+
+	decoded_p = CALLOC(decoded_instruction_t, len + 1);
+
+	if (!decoded_p)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		if (!decode_instruction(&code[i], &decoded_p[i]))
+		{
+			printf("Operand out of range at instruction %d.\n", i);
+
+			free(decoded_p);
+
+			return NULL;
+		}
+	}
+
+	reason = NULL;
+	handles_checked_p = NULL;
+	address = 0;
+
+	if (m_options.verify)
+	{
+		handles_checked_p = CALLOC(char, len + 1);
+
+		reason = handles_checked_p ? verify(decoded_p, len, handles_checked_p, &address) : "out of memory";
+
+		if (reason && m_options.verbose)
+		{
+			printf("Not verified (%s at instruction 0x%x), running with all checks.\n", reason, address);
+		}
+	}
+
+	/*
+	 * Superinstructions are left out when tracing so that the trace
+	 * follows the machine instructions.
+	 */
+	if (m_options.superinstructions && !m_options.trace_stack)
+	{
+		fuse_superinstructions(decoded_p, len);
+	}
+
+	if (m_options.verify && !reason)
+	{
+		remove_checks(decoded_p, len, handles_checked_p);
+	}
+
+	free(handles_checked_p);
+
+	return decoded_p;
+}
+
+/*
+ * Frees an instruction stream created by decode.
+ */
+void decoded_delete(decoded_instruction_t *code_p)
+{
+	free(code_p);
+}
+
+/*
+ * Returns the name of an internal opcode.
+ */
+const char *decoded_opcode_name(int op)
+{
+	if (op < 0 || op >= IOP_COUNT || !m_iop_names[op])
+	{
+		return "???";
+	}
+
+	return m_iop_names[op];
+}
@@ -0,0 +1,302 @@
+/*
+ * @file decoder.h
+ *
+ * @description
+ *
+ * Pre-decoded instruction stream executed by the interpretor.
+ *
+ * The compiler and .pins files only ever deal with the sparse OC_* opcodes.
+ * Before a program is run the instructions are decoded into a parallel
+ * stream of dense internal opcodes (IOP_*) which the interpretor can
+ * dispatch on directly.  Instruction indexes are preserved so jump targets
+ * and return addresses don't need to be translated.
+ *
+ * Operations that the machine encodes as a sub-opcode in the operand (OPR
+ * and FOP) are flattened into their own internal opcodes.  Listings made
+ * with print_out_code still show the original machine instructions.
+ *
+ * Decoded instructions are packed so hot loops take as little cache as
+ * possible: 16 bytes with a handler address and 8 bytes without (against
+ * the 16 bytes of an instruction_t on 64 bit machines).  The opcode takes
+ * a byte and l is 16 bits, which is enough for every level, count and
+ * frame size the compiler can generate (they're bounded by MAX_LEVEL and
+ * MAX_IDENTS).  The only wide l operand, the value a register is set to,
+ * is swapped into a by the decoder (SRG and RIO take the register in l).
+ */
+
+#ifndef __DECODER_H
+#define __DECODER_H
+
+#include "compiler.h"
+
+/*
+ * GCC (and compatible compilers) support taking the address of a label
+ * which allows the interpretor to use direct threaded dispatch.  Everything
+ * else falls back to a portable switch based dispatch loop.
+ */
+#if defined(__GNUC__) && !defined(NO_THREADED_CODE)
+#define THREADED_CODE
+#endif
+
+/*
+ * Internal opcodes.
+ */
+#define IOP_UNKNOWN			0x00
+#define IOP_NOP				0x01
+#define IOP_LIT				0x02
+#define IOP_LOD				0x03
+#define IOP_STO				0x04
+#define IOP_CAL				0x05
+#define IOP_TAC				0x06
+#define IOP_INC				0x07
+#define IOP_JMP				0x08
+#define IOP_JPC				0x09
+#define IOP_STP				0x0A
+#define IOP_LID				0x0B
+#define IOP_LDA				0x0C
+#define IOP_SID				0x0D
+#define IOP_DEC				0x0E
+#define IOP_CAI				0x0F
+#define IOP_CII				0x10
+#define IOP_CAS				0x11
+#define IOP_SLD				0x12
+#define IOP_SWS				0x13
+#define IOP_LIS				0x14
+#define IOP_TRM				0x15
+
+/*
+ * Inline operations.
+ */
+#define IOP_ISL				0x16
+#define IOP_ISR				0x17
+#define IOP_IAD				0x18
+#define IOP_ISU				0x19
+#define IOP_IMU				0x1A
+#define IOP_IDI				0x1B
+#define IOP_IXO				0x1C
+#define IOP_IOR				0x1D
+#define IOP_IAN				0x1E
+
+/*
+ * Inline indirect operations.
+ */
+#define IOP_IZL				0x1F
+#define IOP_IZR				0x20
+#define IOP_IIA				0x21
+#define IOP_IIS				0x22
+#define IOP_IIM				0x23
+#define IOP_IID				0x24
+#define IOP_IIX				0x25
+#define IOP_IIO				0x26
+#define IOP_IIB				0x27
+
+/*
+ * Function operations (a function's entry INC, which carries the frame
+ * size in l, is decoded as IOP_ENTER).
+ */
+#define IOP_SRV				0x28
+#define IOP_LRV				0x29
+#define IOP_ENTER			0x2A
+
+/*
+ * Memory operations.
+ */
+#define IOP_MAL				0x2B
+#define IOP_FRE				0x2C
+#define IOP_RAL				0x2D
+#define IOP_MSZ				0x2E
+#define IOP_MLS				0x2F
+#define IOP_MSS				0x30
+#define IOP_MLO				0x31
+#define IOP_MST				0x32
+#define IOP_MLI				0x33
+#define IOP_MSI				0x34
+#define IOP_MCP				0x35
+#define IOP_SLC				0x36
+
+/*
+ * Reference counting operations.
+ */
+#define IOP_ARF				0x37
+#define IOP_RLS				0x38
+#define IOP_RLM				0x39
+
+/*
+ * Array operations.
+ */
+#define IOP_ACK				0x3A
+
+/*
+ * Register operations.
+ */
+#define IOP_POP				0x3B
+#define IOP_PUS				0x3C
+#define IOP_MOV				0x3D
+#define IOP_RIO				0x3E
+#define IOP_PAS				0x3F
+#define IOP_SRG				0x40
+
+/*
+ * Utility operations (OC_WCH is decoded as IOP_WRB).
+ */
+#define IOP_TME				0x41
+#define IOP_WRT				0x42
+#define IOP_WRF				0x43
+#define IOP_WRB				0x44
+#define IOP_DEB				0x45
+#define IOP_CLK				0x46
+#define IOP_CLI				0x47
+#define IOP_REB				0x48
+#define IOP_RCH				0x49
+#define IOP_WRA				0x4A
+#define IOP_RDL				0x4B
+#define IOP_RDB				0x4C
+#define IOP_RDA				0x4D
+#define IOP_ENV				0x4E
+
+/*
+ * File/Stream operations.
+ */
+#define IOP_FOF				0x4F
+#define IOP_FCF				0x50
+#define IOP_EOF				0x51
+#define IOP_FMP				0x52
+
+/*
+ * Integer arithmetic and logical operations (decoded from OC_OPR by its
+ * operand, with OPR 0 0 becoming IOP_RET).
+ */
+#define IOP_RET				0x53
+#define IOP_NOT_I			0x54
+#define IOP_ADD_I			0x55
+#define IOP_SUB_I			0x56
+#define IOP_MUL_I			0x57
+#define IOP_DIV_I			0x58
+#define IOP_MOD_I			0x59
+#define IOP_ODD_I			0x5A
+#define IOP_NEG_I			0x5B
+#define IOP_EQL_I			0x5C
+#define IOP_NEQ_I			0x5D
+#define IOP_LES_I			0x5E
+#define IOP_LEQ_I			0x5F
+#define IOP_GRE_I			0x60
+#define IOP_GRQ_I			0x61
+#define IOP_SHL_I			0x62
+#define IOP_SHR_I			0x63
+#define IOP_BOR_I			0x64
+#define IOP_AND_I			0x65
+#define IOP_XOR_I			0x66
+
+/*
+ * Floating point operations (decoded from OC_FOP by its operand).
+ */
+#define IOP_ADD_F			0x67
+#define IOP_SUB_F			0x68
+#define IOP_MUL_F			0x69
+#define IOP_DIV_F			0x6A
+#define IOP_EQL_F			0x6B
+#define IOP_NEQ_F			0x6C
+#define IOP_LES_F			0x6D
+#define IOP_LEQ_F			0x6E
+#define IOP_GRE_F			0x6F
+#define IOP_GRQ_F			0x70
+#define IOP_INT_F			0x71
+#define IOP_FLO_F			0x72
+#define IOP_NEG_F			0x73
+
+/*
+ * Superinstructions.  The decoder rewrites the first instruction of some
+ * common sequences into one of these and the handler executes the whole
+ * sequence, reading the operands of the instructions that follow it.
+ * They were picked by profiling the example programs (+pr).
+ */
+#define IOP_LIT_CAL			0x74
+#define IOP_ENTER_LIS		0x75
+#define IOP_LOD_STP			0x76
+#define IOP_SRV_RET			0x77
+#define IOP_LOD_LIT			0x78
+#define IOP_LIT_ADD			0x79
+#define IOP_LIT_SUB			0x7A
+#define IOP_LIT_EQL			0x7B
+#define IOP_BOOL			0x7C
+#define IOP_LNOT			0x7D
+#define IOP_LOD_LIT_ADD_STO	0x7E
+#define IOP_EQL_JPC			0x7F
+#define IOP_NEQ_JPC			0x80
+#define IOP_LES_JPC			0x81
+#define IOP_LEQ_JPC			0x82
+#define IOP_GRE_JPC			0x83
+#define IOP_GRQ_JPC			0x84
+#define IOP_LOD_LOD_EQL_JPC	0x85
+#define IOP_LOD_LOD_NEQ_JPC	0x86
+#define IOP_LOD_LOD_LES_JPC	0x87
+#define IOP_LOD_LOD_LEQ_JPC	0x88
+#define IOP_LOD_LOD_GRE_JPC	0x89
+#define IOP_LOD_LOD_GRQ_JPC	0x8A
+#define IOP_LOD_LIT_EQL		0x8B
+
+/*
+ * Unchecked variants used once a program has been verified (see
+ * verifier.h).  The verifier has checked every function's stack use
+ * against its entry and every direct call's target, and that MLO_U and
+ * MST_U follow an ACK that checked the same memory handle.
+ */
+#define IOP_INC_U			0x8C
+#define IOP_CAL_U			0x8D
+#define IOP_LIT_CAL_U		0x8E
+#define IOP_MLO_U			0x8F
+#define IOP_MST_U			0x90
+
+/*
+ * Map operations.
+ */
+#define IOP_HNW				0x91
+#define IOP_HFR				0x92
+#define IOP_HPT				0x93
+#define IOP_HGT				0x94
+#define IOP_HRM				0x95
+#define IOP_HCT				0x96
+
+/*
+ * Number of internal opcodes.
+ */
+#define IOP_COUNT			0x97
+
+#if IOP_COUNT > 0x100
+#error "Internal opcodes must fit in the op byte of a decoded instruction."
+#endif
+
+/*
+ * Range of a decoded instruction's l operand.
+ */
+#define DECODED_L_MIN		-0x8000
+#define DECODED_L_MAX		0x7FFF
+
+typedef struct tag_decoded_instruction decoded_instruction_t;
+
+struct tag_decoded_instruction
+{
+	/*
+	 * Address of the interpretor's handler for this instruction
+	 * (only used with THREADED_CODE).
+	 */
+#ifdef THREADED_CODE
+	const void *handler;
+#endif
+
+	int a;
+	short l;
+	unsigned char op;
+};
+
+/*
+ * Longest sequence of instructions that is fused into a superinstruction.
+ */
+#define SUPERINSTRUCTION_MAX_LENGTH		5
+
+BOOL decode_instruction(const instruction_t *ip, decoded_instruction_t *decoded_p);
+decoded_instruction_t *decode(instruction_t *code, int len);
+void decoded_delete(decoded_instruction_t *code_p);
+const char *decoded_opcode_name(int op);
+
+#endif
@@ -116,6 +116,7 @@ static const error_t compiler_errors[COMPILER_ERRORS_SIZE] =
 	{20000, "program goes too deep"},
 	{30000, "out of instruction space"},
 	{30010, "program too long."},
+	{30020, "out of memory"},
 	{40000, "unsupported big number operation"},
 	{66000, "internal error"},
 };
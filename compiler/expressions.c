@@ -13,8 +13,8 @@ exp_res_t expression(int level, int *ptx, exp_res_t exp_wanted, tag_t tag)
 	exp_res_t exp_res;
 
 	if ((exp_wanted.type == KIND_INTEGER
-		&& exp_wanted.ident.data.int_val.is_handle)
-		|| exp_wanted.ident.clean == TRUE
+		&& exp_wanted.ident_p->data.int_val.is_handle)
+		|| exp_wanted.ident_p->clean == TRUE
 		)
 	{
 		tag.lvalue_nogc = TRUE;
@@ -33,7 +33,7 @@ exp_res_t expression_raw(int level, int *ptx, tag_t tag)
 {
 	exp_res_t exp_res;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	check_expression_start();
 
@@ -216,7 +216,7 @@ exp_res_t expression_cast_op(processing_fn fn, int level, int *ptx, int operatio
 				
 		exp_res.type = KIND_FLOAT;
 	}	
-	else if (can_be_big_number(&left_res.ident)
+	else if (can_be_big_number(left_res.ident_p)
 		&& (exp_res.type == KIND_INTEGER || left_res.type == KIND_FLOAT))
 	{
 		/*
@@ -230,9 +230,9 @@ exp_res_t expression_cast_op(processing_fn fn, int level, int *ptx, int operatio
 
 		exp_res = exp_bignumber;
 	}
-	else if (can_be_big_number(&exp_res.ident)
-		&& can_be_string(&left_res.ident)
-		&& !can_be_big_number(&left_res.ident))
+	else if (can_be_big_number(exp_res.ident_p)
+		&& can_be_string(left_res.ident_p)
+		&& !can_be_big_number(left_res.ident_p))
 	{
 		/*
 		 * String + BigNumber = String
@@ -240,16 +240,16 @@ exp_res_t expression_cast_op(processing_fn fn, int level, int *ptx, int operatio
 
 		return exp_string;
 	}
-	else if (can_be_big_number(&left_res.ident)
-		&& can_be_string(&exp_res.ident)
-		&& !can_be_big_number(&exp_res.ident))
+	else if (can_be_big_number(left_res.ident_p)
+		&& can_be_string(exp_res.ident_p)
+		&& !can_be_big_number(exp_res.ident_p))
 	{
 		/*
 		 * BigNumber + String = String
 		 */
 		return exp_string;
 	}
-	else if (can_be_big_number(&exp_res.ident)
+	else if (can_be_big_number(exp_res.ident_p)
 		&& (left_res.type == KIND_INTEGER ||left_res.type == KIND_FLOAT))
 	{
 		/*
@@ -265,7 +265,7 @@ exp_res_t expression_cast_op(processing_fn fn, int level, int *ptx, int operatio
 
 		exp_res = exp_bignumber;
 	}
-	else if (can_be_string(&exp_res.ident)
+	else if (can_be_string(exp_res.ident_p)
 		&& (left_res.type == KIND_INTEGER || left_res.type == KIND_FLOAT))
 	{
 		if (operation == SYM_PLUS)
@@ -291,7 +291,7 @@ exp_res_t expression_cast_op(processing_fn fn, int level, int *ptx, int operatio
 			stoi(level, ptx);
 		}
 	}
-	else if (can_be_string(&left_res.ident)
+	else if (can_be_string(left_res.ident_p)
 		&& (exp_res.type == KIND_INTEGER || exp_res.type == KIND_FLOAT))
 	{
 		if (operation == SYM_PLUS)
@@ -384,6 +384,8 @@ exp_res_t expression_bitwise(int level, int *ptx, tag_t tag)
  */
 exp_res_t expression_array_element(identinfo_t *ident_p, int level, int *ptx, BOOL aggregate, BOOL push)
 {
+	exp_res_t exp_res;
+
 	ident_p->data.array_val_p->assigning_ref = FALSE;
 
 	array_load_offset(ident_p, level, ptx, aggregate);
@@ -394,7 +396,18 @@ exp_res_t expression_array_element(identinfo_t *ident_p, int level, int *ptx, BO
 	}
 	else
 	{	
-		return expression_pure_array_element(ident_p, level, ptx, aggregate); 
+		exp_res = expression_pure_array_element(ident_p, level, ptx, aggregate); 
+
+		/*
+		 * An element used as a statement (a[i] += 1 etc) leaves its value
+		 * behind, which nothing uses.
+		 */
+		if (!push && !aggregate && (exp_res.type == KIND_INTEGER || exp_res.type == KIND_FLOAT))
+		{
+			pop_kind(exp_res.type, level, ptx);
+		}
+
+		return exp_res;
 	}
 }
 
@@ -408,7 +421,7 @@ exp_res_t expression_pure_array_element(identinfo_t *ident_p, int level, int *pt
 	BOOL func_ag = FALSE;
 	exp_res_t exp_res, exp_res2;
 
-	ZEROMEMORY(exp_res);		
+	exp_res = m_empty_res;		
 	
 	/*
 	 * Put the array index into the CX register.
@@ -469,7 +482,7 @@ exp_res_t expression_pure_array_element(identinfo_t *ident_p, int level, int *pt
 	else
 	{
 		exp_res.type = ident_p->data.array_val_p->contains.kind;
-		exp_res.ident = ident_p->data.array_val_p->contains;
+		exp_res.ident_p = &ident_p->data.array_val_p->contains;
 	}
 
 	if (!func_ag)
@@ -584,7 +597,7 @@ exp_res_t expression_ident(int level, int *ptx, tag_t tag)
 	exp_res_t exp_res;
 	identinfo_t *ident_p;
 
-	ZEROMEMORY(exp_res);	
+	exp_res = m_empty_res;	
 
 	ident_p = ident_find((char*)m_ident_name, ptx);
 
@@ -644,7 +657,7 @@ exp_res_t expression_ident(int level, int *ptx, tag_t tag)
 				error(4208);				
 			}	
 			
-			exp_res.ident = *ident_p;
+			exp_res.ident_p = ident_p;
 
 			return exp_res;
 		}
@@ -690,7 +703,7 @@ exp_res_t expression_ident(int level, int *ptx, tag_t tag)
 						if (!(m_symbol == SYM_SEMICOLON && statement))
 						{
 							exp_res.type = KIND_ARRAY;
-							exp_res.ident = *ident_p;
+							exp_res.ident_p = ident_p;
 
 							/*
 							 * Don't addref when a handle is wanted cause handles
@@ -771,9 +784,22 @@ exp_res_t expression_ident(int level, int *ptx, tag_t tag)
 					{
 						load_ident(ident_p, level, ptx);
 					}
+
+					expression_ident_unary(level, ptx, exp_res);
 				}
+				else
+				{
+					expression_ident_unary(level, ptx, exp_res);
 
-				expression_ident_unary(level, ptx, exp_res);
+					/*
+					 * The other unary operators (+= etc) load the new value,
+					 * which a statement doesn't use.
+					 */
+					if (statement)
+					{
+						pop_kind(exp_res.type, level, ptx);
+					}
+				}
 			}
 			else
 			{
@@ -1104,8 +1130,8 @@ exp_res_t expression_inner(int level, int *ptx, tag_t tag)
 	identinfo_t *ident_p;
 	exp_res_t exp_res, cast_exp_res;
 
-	ZEROMEMORY(exp_res);
-	ZEROMEMORY(cast_exp_res);
+	exp_res = m_empty_res;
+	cast_exp_res = m_empty_res;
 
 	get_symbol();
 
@@ -1156,11 +1182,11 @@ exp_res_t expression_inner(int level, int *ptx, tag_t tag)
 				
 				if (m_symbol == SYM_CHARACTER)
 				{
-					cast_exp_res.ident.data.int_val.is_character = TRUE;
+					cast_exp_res = exp_character;
 				}
 				else if (m_symbol == SYM_BOOLEAN)
 				{
-					cast_exp_res.ident.data.int_val.is_boolean = TRUE;
+					cast_exp_res = exp_boolean;
 				}
 								
 				break;
@@ -1228,7 +1254,7 @@ exp_res_t expression_unary_left(int level, int *ptx, tag_t tag)
 	identinfo_t *ident_p;
 	exp_res_t exp_res;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 
 	symbol = m_symbol;
 	get_symbol();
@@ -1311,7 +1337,7 @@ exp_res_t expression_operand(int level, int *ptx, tag_t tag)
 	int kind, sign;
 	int symbol;
 
-	ZEROMEMORY(exp_res);
+	exp_res = m_empty_res;
 	
 	for(;;)
 	{
@@ -1345,7 +1371,7 @@ exp_res_t expression_operand(int level, int *ptx, tag_t tag)
 			
 			if (symbol == SYM_LITERAL_BIGNUMBER)
 			{	
-				SET_EXP_RES(exp_res, exp_bignumber.ident);
+				exp_res = exp_bignumber;
 			}
 			else
 			{
@@ -1431,7 +1457,7 @@ exp_res_t expression_operand(int level, int *ptx, tag_t tag)
 
 			if (sign % 2)
 			{
-				if (can_be_big_number(&exp_res.ident))
+				if (can_be_big_number(exp_res.ident_p))
 				{
 					unary_operation_function_caller("big_number_negate", level, ptx);
 				}
@@ -1636,9 +1662,9 @@ exp_res_t expression_string_condition(int level, int *ptx, tag_t tag)
 		|| (m_symbol >= SYM_CMP_START && m_symbol <= SYM_CMP_END))
 		)
 	{
-		if (!(m_symbol == SYM_EQL && !can_be_big_number(&exp_res.ident)))
+		if (!(m_symbol == SYM_EQL && !can_be_big_number(exp_res.ident_p)))
 		{
-			if (can_be_string(&exp_res.ident))
+			if (can_be_string(exp_res.ident_p))
 			{
 				symbol = m_symbol;
 					
@@ -1646,7 +1672,7 @@ exp_res_t expression_string_condition(int level, int *ptx, tag_t tag)
 
 				exp_res = expression_cast_op(expression_shift, level, ptx, 0, exp_res, tag);
 					
-				if (can_be_big_number(&exp_res.ident))
+				if (can_be_big_number(exp_res.ident_p))
 				{
 					binary_operation_function_caller("big_number_compare", level, ptx);
 				}
@@ -1674,8 +1700,7 @@ exp_res_t expression_string_condition(int level, int *ptx, tag_t tag)
 					instructions_add(OC_OPR, 0, op);
 				}
 				
-				exp_res = exp_integer;
-				exp_res.ident.data.int_val.is_boolean = TRUE;
+				exp_res = exp_boolean;
 			}
 		}
 	}
@@ -1700,9 +1725,9 @@ exp_res_t expression_term(int level, int *ptx, tag_t tag)
 	exp_res = expression_operand(level, ptx, tag);
 
 	if (exp_res.type == KIND_FLOAT || exp_res.type == KIND_INTEGER
-		|| can_be_big_number(&exp_res.ident))
+		|| can_be_big_number(exp_res.ident_p))
 	{
-		if (can_be_big_number(&exp_res.ident))
+		if (can_be_big_number(exp_res.ident_p))
 		{
 			int x = 10;
 		}
@@ -1718,7 +1743,7 @@ exp_res_t expression_term(int level, int *ptx, tag_t tag)
 
 			exp_res = expression_cast_op(expression_operand, level, ptx, 0, exp_res, tag);
 
-			if (can_be_big_number(&exp_res.ident))
+			if (can_be_big_number(exp_res.ident_p))
 			{
 				if (op == SYM_STAR)
 				{
@@ -0,0 +1,226 @@
+/*
+ * @file hashbench.c
+ *
+ * @description
+ *
+ * Microbenchmark for hashtable.c (make hashbench).
+ *
+ * Times putting and getting string and integer keys, and the compiler's
+ * own use: looking names up in a small table of types.  Only the
+ * original hashtable API is used so the same file can be built against
+ * older versions of hashtable.c to compare them.
+ *
+ * Usage: hashbench [number of keys]
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "hashtable.h"
+
+/*
+ * Default number of keys (per table).
+ */
+#define DEFAULT_KEYS		50000
+
+/*
+ * Number of types and lookups in the small table benchmark.
+ */
+#define SMALL_TABLE_KEYS	64
+#define SMALL_TABLE_LOOKUPS	2000000
+
+static double seconds_since(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static char *make_name(const char *prefix, int i)
+{
+	char *name;
+
+	name = MALLOC(char, strlen(prefix) + 16);
+
+	sprintf(name, "%s%d", prefix, i);
+
+	return name;
+}
+
+/*
+ * Puts n string keys and then gets each of them and n missing ones.
+ */
+static long bench_strings(int n)
+{
+	int i;
+	long found = 0;
+	clock_t start;
+	char **names, **missing;
+	hashtable_t *hashtable_p;
+	variant_t var, key;
+
+	names = MALLOC(char*, n);
+	missing = MALLOC(char*, n);
+
+	for (i = 0; i < n; i++)
+	{
+		names[i] = make_name("identifier_", i);
+		missing[i] = make_name("missing_", i);
+	}
+
+	start = clock();
+
+	hashtable_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
+
+	for (i = 0; i < n; i++)
+	{
+		variant_init_i4(&var, i);
+		variant_init_pointer(&key, VT_PSTR, names[i]);
+		key.destructor = NULL;
+
+		hashtable_put(hashtable_p, var, key);
+	}
+
+	printf("string put      %8.3fs\n", seconds_since(start));
+
+	start = clock();
+
+	for (i = 0; i < n; i++)
+	{
+		found += hashtable_get_stringkey(hashtable_p, names[i]).vt != VT_EMPTY;
+		found += hashtable_get_stringkey(hashtable_p, missing[i]).vt != VT_EMPTY;
+	}
+
+	printf("string get      %8.3fs\n", seconds_since(start));
+
+	hashtable_delete(hashtable_p);
+
+	for (i = 0; i < n; i++)
+	{
+		free(names[i]);
+		free(missing[i]);
+	}
+
+	free(names);
+	free(missing);
+
+	return found;
+}
+
+/*
+ * Puts n integer keys (spread out like handles or addresses) and gets
+ * each of them back.
+ */
+static long bench_integers(int n)
+{
+	int i;
+	long found = 0;
+	clock_t start;
+	hashtable_t *hashtable_p;
+	variant_t var, key;
+
+	start = clock();
+
+	hashtable_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
+
+	for (i = 0; i < n; i++)
+	{
+		variant_init_i4(&var, i);
+		variant_init_i4(&key, (long)i * 16);
+
+		hashtable_put(hashtable_p, var, key);
+	}
+
+	printf("integer put     %8.3fs\n", seconds_since(start));
+
+	start = clock();
+
+	for (i = 0; i < n; i++)
+	{
+		variant_init_i4(&key, (long)i * 16);
+
+		found += hashtable_get(hashtable_p, key).val.val_i4 == i;
+	}
+
+	printf("integer get     %8.3fs\n", seconds_since(start));
+
+	hashtable_delete(hashtable_p);
+
+	return found;
+}
+
+/*
+ * Looks names up in a small table (like the compiler's table of types).
+ */
+static long bench_small_table()
+{
+	int i;
+	long found = 0;
+	clock_t start;
+	char *names[SMALL_TABLE_KEYS];
+	hashtable_t *hashtable_p;
+	variant_t var, key;
+
+	hashtable_p = hashtable_new(DEFAULT_HASHTABLE_SIZE);
+
+	for (i = 0; i < SMALL_TABLE_KEYS; i++)
+	{
+		names[i] = make_name("type_", i);
+
+		variant_init_i4(&var, i);
+		variant_init_pointer(&key, VT_PSTR, names[i]);
+		key.destructor = NULL;
+
+		hashtable_put(hashtable_p, var, key);
+	}
+
+	start = clock();
+
+	for (i = 0; i < SMALL_TABLE_LOOKUPS; i++)
+	{
+		found += hashtable_get_stringkey(hashtable_p, names[i % SMALL_TABLE_KEYS]).vt != VT_EMPTY;
+	}
+
+	printf("small table get %8.3fs\n", seconds_since(start));
+
+	hashtable_delete(hashtable_p);
+
+	for (i = 0; i < SMALL_TABLE_KEYS; i++)
+	{
+		free(names[i]);
+	}
+
+	return found;
+}
+
+int main(int argc, char **argv)
+{
+	int n;
+	long found;
+
+	n = argc > 1 ? atoi(argv[1]) : DEFAULT_KEYS;
+
+	if (n <= 0)
+	{
+		printf("Usage: hashbench [number of keys]\n");
+
+		return 1;
+	}
+
+	printf("%d keys\n", n);
+
+	found = bench_strings(n);
+	found += bench_integers(n);
+	found += bench_small_table();
+
+	/*
+	 * Every key that was put should have been found (and nothing else).
+	 */
+	if (found != 2L * n + SMALL_TABLE_LOOKUPS)
+	{
+		printf("Found %ld keys, expected %ld.\n", found, 2L * n + SMALL_TABLE_LOOKUPS);
+
+		return 1;
+	}
+
+	return 0;
+}
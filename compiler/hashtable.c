@@ -5,445 +5,189 @@
 #include "stdio.h"
 
 /*
- * Creates a new list_t.  Sets all values to zero.
- * The list_t needs to later be explictly deleted.
- *
- * @see			list_delete(list_t*)
- * @returns		The list if successful, otherwise NULL.
+ * Smallest number of slots a hashtable has.
  */
-list_t *list_new()
-{
-	return CALLOC(list_t, 1);
-}
+#define HASHTABLE_MIN_SIZE	8
 
 /*
- * Deletes a list_t by removing it off the heap.
- * All the nodes in the list will also be deleted, this
- * also includes all the variants stored in these nodes.
+ * Creates a new hashtable_t with room for at least tblsize slots (rounded
+ * up to a power of 2).  The hashtable_t needs to later be explictly
+ * deleted.
  *
- * @see list_node_delete(list_node_t*)
+ * @see hashtable_delete(hashtable_t*)
  */
-void list_delete(list_t *list_p)
+hashtable_t *hashtable_new(int tblsize)
 {
-	list_node_t *node1_p, *node2_p;
+	UINT size;
+	hashtable_t *hashtable_p;
 
-	node1_p = list_p->first_p;
+	for (size = HASHTABLE_MIN_SIZE; size < (UINT)tblsize; size <<= 1)
+		;
 
 	/*
-	 * Go through every node.
+	 * Could the hashtable_t not be allocated?
 	 */
-	while (node1_p)
+	if (!(hashtable_p = CALLOC(hashtable_t, 1)))
 	{
-		node2_p = node1_p->next_p;
-		
 		/*
-		 * Delete each node.
+		 * Fail.
 		 */
-		list_node_delete(node1_p);
-		
-		node1_p = node2_p;
+		return NULL;
 	}
-
-	free(list_p);
-
-	/*
-	 * Success.
-	 */	
-}
-
-/*
- * Creates a new list_node_t.  Sets all values to zero.
- * The list_node_t needs to later be explictly deleted.
- *
- * @see			list_node_delete(list_node_t*)
- * @returns		The node if successful, otherwise NULL.
- */
-list_node_t *list_node_new(variant_t var)
-{
-	list_node_t *node_p;
+		
+	hashtable_p->hashes = CALLOC(UINT, size);
+	hashtable_p->items = MALLOC(hashitem_t, size);
 
 	/*
-	 * If the list_node_t can't be allocated.
+	 * If the slots couldn't be allocated.
 	 */
-	if (!(node_p = CALLOC(list_node_t, 1)))
+	if (!hashtable_p->hashes || !hashtable_p->items)
 	{
+		/*
+		 * Deallocate what's already been allocated.
+		 */
+		free(hashtable_p->hashes);
+		free(hashtable_p->items);
+		free(hashtable_p);
+
 		/*
 		 * Fail.
 		 */
 		return NULL;
 	}
-
-	node_p->var = var;
-
-	/*
-	 * Success.
-	 */
-	return node_p;
-}
-
-/*
- * Deletes a list_node_t by removing it off the heap.
- * The variant_t being held in the node will also have it's
- * destructor called. 
- *
- * @see variant_destruct(variant_t*)
- */
-void list_node_delete(list_node_t *node_p)
-{
-	variant_destruct(&node_p->var);
 	
-	free(node_p);
+	hashtable_p->tblsize = size;
 
 	/*
 	 * Success.
 	 */
+	return hashtable_p;
 }
 
 /*
- * Finds an item on the list, by using the default dynamic comparator.
- * 
- * @see variant_dynamic_comparator
- */
-variant_t list_find(list_t *list_p, variant_t var)
-{
-	/*
-	 * Success.
-	 */
-	return list_find_with(list_p, var, variant_dynamic_comparator);
-}
-
-/*
- * Finds an item on the list, by using the supplied comparator.
- * 
- * @see variant_dynamic_comparator
+ * Deletes a hashtable_t by removing it off the heap.
+ * This will also free up any variant_ts held in the
+ * hashtable.
  */
-variant_t list_find_with(list_t *list_p, variant_t var, variant_comparator_fn comparator)
+void hashtable_delete(hashtable_t *hashtable_p)
 {
-	variant_t retval;
-	list_iterator_t iterator_p;
+	UINT i;
 
 	/*
-	 * Initialize an iterator for the list.
+	 * Destroy the key and value in every used slot.
 	 */
-	list_init_iterator(list_p, &iterator_p);
-	
-	/*
-	 * Iterate through all the variants in the list.
-	 */
-	while (list_hasmore(&iterator_p))
+	for (i = 0; i < hashtable_p->tblsize; i++)
 	{
-		/*
-		 * Does the current var match the one they're looking for?
-		 */
-		if (comparator(&var, iterator_p.var_p) == 0)
+		if (hashtable_p->hashes[i])
 		{
-			/*
-			 * Return the current var.
-			 */
-
-			/*
-			 * Success.
-			 */
-			return *iterator_p.var_p;
+			variant_destruct(&hashtable_p->items[i].key);
+			variant_destruct(&hashtable_p->items[i].var);
 		}
 	}
 
+	free(hashtable_p->hashes);
+	free(hashtable_p->items);
+	free(hashtable_p);
+
 	/*
-	 * Make the return value an empty variant.
-	 */
-	retval.vt = VT_EMPTY;
-	
-	/*
-	 * Fail.
+	 * Success.
 	 */
-	return retval;
 }
 
 /*
- * Adds a variant to the end of a linked list.  The variant is owned by the list
- * and it's destructor will be called when the list is finished with it.
+ * Finds the slot holding a key.
  *
- * @list	The linked list.
- * @var		The variant to add to the list.
+ * @param hash		The key's hash (see hashtable_hash).
+ * @returns			The slot or -1 if the key isn't in the hashtable.
  */
-std_error_t list_add(list_t *list_p, variant_t var)
+static int hashtable_find(hashtable_t *hashtable_p, variant_t *key_p, UINT hash)
 {
-	list_node_t *node_p;
-
-	/*
-	 * If a new node couldn't be created.
-	 */
-	if (!(node_p = list_node_new(var)))
-	{
-		/*
-		 * Destroy variant since we own it.
-		 */
-		variant_destruct(&var);
-
-		/*
-		 * Return the error code.
-		 */
-		return std_malloc_fail;
-	}
+	UINT i, mask;
 
-	/*
-	 * If there's a last node.
-	 */
-	if (list_p->last_p)
-	{
-		/*
-		 * Make the new node be the next one after the last element.
-		 */
-		list_p->last_p->next_p = node_p;
-	}
-	
-	/*
-	 * Make the list's last node the new node.
-	 */
-	list_p->last_p = node_p;
+	mask = hashtable_p->tblsize - 1;
 
 	/*
-	 * If there's no first node, then the new node is the first as well.
+	 * Probe from the key's home slot until an empty slot is found.  Keys
+	 * are only compared when the stored hash matches.
 	 */
-	if (list_p->first_p == NULL)
+	for (i = hash & mask; hashtable_p->hashes[i]; i = (i + 1) & mask)
 	{
-		list_p->first_p = node_p;
+		if (hashtable_p->hashes[i] == hash
+			&& variant_dynamic_comparator(key_p, &hashtable_p->items[i].key) == 0)
+		{
+			return (int)i;
+		}
 	}
 
-	list_p->size++;
-
-	/*
-	 * Success.
-	 */
-	return std_success;
+	return -1;
 }
 
 /*
- * Initializes a list iterator.
- *
- * @param list		The list to iterate.
- * @param iterator	The iterator to initialize.
- */
-void list_init_iterator(list_t *list_p, list_iterator_t *iterator_p)
-{	
-	iterator_p->list_p = list_p;
-	iterator_p->current_node_p = NULL;
-}
-
-/*
- * Given a list iterator, it determines if there's any more elements
- * in the list to iterate.
- *
- * @param list_iterator	The hashtable iterator.
- *
- * @returns TRUE if there are more elements, FALSE if there aren't.
+ * Stores an item in the first free slot after its home slot.  There must
+ * be a free slot.
  */
-BOOL list_hasmore(list_iterator_t *list_iterator_p)
+static void hashtable_insert(hashtable_t *hashtable_p, UINT hash, variant_t var, variant_t key)
 {
-	/*
-	 * If this is the first time the iterator is used.
-	 */
-	if (list_iterator_p->current_node_p == NULL)
-	{
-		/*
-		 * If the list has nothing in it.
-		 */
-		if (list_iterator_p->list_p->size <= 0)
-		{
-			/*
-			 * Stop iterating.
-			 */
+	UINT i, mask;
 
-			/*
-			 * Success.
-			 */
-			return FALSE;
-		}
+	mask = hashtable_p->tblsize - 1;
 
-		/*
-		 * Set the current var and node to be the first on the list.
-		 */
-		list_iterator_p->current_node_p = list_iterator_p->list_p->first_p;
-		list_iterator_p->var_p = &list_iterator_p->current_node_p->var;
+	for (i = hash & mask; hashtable_p->hashes[i]; i = (i + 1) & mask)
+		;
 
-		/*
-		 * Success.
-		 */
-		return TRUE;
-	}
-
-	/*
-	 * Move to the next node in the list.
-	 */
-	list_iterator_p->current_node_p = list_iterator_p->current_node_p->next_p;
-	
-	/*
-	 * Is this the end of the list?
-	 */
-	if (list_iterator_p->current_node_p == NULL)
-	{
-		/*
-		 * Success.
-		 */
-		return FALSE;		
-	}
-	else
-	{
-		/*
-		 * Set the iterator's value pointer to point to the current node's value.
-		 */
-		list_iterator_p->var_p = &list_iterator_p->current_node_p->var;
+	hashtable_p->hashes[i] = hash;
+	hashtable_p->items[i].key = key;
+	hashtable_p->items[i].var = var;
 
-		/*
-		 * Success.
-		 */
-		return TRUE;
-	}
+	hashtable_p->size++;
 }
 
 /*
- * Creates a new hashtable_t.  Sets all values to zero.
- * The hashtable_t needs to later be explictly deleted.
- *
- * @see hashtable_delete(list_t*)
+ * Doubles the number of slots in a hashtable.  The stored hashes mean the
+ * keys don't need to be hashed again.
  */
-hashtable_t *hashtable_new(int tblsize)
+static std_error_t hashtable_grow(hashtable_t *hashtable_p)
 {
-	UINT i;
-	hashtable_t *hashtable_p;
+	UINT i, *hashes;
+	hashitem_t *items;
+	hashtable_t grown;
 
-	/*
-	 * Could the hashtable_t not be allocated?
-	 */
-	if (!(hashtable_p = CALLOC(hashtable_t, 1)))
-	{
-		/*
-		 * Fail.
-		 */
-		return NULL;
-	}
-		
-	/*
-	 * If a hashtable_t couldn't be allocated.
-	 */
-	if (!(hashtable_p->table = CALLOC(list_t*, tblsize)))
+	grown.size = 0;
+	grown.tblsize = hashtable_p->tblsize * 2;
+	grown.hashes = CALLOC(UINT, grown.tblsize);
+	grown.items = MALLOC(hashitem_t, grown.tblsize);
+
+	if (!grown.hashes || !grown.items)
 	{
-		/*
-		 * Deallocate what's already been allocated.
-		 */
-		free(hashtable_p);
+		free(grown.hashes);
+		free(grown.items);
 
 		/*
 		 * Fail.
 		 */
-		return NULL;
+		return std_malloc_fail;
 	}
-	
-	hashtable_p->tblsize = tblsize;
 
-	/*
-	 * Put a linked list inside each element in the table.
-	 */
+	hashes = hashtable_p->hashes;
+	items = hashtable_p->items;
+
 	for (i = 0; i < hashtable_p->tblsize; i++)
 	{
-		hashtable_p->table[i] = list_new();
-
-		/*
-		 * If the linked list couldn't be created.
-		 */
-		if (!hashtable_p->table[i])
+		if (hashes[i])
 		{
-			/*
-			 * Failed to create the whole hashtable.
-			 * Deallocate what's been created and fail.
-			 */
-			hashtable_p->tblsize = i + 1;
-			hashtable_delete(hashtable_p);
-
-			/*
-			 * Fail.
-			 */
-			return NULL;
+			hashtable_insert(&grown, hashes[i], items[i].var, items[i].key);
 		}
 	}
 
-	/*
-	 * Success.
-	 */
-	return hashtable_p;
-}
-
-/*
- * Deletes a hashitem_t by removing it off the heap.
- * This will also free up any variant_ts held in the
- * hashtable.
- *
- * @see hashtable_delete(hashtable_t*)
- */
-void hashtable_delete(hashtable_t *hashtable_p)
-{
-	UINT i;
-
-	/*
-	 * Go through the entire table.
-	 */
-	for (i = 0; i < hashtable_p->tblsize; i++)
-	{
-		/*
-		 * Delete each linked list.
-		 */
-		list_delete(hashtable_p->table[i]);
-	}
+	free(hashes);
+	free(items);
 
-	free(hashtable_p->table);	
-	free(hashtable_p);
+	*hashtable_p = grown;
 
 	/*
 	 * Success.
 	 */
-}
-
-/*
- * Creates a new hashitem_t.  Sets the item's values from
- * the supplied arguments.
- * The hashitem_t needs to later be explictly deleted.
- *
- * @see hashitem_delete(list_node_t*)
- */
-hashitem_t *hashitem_new(variant_t var, variant_t key)
-{
-	hashitem_t *hashitem_p;
-
-	/*
-	 * If a hashitem_t can't be allocated.
-	 */
-	if (!(hashitem_p = CALLOC(hashitem_t, 1)))
-	{
-		/*
-		 * Fail.
-		 */
-		return NULL;
-	}
-
-	hashitem_p->var = var;
-	hashitem_p->key = key;
-
-	return hashitem_p;
-}
-
-/*
- * Deletes a hashitem_t by removing it off the heap.
- * The key and value of the hashitem will both be
- * destroyed.
- *
- * @see variant_destruct(variant_t*)
- */
-void hashitem_delete(hashitem_t *hashitem_p)
-{
-	variant_destruct(&hashitem_p->key);
-	variant_destruct(&hashitem_p->var);
-
-	free(hashitem_p);
+	return std_success;
 }
 
 /*
@@ -454,60 +198,33 @@ void hashitem_delete(hashitem_t *hashitem_p)
  * @param hashtable		The hashtable.
  * @param var			The variant to put in the hashtable.
  * @param key			The key to be associated with the var in the hashtable.
- * @returns				std_exists if an item with the same key already exists.
+ * @returns				std_malloc_fail if the hashtable couldn't grow.
  *						std_success otherwise.
  * @see hashtable_put(hashtable_t, variant_t, variant_t)
  */
 std_error_t hashtable_put_fast(hashtable_t *hashtable_p, variant_t var, variant_t key)
 {	
-	hashitem_t *hashitem_p;
-	variant_t var_hashitem;
-	std_error_t retval;
-
-	/*
-	 * If a hashtiem containing the key and variant couldn't be allocated.
-	 */
-	if (!(hashitem_p = hashitem_new(var, key)))
-	{
-		/*
-		 * Delete the var + key since we own it.
-		 */
-		variant_destruct(&var);
-		variant_destruct(&key);
-
-		/*
-		 * Fail.
-		 */
-		return std_malloc_fail;
-	}
-
-	/*
-	 * Initialize a variant 'var' that stores the hashitem.
-	 */
-	variant_init_pointer(&var_hashitem, VT_PHASHITEM, hashitem_p);
-	
-	/*
-	 * Put the hashitem in the appropriate list of the hashtable.
-	 */
-	retval = list_add(hashtable_p->table[hashtable_tblindex(hashtable_p, key)], var_hashitem);
-	
 	/*
-	 * If adding to the list failed.
+	 * Keep the hashtable at most 3/4 full.
 	 */
-	if (retval != std_success)
+	if ((hashtable_p->size + 1) * 4 > hashtable_p->tblsize * 3)
 	{
-		/*
-		 * Delete hashitem (includes var + key) since we own them.
-		 */			
-		hashitem_delete(hashitem_p);
+		if (hashtable_grow(hashtable_p) != std_success)
+		{
+			/*
+			 * Delete the var + key since we own it.
+			 */
+			variant_destruct(&var);
+			variant_destruct(&key);
 
-		/*
-		 * Fail.
-		 */
-		return retval;
+			/*
+			 * Fail.
+			 */
+			return std_malloc_fail;
+		}
 	}
 
-	hashtable_p->size++;
+	hashtable_insert(hashtable_p, hashtable_hash(&key), var, key);
 
 	/*
 	 * Success.
@@ -531,7 +248,7 @@ std_error_t hashtable_put(hashtable_t *hashtable_p, variant_t var, variant_t key
 	/*
 	 * If the hashtable already contains an item with the same key.
 	 */
-	if (hashtable_get(hashtable_p, key).vt != VT_EMPTY)
+	if (hashtable_find(hashtable_p, &key, hashtable_hash(&key)) >= 0)
 	{
 		/*
 		 * Delete the var + key since we own it.
@@ -548,6 +265,104 @@ std_error_t hashtable_put(hashtable_t *hashtable_p, variant_t var, variant_t key
 	return hashtable_put_fast(hashtable_p, var, key);
 }
 
+/*
+ * Puts a variant into the hashtable with the specified key, replacing
+ * (and destroying) the value already stored with the key if there is one.
+ * The hashtable owns both the key and variant - so it will free them.
+ *
+ * @param hashtable		The hashtable.
+ * @param var			The variant to put in the hashtable.
+ * @param key			The key to be associated with the var in the hashtable.
+ */
+std_error_t hashtable_set(hashtable_t *hashtable_p, variant_t var, variant_t key)
+{
+	int i;
+
+	i = hashtable_find(hashtable_p, &key, hashtable_hash(&key));
+
+	if (i < 0)
+	{
+		return hashtable_put_fast(hashtable_p, var, key);
+	}
+
+	/*
+	 * Keep the key that's already stored.
+	 */
+	variant_destruct(&key);
+	variant_destruct(&hashtable_p->items[i].var);
+
+	hashtable_p->items[i].var = var;
+
+	/*
+	 * Success.
+	 */
+	return std_success;
+}
+
+/*
+ * Removes (and destroys) the item with the specified key.
+ *
+ * @returns TRUE if the item was in the hashtable.
+ */
+BOOL hashtable_remove(hashtable_t *hashtable_p, variant_t key)
+{
+	int found;
+	UINT i, j, home, mask;
+
+	found = hashtable_find(hashtable_p, &key, hashtable_hash(&key));
+
+	if (found < 0)
+	{
+		return FALSE;
+	}
+
+	variant_destruct(&hashtable_p->items[found].key);
+	variant_destruct(&hashtable_p->items[found].var);
+
+	hashtable_p->size--;
+
+	mask = hashtable_p->tblsize - 1;
+
+	/*
+	 * Empty the slot and move back any item after it (before the next
+	 * empty slot) that could no longer be found past the hole.  There are
+	 * no tombstones so probes always stop at the first empty slot.
+	 */
+	i = (UINT)found;
+	j = i;
+
+	for (;;)
+	{
+		hashtable_p->hashes[i] = 0;
+
+		for (;;)
+		{
+			j = (j + 1) & mask;
+
+			if (hashtable_p->hashes[j] == 0)
+			{
+				return TRUE;
+			}
+
+			home = hashtable_p->hashes[j] & mask;
+
+			/*
+			 * The item at j can move into the hole at i unless its home
+			 * slot lies (cyclically) after i, up to j.
+			 */
+			if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+			{
+				break;
+			}
+		}
+
+		hashtable_p->hashes[i] = hashtable_p->hashes[j];
+		hashtable_p->items[i] = hashtable_p->items[j];
+
+		i = j;
+	}
+}
+
 variant_t hashtable_get_stringkey(hashtable_t *hashtable_p, const char* key)
 {
 	variant_t var;
@@ -562,7 +377,7 @@ variant_t hashtable_get_stringkey(hashtable_t *hashtable_p, const char* key)
  */
 BOOL hashtable_exists(hashtable_t *hashtable_p, variant_t key)
 {
-	return hashtable_get(hashtable_p, key).vt != VT_EMPTY;
+	return hashtable_find(hashtable_p, &key, hashtable_hash(&key)) >= 0;
 }
 
 /*
@@ -570,40 +385,30 @@ BOOL hashtable_exists(hashtable_t *hashtable_p, variant_t key)
  *
  * @hashtable	The hashtable.
  * @key			The key of the variant to get.
+ * @returns		The variant or an empty variant if the key isn't in the
+ *				hashtable.
  */
 variant_t hashtable_get(hashtable_t *hashtable_p, variant_t key)
 {
-	UINT index;
-	list_t *list;
+	int i;
 	variant_t retval;
 	
-	/*
-	 * Get the index of the list (of the hashtable) the varaint should be in.
-	 */
-	index = hashtable_tblindex(hashtable_p, key);
-
-	list = hashtable_p->table[index];
-	
-	/*
-	 * Search the list for the hashitem that has the same key as the key supplied.	 
-	 */
-	retval = list_find_with(list, key, variant_hashitem_comparator);
+	i = hashtable_find(hashtable_p, &key, hashtable_hash(&key));
 
-	/*
-	 * If the item exists.
-	 */
-	if (retval.vt != VT_EMPTY)
+	if (i < 0)
 	{
 		/*
-		 * Set the variant returned the the value contained in the hashitem.
+		 * Make the return value an empty variant.
 		 */
-		retval = retval.val.val_hashitem_p->var;
+		retval.vt = VT_EMPTY;
+
+		return retval;
 	}
-	
+
 	/*
 	 * Success.
 	 */
-	return retval;
+	return hashtable_p->items[i].var;
 }
 
 /*
@@ -615,7 +420,7 @@ variant_t hashtable_get(hashtable_t *hashtable_p, variant_t key)
 void hashtable_init_iterator(hashtable_t *hashtable_p, hashtable_iterator_t *iterator)
 {
 	iterator->hashtable_p = hashtable_p;
-	iterator->current_list_index = -1;
+	iterator->next_index = 0;
 }
 
 /*
@@ -628,104 +433,19 @@ void hashtable_init_iterator(hashtable_t *hashtable_p, hashtable_iterator_t *ite
 BOOL hashtable_hasmore(hashtable_iterator_t *hashtable_iterator_p)
 {
 	UINT i;
+	hashtable_t *hashtable_p;
 
-	/*
-	 * If this is the first time the iterator has been used.
-	 */
-	if (hashtable_iterator_p->current_list_index == -1)
-	{
-		/*
-		 * If the hashtable is empty.
-		 */
-		if (hashtable_iterator_p->hashtable_p->size <= 0)
-		{
-			/*
-			 * Stop iterating.
-			 */
-
-			/*
-			 * Success.
-			 */
-			return FALSE;
-		}		
-	}
-	else
-	{
-		/*
-		 * If sub list the hashtable is currently iterating has more.
-		 */
-		if (list_hasmore(&hashtable_iterator_p->list_iterator_p))
-		{
-			/*
-			 * Get the next variant in the list.
-			 */
-			hashtable_iterator_p->var_p = &hashtable_iterator_p -> list_iterator_p.var_p -> val.val_hashitem_p -> var;
-
-			/*
-			 * Success.
-			 */
-			return TRUE;
-		}
-	}
-
-	/*
-	 * The last list in the hashtable has been fully iterated.
-	 */
-
-	/*
-	 * Increment the list index so we can search the next list in the hashtable.
-	 */
-	hashtable_iterator_p->current_list_index++;
-
-	/*
-	 * If we've got to the end of size of the hashtable (no more lists).
-	 */
-	if (hashtable_iterator_p->current_list_index >= hashtable_iterator_p->hashtable_p->tblsize)
-	{
-		/*
-		 * Stop iterating.
-		 */
-
-		/*
-		 * Success.
-		 */
-		return FALSE;
-	}
+	hashtable_p = hashtable_iterator_p->hashtable_p;
 
 	/*
-	 * Loops through all the lists in the hashtable from the current one to the end.
+	 * Find the next used slot.
 	 */
-	for (i = hashtable_iterator_p->current_list_index; i < hashtable_iterator_p->hashtable_p->tblsize; i++)
+	for (i = hashtable_iterator_p->next_index; i < hashtable_p->tblsize; i++)
 	{
-		/*
-		 * If the current list isn't empty.
-		 */
-		if (hashtable_iterator_p->hashtable_p->table[i]->size > 0)
+		if (hashtable_p->hashes[i])
 		{
-			/*
-			 * Set the hashtable's list iterator to iterate this list.
-			 */
-			list_init_iterator(hashtable_iterator_p->hashtable_p->table[i], &hashtable_iterator_p->list_iterator_p);
-			
-			/*
-			 * Grab the first variant in the list.  It should store a hashitem.
-			 */
-			list_hasmore(&hashtable_iterator_p->list_iterator_p);
-
-			/*
-			 * Set the iterator's current variant (the thing the caller wants) to be the variant
-			 * stored in the hashitem (stored in the variant we just got).
-			 */
-			hashtable_iterator_p->var_p = &hashtable_iterator_p->list_iterator_p.var_p->val.val_hashitem_p->var;
-			
-			/*
-			 * Update the current list index in the iterator.
-			 */
-			hashtable_iterator_p->current_list_index = i;
-			
-			/*
-			 * Stop iterating.
-			 */
+			hashtable_iterator_p->var_p = &hashtable_p->items[i].var;
+			hashtable_iterator_p->next_index = i + 1;
 
 			/*
 			 * Success.
@@ -734,77 +454,84 @@ BOOL hashtable_hasmore(hashtable_iterator_t *hashtable_iterator_p)
 		}
 	}
 
-	/*
-	 * Stop iterating.
-	 */
+	hashtable_iterator_p->next_index = hashtable_p->tblsize;
 
 	/*
-	 * Success.
+	 * Stop iterating.
 	 */
 	return FALSE;
 }
 
 /*
- * Determines the index of hashtable's table a given key would occupy.
+ * Hashes a key.  The hash is never 0 (which marks an empty slot).
  *
- * @param hashtable	The hashtable.
  * @param key		The key.
- *
- * @returns		The index of the table the key would occupy.
  */
-UINT hashtable_tblindex(hashtable_t *hashtable_p, variant_t key)
+UINT hashtable_hash(variant_t *key_p)
 {
-	switch (key.vt)
+	UINT hash;
+	size_t pointer;
+
+	switch (key_p->vt)
 	{
 	case VT_PSTR:
 		/*
 		 * Key is a string, hash the string.
 		 */
-		return hash_string(key.val.val_sz) % hashtable_p->tblsize;	
+		hash = hash_string(key_p->val.val_sz);
 
-	case VT_I4:
-		/*
-		 * Key is a number, hash the number.
-		 */
-		return key.val.val_i4 % hashtable_p->tblsize;	
+		break;
 	
 	case VT_PVOID:
 		/*
-		 * Key is a void pointer, hash the pointer!
+		 * Key is a void pointer, hash the pointer (folding the top half
+		 * of 64 bit pointers into the bottom).
 		 */
-		return (UINT)key.val.val_void_p % hashtable_p->tblsize;
+		pointer = (size_t)key_p->val.val_void_p;
+		hash = hash_integer((UINT)pointer ^ (UINT)(pointer >> 16 >> 16));
+
+		break;
 
 	default:
 		/*
-		 * Don't really know what in the variant they want as the key.
-		 * Presume it's the lVal.
+		 * Key is a number (or something we don't know about, presume
+		 * it's the lVal).
 		 */
-		return key.val.val_i4 % hashtable_p->tblsize;	
+		hash = hash_integer((UINT)key_p->val.val_i4);
 
+		break;
 	}
+
+	return hash ? hash : 1;
 }
 
 /*
- * Hashes a string.
+ * Hashes a string (32 bit FNV-1a).
  */
 UINT hash_string(const char *key_sz)
 {
-	UINT j = 0, h = 0;
-	char *c = (char*)key_sz;
+	UINT h = 2166136261u;
+	const unsigned char *c = (const unsigned char*)key_sz;
 			
-	/*
-	 * Hashing strings by xoring every 4 bytes with the next 4 onto an integer.
-	 */
-	while(*c)
+	while (*c)
 	{
-		h ^= (*c++ << j);
-
-		j += 8, j %= 32;
+		h = (h ^ *c++) * 16777619u;
 	}
 
 	return h;
 }
 
+/*
+ * Hashes an integer.  Slots are picked by the bottom bits of the hash so
+ * the top bits are mixed into them.
+ */
+UINT hash_integer(UINT key)
+{
+	key *= 2654435761u;
+
+	return key ^ (key >> 16);
+}
+
 /*
  * Initialize a variant_t structure with the type specified.
  * Also assigns the variant a default destructor.
@@ -920,10 +647,6 @@ void variant_assign_default_destructor(variant_t *var_p)
 		var_p->destructor = variant_string_destructor;
 		break;
 
-	case VT_PHASHITEM:
-		var_p->destructor = variant_hashitem_destructor;
-		break;
-
 	case VT_PVOID:
 		var_p->destructor = variant_pointer_destructor;
 
@@ -948,21 +671,7 @@ void variant_string_destructor(variant_t *var_p)
 }
 
 /*
- * Frees up the hashitem_t the variant holds.
- */
-void variant_hashitem_destructor(variant_t *var_p)
-{
-	if (var_p->vt != VT_PHASHITEM)
-	{
-		variant_dynamic_destructor(var_p);
-		return;
-	}
-
-	hashitem_delete(var_p->val.val_hashitem_p);
-}
-
-/*
- * Frees up the hashitem_t the variant holds.
+ * Frees up the pointer the variant holds.
  */
 void variant_pointer_destructor(variant_t *var_p)
 {
@@ -1001,19 +710,6 @@ void variant_dynamic_destructor(variant_t *var_p)
 	}
 }
 
-/*
- * Comparator used to test a variant with a hashitem's key.
- *
- * @v1_p		variant_t that is the key to find.
- * @v2_p		variant_t that contains a hashitem.
- * @returns		0 if the key in v1 and key in v2 match.
- *				Nonzero otherwise.
- */
-int variant_hashitem_comparator(variant_t *v1_p, variant_t *v2_p)
-{	
-	return variant_dynamic_comparator(v1_p, &v2_p->val.val_hashitem_p->key);
-}
-
 /*
  * Comparator that compares two void pointers.
  *
@@ -17,9 +17,10 @@
 
 #define min(a,b)    (((a) < (b)) ? (a) : (b))
 /* 
- * The default number of linked lists that make up the hashtable.
+ * The default number of slots a hashtable starts with (hashtables grow
+ * as items are added).
  */
-#define DEFAULT_HASHTABLE_SIZE	257 /* 257, 101 */
+#define DEFAULT_HASHTABLE_SIZE	16
 /*
  * Allocates enough cleared (zeroed) memory for n numbers of a type.
  */
@@ -50,8 +51,6 @@ typedef struct tag_hashitem hashitem_t;
 typedef struct tag_assessment_item assessment_item_t;
 typedef struct tag_assessment_mark assessment_mark_t;
 typedef struct tag_student student_t;
-typedef struct tag_list_node list_node_t;
-typedef struct tag_list list_t;
 typedef struct tag_hashtable hashtable_t;
 
 /* * * * * * * *
@@ -91,8 +90,7 @@ typedef enum
 	VT_NULL	= 0x1,			/* NULL					*/
 	VT_PVOID = 0x2,			/* void*				*/
 	VT_I4 = 0x6,			/* int					*/
-	VT_PSTR	= 0xa0,			/* char* or LPSTR		*/	
-	VT_PHASHITEM = 0xa2		/* hashitem_t*			*/
+	VT_PSTR	= 0xa0			/* char* or LPSTR		*/
 }
 variant_types_e;
 
@@ -114,8 +112,7 @@ struct tag_variant
 	{
 		long val_i4;								/* VT_I4		*/
 		void* val_void_p;							/* VT_PVOID		*/
-		char* val_sz;								/* VT_PSTR		*/				
-		hashitem_t* val_hashitem_p;					/* VT_PHASHITEM */		
+		char* val_sz;								/* VT_PSTR		*/
 	}
 	val;
 	/* ANSI C doesn't support anonymous inner unions */
@@ -124,7 +121,6 @@ struct tag_variant
 };
 
 /*
- * Hashtables store hashitems in linkedlists.
  * A hashitem_t stores a variant_t that is the key for the value
  * and also a variant_t that is the actual value.
  *
@@ -137,39 +133,20 @@ struct tag_hashitem
 };
 
 /*
- * A node in a linked list.
- * Each node stores a value as a variant_t.
- */
-struct tag_list_node
-{
-	variant_t var;
-	list_node_t *next_p;	
-};
-
-/*
- * A linked list made up of zero or more list_node_t nodes.
- *
- * @see list_node_t
- */
-struct tag_list
-{
-	UINT size;
-
-	list_node_t *first_p;	/* First node of the linked list	*/
-	list_node_t *last_p;	/* Last node of the linked list		*/
-};
-
-/*
- * A hashtable made up of a table (array) of linked lists.
+ * A hashtable using open addressing (linear probing).
  *
- * @see list_t
+ * The hashes of the keys are kept in an array of their own so probing
+ * only touches a few cache lines, and keys are only compared when their
+ * hashes match.  A hash of 0 marks an empty slot.  The table doubles in
+ * size whenever it gets more than 3/4 full.
  */
 struct tag_hashtable
 {
-	UINT size;
-	UINT tblsize;		/* size of the hashtable's table	*/
+	UINT size;			/* number of items in the hashtable	*/
+	UINT tblsize;		/* number of slots (a power of 2)	*/
 
-	list_t ** table;	/* array of linked list pointers (the table)*/
+	UINT *hashes;		/* hash of each slot's key (0 if the slot is empty) */
+	hashitem_t *items;	/* key and value of each slot */
 };
 
 /* * * * * * * *
@@ -177,19 +154,6 @@ struct tag_hashtable
  * No other structs refer to them, so it's tidier this way.
  */
 
-/*
- * Used to help iterate through a list.
- *
- * @see list_make_iterator(list_iterator_t*)
- */
-typedef struct
-{	
-	list_t *list_p;					/* Pointer to the list being iterated */	
-	list_node_t *current_node_p;	/* Pointer to the current node */
-	variant_t *var_p;				/* Pointer to the current value */
-}
-list_iterator_t;
-
 /*
  * Used to help iterate through a hashtable.
  *
@@ -197,11 +161,10 @@ list_iterator_t;
  */
 typedef struct
 {	
-	UINT current_list_index;			/* The current list index in the hashtable */
+	UINT next_index;					/* The slot to carry on searching from */
 
 	hashtable_t *hashtable_p;			/* Pointer to the hashtable being iterated */
-	list_iterator_t list_iterator_p;	/* The list iterator for the current list being iterated */	
-	variant_t* var_p;					/*Pointer to the current value */
+	variant_t* var_p;					/* Pointer to the current value */
 }
 hashtable_iterator_t;
 
@@ -221,38 +184,23 @@ typedef enum
 std_error_t;
 
 
-/*
- * Functions used for linked lists.
- */
-
-void list_node_delete(list_node_t *node_p);
-list_t *list_new();
-void list_delete(list_t *list_p);
-void list_print(list_t *list_p);
-list_node_t *list_node_new(variant_t var);
-void list_node_delete(list_node_t *node_p);
-variant_t list_find(list_t *list_p, variant_t var);
-variant_t list_find_with(list_t *list_p, variant_t var, variant_comparator_fn comparator);
-std_error_t list_add(list_t *list_p, variant_t var);
-void list_init_iterator(list_t *list_p, list_iterator_t *iterator_p);
-BOOL list_hasmore(list_iterator_t *list_iterator_p);
-
 /*
  * Functions used for hashtables.
  */
 
 hashtable_t *hashtable_new(int tblsize);
 void hashtable_delete(hashtable_t *hashtable_p);
-hashitem_t *hashitem_new(variant_t var, variant_t key);
-void hashitem_delete(hashitem_t *hashcell_p);
 std_error_t hashtable_put(hashtable_t *hashtable_p, variant_t var, variant_t key);
 std_error_t hashtable_put_fast(hashtable_t *hashtable_p, variant_t var, variant_t key);
+std_error_t hashtable_set(hashtable_t *hashtable_p, variant_t var, variant_t key);
+BOOL hashtable_remove(hashtable_t *hashtable_p, variant_t key);
 variant_t hashtable_get(hashtable_t *hashtable_p, variant_t key);
 variant_t hashtable_get_stringkey(hashtable_t *hashtable_p, const char* key);
 void hashtable_init_iterator(hashtable_t *hashtable_p, hashtable_iterator_t *iterator_p);
 BOOL hashtable_hasmore(hashtable_iterator_t *hashtable_iterator_p);
 UINT hash_string(const char *key_sz);
-UINT hashtable_tblindex(hashtable_t *hashtable_p, variant_t key);
+UINT hash_integer(UINT key);
+UINT hashtable_hash(variant_t *key_p);
 BOOL hashtable_exists(hashtable_t *hashtable_p, variant_t key);
 
 /*
@@ -266,10 +214,8 @@ void variant_destruct(variant_t *var_p);
 void variant_print(variant_t *var_p);
 void variant_assign_default_destructor(variant_t *var_p);
 void variant_string_destructor(variant_t *var_p);
-void variant_hashitem_destructor(variant_t *var_p);
 void variant_pointer_destructor(variant_t *var_p);
 void variant_dynamic_destructor(variant_t *var_p);
-int variant_hashitem_comparator(variant_t *v1_p, variant_t *v2_p);
 int variant_dynamic_comparator(variant_t *v1_p, variant_t *v2_p);
 
 #endif
\ No newline at end of file
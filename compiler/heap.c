@@ -0,0 +1,320 @@
+/*
+ * @file heap.c
+ *
+ * @description
+ *
+ * Size class slab allocator for the VM heap.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "heap.h"
+
+/*
+ * Size (in bytes) of the largest size class.
+ */
+#define HEAP_MAX_BLOCK_SIZE		(HEAP_MIN_BLOCK_SIZE << (HEAP_NUMBER_OF_CLASSES - 1))
+
+/*
+ * Size class of a small block (size must be <= HEAP_MAX_BLOCK_SIZE).
+ */
+#define HEAP_CLASS(size)		(m_heap_class_index[((size) + HEAP_MIN_BLOCK_SIZE - 1) / HEAP_MIN_BLOCK_SIZE])
+
+typedef struct tag_heap_slab heap_slab_t;
+
+struct tag_heap_slab
+{
+	heap_slab_t *next;
+
+	/*
+	 * Keeps the blocks that follow the slab header aligned.
+	 */
+	double align;
+};
+
+typedef struct tag_heap_class heap_class_t;
+
+struct tag_heap_class
+{
+	int block_size;
+
+	/*
+	 * Freed blocks (each one holds a pointer to the next).
+	 */
+	void *free_list;
+
+	/*
+	 * Part of the newest slab that hasn't been handed out yet.
+	 */
+	char *slab_next;
+	char *slab_end;
+
+	int slabs;
+	int blocks_in_use;
+	int peak_blocks_in_use;
+	double allocations;
+};
+
+static heap_class_t m_heap_classes[HEAP_NUMBER_OF_CLASSES];
+static unsigned char m_heap_class_index[HEAP_MAX_BLOCK_SIZE / HEAP_MIN_BLOCK_SIZE + 1];
+static heap_slab_t *m_heap_slabs;
+
+/*
+ * Blocks too big for a size class.
+ */
+static int m_heap_large_blocks_in_use;
+static double m_heap_large_bytes_in_use;
+static double m_heap_large_peak_bytes_in_use;
+static double m_heap_large_allocations;
+
+int heap_create()
+{
+	int i, c, size;
+
+	memset(m_heap_classes, 0, sizeof(m_heap_classes));
+
+	for (c = 0, size = HEAP_MIN_BLOCK_SIZE; c < HEAP_NUMBER_OF_CLASSES; c++, size *= 2)
+	{
+		m_heap_classes[c].block_size = size;
+	}
+
+	for (i = 0, c = 0; i <= HEAP_MAX_BLOCK_SIZE / HEAP_MIN_BLOCK_SIZE; i++)
+	{
+		while (i * HEAP_MIN_BLOCK_SIZE > m_heap_classes[c].block_size)
+		{
+			c++;
+		}
+
+		m_heap_class_index[i] = (unsigned char)c;
+	}
+
+	m_heap_slabs = NULL;
+	m_heap_large_blocks_in_use = 0;
+	m_heap_large_bytes_in_use = 0;
+	m_heap_large_peak_bytes_in_use = 0;
+	m_heap_large_allocations = 0;
+
+	return 1;
+}
+
+/*
+ * Releases every slab (blocks that are still in use are lost, large blocks
+ * must be freed with heap_free first).
+ */
+void heap_delete()
+{
+	heap_slab_t *slab_p;
+
+	while (m_heap_slabs)
+	{
+		slab_p = m_heap_slabs;
+		m_heap_slabs = slab_p->next;
+
+		free(slab_p);
+	}
+
+	memset(m_heap_classes, 0, sizeof(m_heap_classes));
+}
+
+/*
+ * Takes a block from a size class, adding a new slab to the class if
+ * it has run out.
+ */
+static void *heap_class_alloc(heap_class_t *class_p)
+{
+	void *block_p;
+	heap_slab_t *slab_p;
+
+	if (class_p->free_list)
+	{
+		block_p = class_p->free_list;
+		class_p->free_list = *(void**)block_p;
+	}
+	else
+	{
+		if (class_p->slab_next + class_p->block_size > class_p->slab_end)
+		{
+			slab_p = (heap_slab_t*)malloc(HEAP_SLAB_SIZE);
+
+			if (!slab_p)
+			{
+				return NULL;
+			}
+
+			slab_p->next = m_heap_slabs;
+			m_heap_slabs = slab_p;
+
+			class_p->slab_next = (char*)(slab_p + 1);
+			class_p->slab_end = (char*)slab_p + HEAP_SLAB_SIZE;
+			class_p->slabs++;
+		}
+
+		block_p = class_p->slab_next;
+		class_p->slab_next += class_p->block_size;
+	}
+
+	class_p->allocations++;
+
+	if (++class_p->blocks_in_use > class_p->peak_blocks_in_use)
+	{
+		class_p->peak_blocks_in_use = class_p->blocks_in_use;
+	}
+
+	return block_p;
+}
+
+/*
+ * Allocates a zeroed block of size bytes.
+ *
+ * @returns NULL if out of memory.
+ */
+void *heap_alloc(int size)
+{
+	void *block_p;
+
+	if (size > HEAP_MAX_BLOCK_SIZE)
+	{
+		block_p = calloc(size, 1);
+
+		if (block_p)
+		{
+			m_heap_large_allocations++;
+			m_heap_large_blocks_in_use++;
+			m_heap_large_bytes_in_use += size;
+
+			if (m_heap_large_bytes_in_use > m_heap_large_peak_bytes_in_use)
+			{
+				m_heap_large_peak_bytes_in_use = m_heap_large_bytes_in_use;
+			}
+		}
+
+		return block_p;
+	}
+
+	block_p = heap_class_alloc(&m_heap_classes[HEAP_CLASS(size)]);
+
+	if (block_p)
+	{
+		memset(block_p, 0, size);
+	}
+
+	return block_p;
+}
+
+/*
+ * Frees a block that was allocated with size bytes.
+ */
+void heap_free(void *block_p, int size)
+{
+	heap_class_t *class_p;
+
+	if (size > HEAP_MAX_BLOCK_SIZE)
+	{
+		m_heap_large_blocks_in_use--;
+		m_heap_large_bytes_in_use -= size;
+
+		free(block_p);
+
+		return;
+	}
+
+	class_p = &m_heap_classes[HEAP_CLASS(size)];
+
+	*(void**)block_p = class_p->free_list;
+	class_p->free_list = block_p;
+	class_p->blocks_in_use--;
+}
+
+/*
+ * Resizes a block from old_size to size bytes.  Any new space is zeroed.
+ *
+ * @returns NULL if out of memory (the old block is still valid).
+ */
+void *heap_realloc(void *block_p, int old_size, int size)
+{
+	void *new_block_p;
+
+	if (size <= HEAP_MAX_BLOCK_SIZE && old_size <= HEAP_MAX_BLOCK_SIZE && HEAP_CLASS(size) == HEAP_CLASS(old_size))
+	{
+		/*
+		 * Still fits the same size class.
+		 */
+		new_block_p = block_p;
+	}
+	else if (size > HEAP_MAX_BLOCK_SIZE && old_size > HEAP_MAX_BLOCK_SIZE)
+	{
+		new_block_p = realloc(block_p, size);
+
+		if (!new_block_p)
+		{
+			return NULL;
+		}
+
+		m_heap_large_bytes_in_use += size - old_size;
+
+		if (m_heap_large_bytes_in_use > m_heap_large_peak_bytes_in_use)
+		{
+			m_heap_large_peak_bytes_in_use = m_heap_large_bytes_in_use;
+		}
+	}
+	else
+	{
+		new_block_p = heap_alloc(size);
+
+		if (!new_block_p)
+		{
+			return NULL;
+		}
+
+		memcpy(new_block_p, block_p, old_size < size ? old_size : size);
+		heap_free(block_p, old_size);
+
+		return new_block_p;
+	}
+
+	if (size > old_size)
+	{
+		memset((char*)new_block_p + old_size, 0, size - old_size);
+	}
+
+	return new_block_p;
+}
+
+/*
+ * Prints how many blocks and bytes each size class holds.
+ */
+void heap_print_statistics()
+{
+	int c;
+	heap_class_t *class_p;
+
+	printf("\n--------------------------------------------------------------------------------\n");
+	printf("Heap statistics:\n\n");
+	printf("%10s %12s %10s %12s %10s %12s %14s\n", "class", "allocations", "in use", "bytes in use", "peak", "peak bytes", "bytes in slabs");
+
+	for (c = 0; c < HEAP_NUMBER_OF_CLASSES; c++)
+	{
+		class_p = &m_heap_classes[c];
+
+		printf("%10d %12.0f %10d %12d %10d %12d %14d\n",
+			class_p->block_size,
+			class_p->allocations,
+			class_p->blocks_in_use,
+			class_p->blocks_in_use * class_p->block_size,
+			class_p->peak_blocks_in_use,
+			class_p->peak_blocks_in_use * class_p->block_size,
+			class_p->slabs * HEAP_SLAB_SIZE);
+	}
+
+	printf("%10s %12.0f %10d %12.0f %10s %12.0f %14s\n",
+		"large",
+		m_heap_large_allocations,
+		m_heap_large_blocks_in_use,
+		m_heap_large_bytes_in_use,
+		"-",
+		m_heap_large_peak_bytes_in_use,
+		"-");
+
+	printf("--------------------------------------------------------------------------------\n");
+}
@@ -0,0 +1,43 @@
+/*
+ * @file heap.h
+ *
+ * @description
+ *
+ * The VM heap that p++ strings and arrays (memory handles) live in.
+ *
+ * Small blocks are carved out of large slabs, one set of slabs per size
+ * class, and freed blocks are kept on their class's free list so they can
+ * be reused straight away without going back to the system allocator.
+ * Blocks bigger than the largest size class are allocated with calloc.
+ *
+ * Blocks don't store their own size, the caller passes it back in (every
+ * memory handle already records its size).
+ */
+
+#ifndef __HEAP_H
+#define __HEAP_H
+
+/*
+ * Size (in bytes) of the smallest size class.  Each class is twice the
+ * size of the one before it.
+ */
+#define HEAP_MIN_BLOCK_SIZE		16
+
+/*
+ * Number of size classes (the largest is 2048 bytes).
+ */
+#define HEAP_NUMBER_OF_CLASSES	8
+
+/*
+ * Size (in bytes) of the slabs that small blocks are carved from.
+ */
+#define HEAP_SLAB_SIZE			0x10000
+
+int heap_create();
+void heap_delete();
+void *heap_alloc(int size);
+void *heap_realloc(void *block_p, int old_size, int size);
+void heap_free(void *block_p, int size);
+void heap_print_statistics();
+
+#endif
@@ -1,5 +1,10 @@
 #include "types.h"
 #include "interpretor.h"
+#include "decoder.h"
+#include "profiler.h"
+#include "heap.h"
+#include "readahead.h"
+#include "server.h"
 #include "symbols.h"
 #include "stdlib.h"
 #include "string.h"
@@ -9,10 +14,21 @@
 #include "conio.h"
 #include "stdio.h"
 #define GETCH _getch();
+#define STREAM_GETC(f) getc(f)
 #else
 #include <strings.h>
 #include <curses.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #define GETCH getch();
+
+/*
+ * Only the interpretor thread touches a stream's FILE (read ahead threads
+ * read from their own) so there's no need to lock it for every character.
+ */
+#define STREAM_GETC(f) getc_unlocked(f)
 #endif
 
 /*
@@ -21,17 +37,41 @@
  */
 
 /*
- * Program stack size.
+ * Initial program stack size.  The stack grows on demand (when a function
+ * is entered) up to m_options.max_stack_size.
  */
-#define STACK_SIZE 0x2500
+#define INITIAL_STACK_SIZE 0x2500
 
 /*
- * How many dynamic memory handles are available.
- * Each p++ string/array requires one of these.
+ * How many dynamic memory handles are initially available.
+ * Each p++ string/array requires one of these.  The handle table doubles
+ * in size whenever it runs out.
  */
 #define NUMBER_OF_MEMORY_HANDLES 0x1000
 #define NUMBER_OF_FILES 0x100
 
+/*
+ * How many maps (see map.p++) a program can have at once.
+ */
+#define NUMBER_OF_MAPS 0x100
+
+/*
+ * Size of the buffer the bulk stream operations (OC_WRA, OC_RDB etc) move
+ * bytes through.
+ */
+#define STREAM_BUFFER_SIZE 0x1000
+
+/*
+ * Largest file OC_FMP can map (a view's size, header included, is an
+ * int).
+ */
+#define MAX_MAPPED_FILE_SIZE (0x7fffffff - ARRAY_HEADER_SIZE)
+
+/*
+ * Offset of the reference count in a block of memory (see memory.p++).
+ */
+#define MEMORY_REFCOUNT_OFFSET 0
+
  /*
  * Error macros.
  */
@@ -45,7 +85,7 @@
 
 /*#ifdef _DEBUG*/
 #define CHECK_MEMORY(x)	\
-	if (!x || x <= 0 || x >= NUMBER_OF_MEMORY_HANDLES || !m_memory_handles[x])	\
+	if (!x || x <= 0 || x >= m_memory_handles_size || !m_memory_handles[x])	\
 	{					\
 		printf("Null or invalid memory handle error (%d).\n", x);	\
 		return 0;	\
@@ -56,6 +96,24 @@
 #endif
 */
 
+/*
+ * Used instead of CHECK_MEMORY where the verifier has shown the handle
+ * is either 0 or was checked by the instruction before.
+ */
+#define CHECK_NULL_MEMORY(x)	\
+	if (!x)	\
+	{					\
+		printf("Null or invalid memory handle error (%d).\n", x);	\
+		return 0;	\
+	}
+
+#define CHECK_MAP(x)	\
+	if (x <= 0 || x >= NUMBER_OF_MAPS || !m_maps[x])	\
+	{					\
+		printf("Null or invalid map handle error (%d).\n", x);	\
+		return 0;	\
+	}
+
 /*
  * Program, base, top, instruction and temp registers.
  */
@@ -64,2083 +122,4456 @@ static int p, b, t, m_temp, m_size, param_count = 0;
 /*
  * Scratch pad registers (REG_AX - REG_EX).
  */
-static int m_registers[6];
-static int *m_memory_handles[NUMBER_OF_MEMORY_HANDLES];
+static int m_registers[NUMBER_OF_REGISTERS];
+static int **m_memory_handles;
+static int m_memory_handles_size;
+
+/*
+ * Kinds of view.
+ */
+#define MEMORY_VIEW_MAPPED		1
+#define MEMORY_VIEW_SLICE		2
+
+/*
+ * A memory handle whose elements live somewhere else.  The handle's own
+ * memory is just an array header (so reference counting and the array's
+ * length work as usual) and its elements are loaded through the view.
+ * Storing to an element copies the elements into ordinary memory first
+ * (see view_detach).
+ */
+typedef struct tag_memory_view memory_view_t;
+
+struct tag_memory_view
+{
+	int kind;
+
+	/*
+	 * Number of elements in the view.
+	 */
+	int length;
+
+	/*
+	 * MEMORY_VIEW_MAPPED: a file mapped read only (each byte is widened to
+	 * an element when it's loaded) and the size of the mapping.
+	 */
+	unsigned char *bytes;
+	int mapped_size;
+
+	/*
+	 * MEMORY_VIEW_SLICE: the handle whose elements are shared (the slice
+	 * holds a reference to it), the first shared element and the handle's
+	 * previous and next slices.
+	 */
+	int parent;
+	int offset;
+	int prev;
+	int next;
+};
+
+/*
+ * Each memory handle's view (NULL for ordinary memory).
+ */
+static memory_view_t **m_memory_views;
+
+/*
+ * Each memory handle's first slice (0 if it has none).
+ */
+static int *m_memory_slices;
+
+/*
+ * Stack of free memory handles (the next handle to use is on top).
+ */
+static int *m_free_handles;
+static int m_free_handles_count;
 static FILE *m_files[NUMBER_OF_FILES];
-static int real_interpret(instruction_t* code);
+
+/*
+ * Maps, each a hashtable of integer keys to integer values.  A map handle
+ * is an index into this table.
+ */
+static hashtable_t *m_maps[NUMBER_OF_MAPS];
+static int real_interpret(decoded_instruction_t *code, int count);
 
 /*
  * Stack.
  */
-static int m_stack[STACK_SIZE];
+static int *m_stack;
+static int m_stack_size;
 
-int find_free_memory_handle()
+/*
+ * Display registers.
+ *
+ * m_display[k] is the base of the frame at lexical level k on the static
+ * chain of the current frame (m_level is the current frame's level) so
+ * base(l, b) is always m_display[m_level - l].  A call only changes the
+ * entry for the callee's level and the previous value is kept on a
+ * separate stack so that the frame layout doesn't change.
+ *
+ * Define NO_DISPLAY_REGISTERS to walk the static links instead.
+ */
+#ifndef NO_DISPLAY_REGISTERS
+
+typedef struct tag_display_save display_save_t;
+
+struct tag_display_save
 {
-	register int i;
+	int level;
+	int display;
+};
 
-	for (i = 1; i < NUMBER_OF_MEMORY_HANDLES; i++)
-	{
-		if (m_memory_handles[i] == 0)
-		{
-			return i;
-		}
-	}
+/*
+ * Every frame takes at least 3 stack entries so the save stack grows
+ * along with the stack.
+ */
+#define MAX_CALL_DEPTH(stack_size) ((stack_size) / 3 + 1)
 
-	INTERPRET_ERROR("Out of memory handles.\n");
-	
-	return -1;
-}
+static int m_display[MAX_LEVEL + 2];
+static int m_level;
+static display_save_t *m_display_saves;
+static int m_max_call_depth;
+static int m_call_depth;
+
+/*
+ * Most accesses are to the current frame.
+ */
+#define FRAME(l) ((l) ? m_display[m_level - (l)] : b)
 
+/*
+ * Updates the display after calling a function with the frame at b whose
+ * static link is l levels down from the caller.
+ */
+#define DISPLAY_CALL(l)	\
+	if (m_call_depth >= m_max_call_depth)	\
+	{	\
+		goto stack_overflow;	\
+	}	\
+	m_display_saves[m_call_depth].level = m_level;	\
+	m_level = m_level - (l) + 1;	\
+	m_display_saves[m_call_depth].display = m_display[m_level];	\
+	m_call_depth++;	\
+	m_display[m_level] = b;
 
-int find_free_file()
+/*
+ * Restores the display after returning from a function.
+ */
+#define DISPLAY_RETURN()	\
+	m_call_depth--;	\
+	m_display[m_level] = m_display_saves[m_call_depth].display;	\
+	m_level = m_display_saves[m_call_depth].level;
+
+#else
+
+#define FRAME(l) base(l, b)
+#define DISPLAY_CALL(l)
+#define DISPLAY_RETURN()
+
+#endif
+
+/*
+ * Grows the memory handle table to size entries and puts the new
+ * handles on the free stack (lowest handle on top).
+ *
+ * @returns 0 if out of memory.
+ */
+static int grow_memory_handles(int size)
 {
-	register int i;
+	int i;
+	int **handles_p;
+	int *free_p;
+	memory_view_t **views_p;
+	int *slices_p;
 
-	for (i = 1; i < NUMBER_OF_FILES; i++)
+	handles_p = (int**)realloc(m_memory_handles, size * sizeof(int*));
+
+	if (!handles_p)
 	{
-		if (m_files[i] == 0)
-		{
-			return i;
-		}
+		return 0;
 	}
 
-	INTERPRET_ERROR("Out of file storage locations.\n");
-	
-	return -1;
-}
+	m_memory_handles = handles_p;
 
+	views_p = (memory_view_t**)realloc(m_memory_views, size * sizeof(memory_view_t*));
 
-int all_handles_free()
-{
-	int i;
+	if (!views_p)
+	{
+		return 0;
+	}
+
+	m_memory_views = views_p;
 
-	for (i = 1; i < NUMBER_OF_MEMORY_HANDLES; i++)
+	slices_p = (int*)realloc(m_memory_slices, size * sizeof(int));
+
+	if (!slices_p)
 	{
-		if (m_memory_handles[i] != 0)
-		{
-			return 0;
-		}
+		return 0;
 	}
 
-	return 1;
-}
+	m_memory_slices = slices_p;
 
-int free_memory_handles()
-{
-	int i;
+	free_p = (int*)realloc(m_free_handles, size * sizeof(int));
 
-	for (i = 1; i < NUMBER_OF_MEMORY_HANDLES; i++)
+	if (!free_p)
 	{
-		if (m_memory_handles[i] != 0)
-		{
-			free(--m_memory_handles[i]);
-		}
+		return 0;
 	}
 
-	return 1;
-}
+	m_free_handles = free_p;
 
-int close_files()
-{
-	int i;
+	/*
+	 * Handle 0 is never used (it is the null handle).
+	 */
+	for (i = size - 1; i >= m_memory_handles_size && i > 0; i--)
+	{
+		m_memory_handles[i] = 0;
+		m_memory_views[i] = NULL;
+		m_memory_slices[i] = 0;
+		m_free_handles[m_free_handles_count++] = i;
+	}
 
-	for (i = 1; i < NUMBER_OF_MEMORY_HANDLES; i++)
+	if (m_memory_handles_size == 0)
 	{
-		if (m_files[i] != 0)
-		{
-			fclose(m_files[i]);
-		}
+		m_memory_handles[0] = 0;
+		m_memory_views[0] = NULL;
+		m_memory_slices[0] = 0;
 	}
 
+	m_memory_handles_size = size;
+
 	return 1;
 }
 
+static int memory_handles_create()
+{
+	m_memory_handles = NULL;
+	m_memory_views = NULL;
+	m_memory_slices = NULL;
+	m_memory_handles_size = 0;
+	m_free_handles = NULL;
+	m_free_handles_count = 0;
+
+	return grow_memory_handles(NUMBER_OF_MEMORY_HANDLES);
+}
 
-int base(int l, int b)
-{  
-	int b1; /* find base l levels down */
+static void memory_handles_delete()
+{
+	free(m_memory_handles);
+	free(m_memory_views);
+	free(m_memory_slices);
+	free(m_free_handles);
+
+	m_memory_handles = NULL;
+	m_memory_views = NULL;
+	m_memory_slices = NULL;
+	m_memory_handles_size = 0;
+	m_free_handles = NULL;
+	m_free_handles_count = 0;
+}
 
-	b1 = b; 
-	
-	while (l > 0)
-	{
-		/*
-		 * m_stack[b1] is the static link
-		 */
+/*
+ * Resizes the memory for a handle to size integers (any new space is
+ * zeroed).
+ *
+ * @returns The new memory or NULL if out of memory.
+ */
+static int *resize_memory_handle(int address, int size)
+{
+	int *i_p1;
 
-		b1 = m_stack[b1];
+	i_p1 = m_memory_handles[address] - 1;
+	i_p1 = heap_realloc(i_p1, (*i_p1 + 1) * sizeof(int), (size + 1) * sizeof(int));
 
-		l--;
+	if (!i_p1)
+	{
+		return NULL;
 	}
-	return b1;
+
+	*i_p1 = size;
+	m_memory_handles[address] = i_p1 + 1;
+
+	return i_p1 + 1;
 }
 
+/*
+ * Loads a cell of a handle's memory.
+ */
+#define MEMORY_LOAD(x, offset)	\
+	(m_memory_views[x] ? view_load(x, offset) : m_memory_handles[x][offset])
 
-int fop(int op, float *f1_p, float *f2_p, float *result);
+/*
+ * Size (in integers, header included) of a handle's memory.
+ */
+#define MEMORY_SIZE(x)	\
+	(m_memory_views[x] ? ARRAY_HEADER_SIZE + m_memory_views[x]->length : m_memory_handles[x][-1])
 
-int file_close(instruction_t *code)
+/*
+ * Loads a cell of a view's memory (the header is the handle's own memory
+ * and cells past the view's elements load as 0).
+ */
+static int view_load(int address, int offset)
 {
-	register int address;
+	memory_view_t *view_p;
 
-	address = m_stack[t];
+	view_p = m_memory_views[address];
+	offset -= ARRAY_HEADER_SIZE;
 
-	if (address
-		&& m_files[address])
+	if (offset < 0)
 	{
-		fclose(m_files[address]);
-		m_files[address] = NULL;
+		return m_memory_handles[address][offset + ARRAY_HEADER_SIZE];
 	}
 
-	t--;
-	
-	return 1;
+	if (offset >= view_p->length)
+	{
+		return 0;
+	}
+
+	if (view_p->kind == MEMORY_VIEW_SLICE)
+	{
+		return MEMORY_LOAD(view_p->parent, ARRAY_HEADER_SIZE + view_p->offset + offset);
+	}
+
+	return view_p->bytes[offset];
 }
 
-int file_open(instruction_t *code)
+/*
+ * Drops a view (the handle's header memory is left alone).
+ */
+static void view_delete(int address)
 {
-	int i, *i_p1, len, flags;
-	register int address;
-	char mode[128];
-	char filename[MAX_PATH];
-	
-	mode[0] = 0;
+	memory_view_t *view_p;
 
-	len = m_stack[t--];
-	address = m_stack[t--];
-	flags = m_stack[t];
+	view_p = m_memory_views[address];
 
-	CHECK_MEMORY(address);
-	
-	i_p1 = ((int*)m_memory_handles[address]);
-	i_p1 += m_registers[REG_CX];
-	
-	for (i = 0; i < len; i++)
+#ifndef _WIN32
+	if (view_p->kind == MEMORY_VIEW_MAPPED)
 	{
-		filename[i] = i_p1[i];
+		munmap(view_p->bytes, view_p->mapped_size);
 	}
+#endif
 
-	filename[i] = 0;
+	free(view_p);
 
-	if (flags & F_APPEND)
+	m_memory_views[address] = NULL;
+}
+
+/*
+ * Takes a handle off the free stack, growing the table if there are none.
+ *
+ * @returns 0 if out of memory.
+ */
+int find_free_memory_handle()
+{
+	if (m_free_handles_count == 0 && !grow_memory_handles(m_memory_handles_size * 2))
 	{
-		strcat(mode, "a+");
+		INTERPRET_ERROR("Out of memory handles.\n");
 	}
-	else if (flags & F_READ)
+
+	return m_free_handles[--m_free_handles_count];
+}
+
+/*
+ * Returns a handle that has been freed to the free stack.
+ */
+#define RELEASE_MEMORY_HANDLE(x)	\
+	m_memory_handles[x] = 0;	\
+	m_free_handles[m_free_handles_count++] = x;
+
+/*
+ * Frees the memory for a handle (and drops its view) and returns the
+ * handle to the free stack.
+ */
+#define FREE_MEMORY_HANDLE(x)	\
+	if (m_memory_views[x])	\
+	{	\
+		view_release(x);	\
+	}	\
+	heap_free(m_memory_handles[x] - 1, (m_memory_handles[x][-1] + 1) * sizeof(int));	\
+	RELEASE_MEMORY_HANDLE(x);
+
+/*
+ * Drops a view and, if it's a slice, unlinks it from its parent's slices
+ * and releases its reference to the parent.
+ */
+static void view_release(int address)
+{
+	int parent;
+	memory_view_t *view_p;
+
+	view_p = m_memory_views[address];
+	parent = 0;
+
+	if (view_p->kind == MEMORY_VIEW_SLICE)
 	{
-		if (flags & F_WRITE)
+		parent = view_p->parent;
+
+		if (view_p->prev)
 		{
-			if (flags & F_CREATE)
-			{
-				strcat(mode, "w+");
-			}
-			else
-			{
-				strcat(mode, "r+");
-			}
+			m_memory_views[view_p->prev]->next = view_p->next;
 		}
 		else
 		{
-			strcat(mode, "r");
+			m_memory_slices[parent] = view_p->next;
 		}
-	}
-	else if (flags & F_WRITE)
-	{
-		strcat(mode, "w");
-	}
 
-	if (flags & F_BINARY)
-	{
-		strcat(mode, "b");
-	}
-	else if (flags & F_TEXT)
-	{
-		strcat(mode, "t");
+		if (view_p->next)
+		{
+			m_memory_views[view_p->next]->prev = view_p->prev;
+		}
 	}
 
-	m_temp = find_free_file();
-	m_files[m_temp] = fopen(filename, mode);
+	view_delete(address);
 
-	if (m_files[m_temp])
-	{
-		m_stack[t] = m_temp;
-	}
-	else
+	if (parent && --m_memory_handles[parent][MEMORY_REFCOUNT_OFFSET] == 0)
 	{
-		m_stack[t] = 0;
+		FREE_MEMORY_HANDLE(parent);
 	}
-
-	return 1;
 }
 
 /*
- * Returns pointers to the two integers being worked on by inline operators
- * (++, --, *= etc).
+ * Copies a view's elements into ordinary memory that the handle then owns
+ * (its header is kept).
+ *
+ * @returns The handle's new memory or NULL if out of memory.
  */
-int inline_operands(instruction_t *code, int **i_pp1, int **i_pp2)
-{	
-	register int address;
+static int *view_detach(int address)
+{
+	int i, size, *i_p1;
 
-	*i_pp2 = &m_stack[t];
+	size = MEMORY_SIZE(address);
 
-	address = base(code[p].l, b) + code[p].a;
+	i_p1 = heap_alloc((size + 1) * sizeof(int));
 
-	if (m_registers[REG_DX] & REG_MEMORY_FLAG)
+	if (!i_p1)
 	{
-		CHECK_MEMORY(m_stack[base(code[p].l, b) + code[p].a]);
-		
-		*i_pp1 = ((int*)m_memory_handles[m_stack[address]]);
-		*i_pp1 += m_registers[REG_CX];
+		return NULL;
 	}
-	else
+
+	*i_p1++ = size;
+
+	for (i = 0; i < size; i++)
 	{
-		*i_pp1 = &m_stack[address];
+		i_p1[i] = view_load(address, i);
 	}
 
-	return 1;
+	heap_free(m_memory_handles[address] - 1, (ARRAY_HEADER_SIZE + 1) * sizeof(int));
+	view_release(address);
+
+	m_memory_handles[address] = i_p1;
+
+	return i_p1;
 }
 
 /*
- * Returns pointers to the two integers being worked on by inline operators
- * (++, --, *= etc).
+ * Detaches all of a handle's slices (before its elements change).
+ *
+ * @returns 0 if out of memory.
  */
-int inline_indirect_operands(instruction_t *code, int **i_pp1, int **i_pp2)
-{	
-	register int address;
+static int view_detach_slices(int address)
+{
+	int ok;
 
-	*i_pp2 = &m_stack[t];
+	/*
+	 * Hold on to the handle so that detaching its last slice doesn't
+	 * free it.
+	 */
+	m_memory_handles[address][MEMORY_REFCOUNT_OFFSET]++;
 
-	address = m_stack[base(code[p].l, b) + code[p].a];
+	ok = 1;
 
-	if (m_registers[REG_DX] & REG_MEMORY_FLAG)
+	while (ok && m_memory_slices[address])
 	{
-		CHECK_MEMORY(m_stack[address]);
+		ok = view_detach(m_memory_slices[address]) != NULL;
+	}
 
-		*i_pp1 = ((int*)m_memory_handles[m_stack[address]]);
-		*i_pp1 += m_registers[REG_CX];
+	m_memory_handles[address][MEMORY_REFCOUNT_OFFSET]--;
+
+	return ok;
+}
+
+/*
+ * Makes sure a handle's memory can be stored to at offset (cells in a
+ * header can always be stored to).  A view is copied into ordinary memory
+ * and a handle's slices are given copies of the elements they share.
+ */
+#define CHECK_STORE(x, offset)	\
+	if ((m_memory_views[x] || m_memory_slices[x]) && (offset) >= ARRAY_HEADER_SIZE	\
+		&& ((m_memory_slices[x] && !view_detach_slices(x)) || (m_memory_views[x] && !view_detach(x))))	\
+	{	\
+		INTERPRET_ERROR("Out of memory.\n");	\
 	}
-	else
+
+/*
+ * Gives a view a new handle (with no references) whose memory is the
+ * view's header.
+ *
+ * @returns The handle or 0 if out of memory (the view isn't freed).
+ */
+static int view_new(memory_view_t *view_p)
+{
+	int *i_p1, handle;
+
+	i_p1 = heap_alloc((ARRAY_HEADER_SIZE + 1) * sizeof(int));
+
+	if (!i_p1)
 	{
-		*i_pp1 = &m_stack[address];
+		return 0;
 	}
 
-	return 1;
-}
+	*i_p1++ = ARRAY_HEADER_SIZE;
 
-int interpret(instruction_t* code)
-{
-	if (code == NULL)
+	handle = find_free_memory_handle();
+
+	if (!handle)
 	{
-		return FALSE;
+		heap_free(i_p1 - 1, (ARRAY_HEADER_SIZE + 1) * sizeof(int));
+
+		return 0;
 	}
 
-	real_interpret(code);
-	free_memory_handles();
+	i_p1[ARRAY_LENGTH_OFFSET] = view_p->length;
 
-	return TRUE;
-}
+	m_memory_handles[handle] = i_p1;
+	m_memory_views[handle] = view_p;
 
-#ifdef WIN32
-__forceinline 
-#endif
+	return handle;
+}
 
-int single_interpret(instruction_t* code)
+/*
+ * Makes a slice that shares some of an array's elements.
+ * [array][offset][length]
+ *
+ * The offset and length are clipped to the array.  The stack is left
+ * holding the slice's handle (with no references) or 0 if the array is
+ * null.
+ */
+static int memory_slice()
 {
-	float *f_p1;	
-	int *i_p1, *i_p2, j, len;
-	int temp, address;
+	int address, offset, length, size, handle;
+	memory_view_t *view_p;
+
+	length = m_stack[t--];
+	offset = m_stack[t--];
+	address = m_stack[t];
 
-	switch (code[p].f)
+	if (!address)
 	{
-		case OC_NOP:
-			
-			p++;
+		return 1;
+	}
 
-			break;
+	CHECK_MEMORY(address);
 
-		case OC_TRM:
+	size = MIN(m_memory_handles[address][ARRAY_LENGTH_OFFSET], MEMORY_SIZE(address) - ARRAY_HEADER_SIZE);
+	offset = MAX(MIN(offset, size), 0);
+	length = MAX(MIN(length, size - offset), 0);
 
-			return 0;
+	/*
+	 * A slice of a slice shares the elements of the first slice's parent.
+	 */
+	if (m_memory_views[address] && m_memory_views[address]->kind == MEMORY_VIEW_SLICE)
+	{
+		offset += m_memory_views[address]->offset;
+		address = m_memory_views[address]->parent;
+	}
 
-			break;
+	view_p = (memory_view_t*)malloc(sizeof(memory_view_t));
 
-		case OC_SWS:
-			
-			/*
-			 * Swaps the top two elements on the stack around.
-			 */
+	if (!view_p)
+	{
+		INTERPRET_ERROR("Out of memory.\n");
+	}
 
-			temp = m_stack[t];
-			m_stack[t] = m_stack[t - 1];
-			m_stack[t - 1] = temp;
+	view_p->kind = MEMORY_VIEW_SLICE;
+	view_p->length = length;
+	view_p->bytes = NULL;
+	view_p->mapped_size = 0;
+	view_p->parent = address;
+	view_p->offset = offset;
+	view_p->prev = 0;
+	view_p->next = m_memory_slices[address];
 
-			p++;
+	handle = view_new(view_p);
 
-			break;
+	if (!handle)
+	{
+		free(view_p);
 
-		case OC_PAS:
-		
-			/*
-			 * Pass stack into a working register (like pop but doesn't pop).
-			 */
+		INTERPRET_ERROR("Out of memory.\n");
+	}
 
-			if (code[p].a != 0)
-			{
-				m_registers[code[p].a] = m_stack[t];
-			}
+	if (view_p->next)
+	{
+		m_memory_views[view_p->next]->prev = handle;
+	}
 
-			p++;
-			
-			break;
+	m_memory_slices[address] = handle;
+	m_memory_handles[address][MEMORY_REFCOUNT_OFFSET]++;
 
-		case OC_POP:
-		
-			/*
-			 * Pop onto a working register.
-			 */
-			
-			if (code[p].a == 0)
-			{
-				t--;
-			}
-			else
-			{
-				m_registers[code[p].a] = m_stack[t--];
-			}
+	m_stack[t] = handle;
 
-			p++;
-			
-			break;
+	return 1;
+}
 
-		case OC_MOV:
-			
-			/*
-			 * Move data from one register to another.
-			 */
+/*
+ * Removes a reference from a memory handle and frees the memory when the
+ * last reference goes (null handles are ignored).
+ */
+#define RELEASE_REFERENCE(x)	\
+	if (x)	\
+	{	\
+		CHECK_MEMORY(x);	\
+		\
+		if (--m_memory_handles[x][MEMORY_REFCOUNT_OFFSET] == 0)	\
+		{	\
+			FREE_MEMORY_HANDLE(x);	\
+		}	\
+	}
 
-			m_registers[code[p].a] = m_registers[code[p].l];
 
-			p++;
+int find_free_file()
+{
+	register int i;
 
-			break;
+	for (i = 1; i < NUMBER_OF_FILES; i++)
+	{
+		if (m_files[i] == 0)
+		{
+			return i;
+		}
+	}
 
-		case OC_RIO:
-			
-			/*
-			 * Does a bit-wise OR on a register.
-			 */
+	INTERPRET_ERROR("Out of file storage locations.\n");
+	
+	return -1;
+}
 
-			m_registers[code[p].a] |= code[p].l;
 
-			p++;
+int all_handles_free()
+{
+	return m_free_handles_count == m_memory_handles_size - 1;
+}
 
-			break;
+int free_memory_handles()
+{
+	int i;
 
-		case OC_SRG:
+	for (i = 1; i < m_memory_handles_size; i++)
+	{
+		if (m_memory_views[i])
+		{
+			view_delete(i);
+		}
 
-			/*
-			 * Statically set a register.
-			 */
+		if (m_memory_handles[i] != 0)
+		{
+			m_memory_handles[i]--;
 
-			if (code[p].a != 0)
-			{
-				m_registers[code[p].a] = code[p].l;
-			}
+			heap_free(m_memory_handles[i], (*m_memory_handles[i] + 1) * sizeof(int));
+		}
+	}
 
-			p++;
+	return 1;
+}
 
-			break;
+int close_files()
+{
+	int i;
 
-		case OC_PUS:
+	for (i = 1; i < NUMBER_OF_FILES; i++)
+	{
+		if (m_files[i] != 0)
+		{
+			fclose(m_files[i]);
+			m_files[i] = NULL;
+		}
+	}
 
-			/*
-			 * Push off a working register.
-			 */
-			
-			if (code[p].a == 0)
-			{
-				t++;
-			}
-			else
-			{
-				m_stack[++t] = m_registers[code[p].a];
-			}
+	return 1;
+}
 
-			p++;
+int close_maps()
+{
+	int i;
 
-			break;
+	for (i = 1; i < NUMBER_OF_MAPS; i++)
+	{
+		if (m_maps[i] != 0)
+		{
+			hashtable_delete(m_maps[i]);
+			m_maps[i] = NULL;
+		}
+	}
 
-		case OC_SLD:
-			
-			/*
-			 * Loads up a value from somewhere in the stack.
-			 * The offset is given by code[p].a
-			 */
+	return 1;
+}
 
-			m_stack[t + 1] = m_stack[t - code[p].a];
 
-			t++;
+int base(int l, int b)
+{  
+	int b1; /* find base l levels down */
 
-			p++;
+	b1 = b; 
+	
+	while (l > 0)
+	{
+		/*
+		 * m_stack[b1] is the static link
+		 */
 
-			break;
+		b1 = m_stack[b1];
 
-		case OC_LIT:
+		l--;
+	}
+	return b1;
+}
 
-			/*
-			 * Load a literal number.
-			 */
+/*
+ * Allocates the stack at its initial size.
+ *
+ * @returns 0 if out of memory.
+ */
+static int stack_create()
+{
+	m_stack_size = INITIAL_STACK_SIZE;
 
-			m_stack[++t] = code[p].a;
-			
-			p++;
-			
-			break;
+	if (m_options.max_stack_size > 0 && m_options.max_stack_size < m_stack_size)
+	{
+		m_stack_size = m_options.max_stack_size;
+	}
 
-		case OC_LIS:
-			
-			/*
-			 * Loads up 'l' number of 'a' integers.
-			 */
+	m_stack = (int*)calloc(m_stack_size, sizeof(int));
 
-			m_temp = t;
+#ifndef NO_DISPLAY_REGISTERS
+	m_max_call_depth = MAX_CALL_DEPTH(m_stack_size);
+	m_display_saves = (display_save_t*)calloc(m_max_call_depth, sizeof(display_save_t));
 
-			while (t < m_temp + code[p].l)
-			{
-				t++;
-				m_stack[t] = code[p].a;
-			}				
-			
-			p++;
+	if (!m_display_saves)
+	{
+		return 0;
+	}
+#endif
 
-			break;
+	return m_stack != NULL;
+}
 
-		case OC_SRV:
-			
-			/*
-			 * Set the return value.
-			 */
-			
-			m_stack[b - code[p].a] = m_stack[t];
-			
-			p++;
-			t--;
+static void stack_delete()
+{
+	free(m_stack);
 
-			break;
+	m_stack = NULL;
+	m_stack_size = 0;
+
+#ifndef NO_DISPLAY_REGISTERS
+	free(m_display_saves);
+
+	m_display_saves = NULL;
+	m_max_call_depth = 0;
+#endif
+}
+
+/*
+ * Grows the stack so that it has at least needed + 1 entries.
+ *
+ * @returns 0 if the stack can't grow that large.
+ */
+static int grow_stack(int needed)
+{
+	int size, max_size;
+	int *stack_p;
+
+	max_size = m_options.max_stack_size > 0 ? m_options.max_stack_size : DEFAULT_MAX_STACK_SIZE;
+
+	size = m_stack_size;
+
+	while (size <= needed && size < max_size)
+	{
+		size *= 2;
+	}
+
+	if (size > max_size)
+	{
+		size = max_size;
+	}
+
+	if (size <= needed)
+	{
+		return 0;
+	}
+
+	stack_p = (int*)realloc(m_stack, size * sizeof(int));
+
+	if (!stack_p)
+	{
+		return 0;
+	}
+
+	memset(stack_p + m_stack_size, 0, (size - m_stack_size) * sizeof(int));
+
+#ifndef NO_DISPLAY_REGISTERS
+	{
+		display_save_t *saves_p;
+
+		saves_p = (display_save_t*)realloc(m_display_saves, MAX_CALL_DEPTH(size) * sizeof(display_save_t));
+
+		if (!saves_p)
+		{
+			m_stack = stack_p;
+
+			return 0;
+		}
+
+		m_display_saves = saves_p;
+		m_max_call_depth = MAX_CALL_DEPTH(size);
+	}
+#endif
+
+	m_stack = stack_p;
+	m_stack_size = size;
+
+	return 1;
+}
+
+
+
+int file_close(decoded_instruction_t *code)
+{
+	register int address;
+
+	address = m_stack[t];
+
+	if (address
+		&& m_files[address])
+	{
+		fclose(m_files[address]);
+		m_files[address] = NULL;
+	}
+
+	t--;
+	
+	return 1;
+}
+
+/*
+ * Copies a string (such as a file name) out of memory into a buffer of
+ * size chars (the offset to the string is in REG_CX).
+ */
+static void memory_to_string(int address, int len, char *s, int size)
+{
+	int i;
+
+	if (len >= size)
+	{
+		len = size - 1;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		s[i] = MEMORY_LOAD(address, m_registers[REG_CX] + i);
+	}
+
+	s[i] = 0;
+}
+
+int file_open(decoded_instruction_t *code)
+{
+	int len, flags;
+	register int address;
+	char mode[128];
+	char filename[MAX_PATH];
+	
+	mode[0] = 0;
+
+	len = m_stack[t--];
+	address = m_stack[t--];
+	flags = m_stack[t];
+
+	CHECK_MEMORY(address);
+
+	memory_to_string(address, len, filename, MAX_PATH);
+
+	if (flags & F_APPEND)
+	{
+		strcat(mode, "a+");
+	}
+	else if (flags & F_READ)
+	{
+		if (flags & F_WRITE)
+		{
+			if (flags & F_CREATE)
+			{
+				strcat(mode, "w+");
+			}
+			else
+			{
+				strcat(mode, "r+");
+			}
+		}
+		else
+		{
+			strcat(mode, "r");
+		}
+	}
+	else if (flags & F_WRITE)
+	{
+		strcat(mode, "w");
+	}
+
+	if (flags & F_BINARY)
+	{
+		strcat(mode, "b");
+	}
+	else if (flags & F_TEXT)
+	{
+		strcat(mode, "t");
+	}
+
+	m_temp = find_free_file();
+
+	if ((flags & F_READ_AHEAD) || m_options.read_ahead)
+	{
+		m_files[m_temp] = read_ahead_open(filename, mode);
+	}
+	else
+	{
+		m_files[m_temp] = fopen(filename, mode);
+	}
+
+	if (m_files[m_temp])
+	{
+		m_stack[t] = m_temp;
+	}
+	else
+	{
+		m_stack[t] = 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Returns the file for a stream (stream 0 is std).
+ *
+ * @returns NULL if the stream isn't open.
+ */
+static FILE *stream_file(int stream, FILE *std)
+{
+	if (stream == 0)
+	{
+		return std;
+	}
+
+	if (stream < 0 || stream >= NUMBER_OF_FILES)
+	{
+		return NULL;
+	}
+
+	return m_files[stream];
+}
+
+/*
+ * Writes a slice of an array to a stream in one go.
+ * [stream][array handle][offset][count]
+ *
+ * Each cell is narrowed to a byte (like OC_WRB) and the bytes are handed
+ * to fwrite a buffer at a time.  Stream 0 is stdout.
+ */
+int file_write_array(decoded_instruction_t *code)
+{
+	int i, n, *i_p1, offset, count, size;
+	register int address;
+	FILE *file;
+	char buffer[STREAM_BUFFER_SIZE];
+
+	count = m_stack[t--];
+	offset = m_stack[t--];
+	address = m_stack[t--];
+	m_temp = m_stack[t--];
+
+	if (count <= 0)
+	{
+		return 1;
+	}
+
+	CHECK_MEMORY(address);
+
+	size = MEMORY_SIZE(address);
+
+	if (offset < 0 || offset > size - ARRAY_HEADER_SIZE
+		|| count > size - ARRAY_HEADER_SIZE - offset)
+	{
+		INTERPRET_ERROR("Array write out of bounds.\n");
+	}
+
+	file = stream_file(m_temp, stdout);
+
+	if (!file)
+	{
+		INTERPRET_ERROR("Invalid stream.\n");
+	}
+
+	offset += ARRAY_HEADER_SIZE;
+
+	while (count > 0)
+	{
+		n = count < STREAM_BUFFER_SIZE ? count : STREAM_BUFFER_SIZE;
+
+		if (m_memory_views[address])
+		{
+			for (i = 0; i < n; i++)
+			{
+				buffer[i] = (char)view_load(address, offset + i);
+			}
+		}
+		else
+		{
+			i_p1 = m_memory_handles[address] + offset;
+
+			for (i = 0; i < n; i++)
+			{
+				buffer[i] = (char)i_p1[i];
+			}
+		}
+
+		fwrite(buffer, 1, n, file);
+
+		offset += n;
+		count -= n;
+	}
+
+	return 1;
+}
+
+/*
+ * Makes sure the array for handle has room for size elements, allocating
+ * it if the handle is 0.  The array grows geometrically so appending a
+ * character at a time stays cheap.
+ *
+ * @returns The array's elements or NULL if out of memory.
+ */
+static int *reserve_array(int *handle, int size)
+{
+	int *i_p1, capacity;
+
+	if (!*handle)
+	{
+		capacity = ARRAY_HEADER_SIZE + (size > ARRAY_RESOLUTION ? size : ARRAY_RESOLUTION);
+
+		i_p1 = heap_alloc((capacity + 1) * sizeof(int));
+
+		if (!i_p1)
+		{
+			return NULL;
+		}
+
+		*i_p1 = capacity;
+
+		*handle = find_free_memory_handle();
+
+		if (!*handle)
+		{
+			heap_free(i_p1, (capacity + 1) * sizeof(int));
+
+			return NULL;
+		}
+
+		m_memory_handles[*handle] = i_p1 + 1;
+
+		return i_p1 + 1 + ARRAY_HEADER_SIZE;
+	}
+
+	i_p1 = m_memory_handles[*handle];
+
+	if (i_p1[-1] < ARRAY_HEADER_SIZE + size)
+	{
+		capacity = i_p1[-1] * 2;
+
+		if (capacity < ARRAY_HEADER_SIZE + size)
+		{
+			capacity = ARRAY_HEADER_SIZE + size;
+		}
+
+		i_p1 = resize_memory_handle(*handle, capacity);
+
+		if (!i_p1)
+		{
+			return NULL;
+		}
+	}
+
+	return i_p1 + ARRAY_HEADER_SIZE;
+}
+
+/*
+ * Reads from a stream into a new array.
+ * [stream] (OC_RDL and OC_RDA) or [stream][count] (OC_RDB)
+ *
+ * OC_RDL reads up to the end of the line (a '\r', '\n' or "\r\n" which
+ * isn't stored), OC_RDB reads up to count bytes and OC_RDA reads the rest
+ * of the stream.  Stream 0 is stdin.  The stack is left holding the
+ * handle to the new array (with no references) or 0 if the stream had
+ * already ended.  A negative count for OC_RDB is an error (it would
+ * otherwise read the whole stream).
+ */
+int file_read_array(decoded_instruction_t *code)
+{
+	int i, c, n, len, max, *i_p1, handle;
+	FILE *file;
+	unsigned char buffer[STREAM_BUFFER_SIZE];
+
+	max = -1;
+
+	if (code->op == IOP_RDB)
+	{
+		max = m_stack[t--];
+
+		if (max < 0)
+		{
+			INTERPRET_ERROR("Negative count.\n");
+		}
+	}
+
+	file = stream_file(m_stack[t], stdin);
+
+	if (!file)
+	{
+		INTERPRET_ERROR("Invalid stream.\n");
+	}
+
+	len = 0;
+	handle = 0;
+
+	if (code->op == IOP_RDL)
+	{
+		while ((c = STREAM_GETC(file)) != EOF)
+		{
+			if (c == '\n')
+			{
+				break;
+			}
+
+			if (c == '\r')
+			{
+				if ((c = STREAM_GETC(file)) != '\n' && c != EOF)
+				{
+					ungetc(c, file);
+				}
+
+				c = '\n';
+
+				break;
+			}
+
+			if (!(i_p1 = reserve_array(&handle, len + 1)))
+			{
+				INTERPRET_ERROR("Out of memory.\n");
+			}
+
+			i_p1[len++] = c;
+		}
+
+		if (c == '\n' && !handle && !(i_p1 = reserve_array(&handle, 0)))
+		{
+			INTERPRET_ERROR("Out of memory.\n");
+		}
+	}
+	else
+	{
+		while (max < 0 || len < max)
+		{
+			n = STREAM_BUFFER_SIZE;
+
+			if (max >= 0 && max - len < n)
+			{
+				n = max - len;
+			}
+
+			n = fread(buffer, 1, n, file);
+
+			if (n <= 0)
+			{
+				break;
+			}
+
+			if (!(i_p1 = reserve_array(&handle, len + n)))
+			{
+				INTERPRET_ERROR("Out of memory.\n");
+			}
+
+			for (i = 0; i < n; i++)
+			{
+				i_p1[len + i] = buffer[i];
+			}
+
+			len += n;
+		}
+	}
+
+	if (handle)
+	{
+		m_memory_handles[handle][ARRAY_LENGTH_OFFSET] = len;
+	}
+
+	m_stack[t] = handle;
+
+	return 1;
+}
+
+/*
+ * Looks up an environment variable.
+ * [name handle][name length] (the offset to the name is in REG_CX)
+ *
+ * The stack is left holding the handle to a new array with the variable's
+ * value (with no references) or 0 if the variable isn't set.
+ */
+int environment_variable(decoded_instruction_t *code)
+{
+	int i, len, *i_p1, handle;
+	register int address;
+	char *value;
+	char name[MAX_PATH];
+
+	len = m_stack[t--];
+	address = m_stack[t];
+
+	CHECK_MEMORY(address);
+
+	memory_to_string(address, len, name, MAX_PATH);
+
+	m_stack[t] = 0;
+
+	value = getenv(name);
+
+	if (!value)
+	{
+		return 1;
+	}
+
+	len = strlen(value);
+
+	handle = 0;
+	i_p1 = reserve_array(&handle, len);
+
+	if (!i_p1)
+	{
+		INTERPRET_ERROR("Out of memory.\n");
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		i_p1[i] = (unsigned char)value[i];
+	}
+
+	m_memory_handles[handle][ARRAY_LENGTH_OFFSET] = len;
+	m_stack[t] = handle;
+
+	return 1;
+}
+
+/*
+ * Maps a file and returns an array over its contents.
+ * [name handle][name length] (the offset to the name is in REG_CX)
+ *
+ * The file is mapped read only into a view (see memory_view_t) with one
+ * element per byte, so nothing is copied until an element is stored to.
+ * The mapping goes when the last reference to the array does.  Windows
+ * builds read the file into an ordinary array instead.  The stack is
+ * left holding the handle (with no references) or 0 if the file couldn't
+ * be opened or mapped.
+ */
+int file_map(decoded_instruction_t *code)
+{
+	int len, size, *i_p1, handle;
+	register int address;
+	char filename[MAX_PATH];
+#ifdef _WIN32
+	int c;
+	FILE *file;
+#else
+	int fd;
+	struct stat st;
+	unsigned char *bytes;
+	memory_view_t *view_p;
+#endif
+
+	len = m_stack[t--];
+	address = m_stack[t];
+
+	CHECK_MEMORY(address);
+
+	memory_to_string(address, len, filename, MAX_PATH);
+
+	m_stack[t] = 0;
+	handle = 0;
+
+#ifdef _WIN32
+	file = fopen(filename, "rb");
+
+	if (!file)
+	{
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size < 0 || size > MAX_MAPPED_FILE_SIZE)
+	{
+		fclose(file);
+
+		return 1;
+	}
+
+	i_p1 = reserve_array(&handle, size);
+
+	if (!i_p1)
+	{
+		fclose(file);
+
+		INTERPRET_ERROR("Out of memory.\n");
+	}
+
+	for (len = 0; len < size && (c = getc(file)) != EOF; len++)
+	{
+		i_p1[len] = c;
+	}
+
+	fclose(file);
+
+	m_memory_handles[handle][ARRAY_LENGTH_OFFSET] = len;
+#else
+	fd = open(filename, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return 1;
+	}
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size > MAX_MAPPED_FILE_SIZE)
+	{
+		close(fd);
+
+		return 1;
+	}
+
+	size = (int)st.st_size;
+
+	if (size == 0)
+	{
+		close(fd);
+
+		if (!(i_p1 = reserve_array(&handle, 0)))
+		{
+			INTERPRET_ERROR("Out of memory.\n");
+		}
+
+		m_stack[t] = handle;
+
+		return 1;
+	}
+
+	bytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/*
+	 * The mapping stays after the file is closed.
+	 */
+	close(fd);
+
+	if (bytes == MAP_FAILED)
+	{
+		return 1;
+	}
+
+	view_p = (memory_view_t*)malloc(sizeof(memory_view_t));
+
+	if (view_p)
+	{
+		view_p->kind = MEMORY_VIEW_MAPPED;
+		view_p->length = size;
+		view_p->bytes = bytes;
+		view_p->mapped_size = size;
+
+		handle = view_new(view_p);
+	}
+
+	if (!handle)
+	{
+		free(view_p);
+		munmap(bytes, size);
+
+		INTERPRET_ERROR("Out of memory.\n");
+	}
+#endif
+
+	m_stack[t] = handle;
+
+	return 1;
+}
+
+/*
+ * Creates a new (empty) map and pushes its handle.
+ */
+int map_new()
+{
+	int i;
+
+	for (i = 1; i < NUMBER_OF_MAPS; i++)
+	{
+		if (m_maps[i] == 0)
+		{
+			m_maps[i] = hashtable_new(DEFAULT_HASHTABLE_SIZE);
+
+			if (!m_maps[i])
+			{
+				INTERPRET_ERROR("Out of memory.\n");
+			}
+
+			m_stack[++t] = i;
+
+			return 1;
+		}
+	}
+
+	INTERPRET_ERROR("Out of map storage locations.\n");
+}
+
+/*
+ * Frees a map.
+ * [map] (null maps are ignored)
+ */
+int map_free()
+{
+	int map;
+
+	map = m_stack[t--];
+
+	if (map)
+	{
+		CHECK_MAP(map);
+
+		hashtable_delete(m_maps[map]);
+		m_maps[map] = NULL;
+	}
+
+	return 1;
+}
+
+/*
+ * Sets the value of a key (adding the key if it isn't in the map).
+ * [map][key][value]
+ */
+int map_put()
+{
+	int map;
+	variant_t var, key;
+
+	variant_init_i4(&var, m_stack[t--]);
+	variant_init_i4(&key, m_stack[t--]);
+	map = m_stack[t--];
+
+	CHECK_MAP(map);
+
+	if (hashtable_set(m_maps[map], var, key) != std_success)
+	{
+		INTERPRET_ERROR("Out of memory.\n");
+	}
+
+	return 1;
+}
+
+/*
+ * Looks a key up.
+ * [map][key][default]
+ *
+ * The stack is left holding the key's value or the default if the key
+ * isn't in the map.
+ */
+int map_get()
+{
+	int map;
+	variant_t var, key;
+
+	t -= 2;
+	map = m_stack[t];
+
+	CHECK_MAP(map);
+
+	variant_init_i4(&key, m_stack[t + 1]);
+
+	var = hashtable_get(m_maps[map], key);
+
+	m_stack[t] = VAR_EMPTY(var) ? m_stack[t + 2] : (int)var.val.val_i4;
+
+	return 1;
+}
+
+/*
+ * Removes a key.
+ * [map][key]
+ *
+ * The stack is left holding 1 if the key was in the map and 0 if it wasn't.
+ */
+int map_remove()
+{
+	int map;
+	variant_t key;
+
+	variant_init_i4(&key, m_stack[t--]);
+	map = m_stack[t];
+
+	CHECK_MAP(map);
+
+	m_stack[t] = hashtable_remove(m_maps[map], key) ? 1 : 0;
+
+	return 1;
+}
+
+/*
+ * Overwrites the map on top of the stack with its number of keys.
+ */
+int map_count()
+{
+	int map;
+
+	map = m_stack[t];
+
+	CHECK_MAP(map);
+
+	m_stack[t] = (int)m_maps[map]->size;
+
+	return 1;
+}
+
+/*
+ * Returns pointers to the two integers being worked on by inline operators
+ * (++, --, *= etc).
+ */
+int inline_operands(decoded_instruction_t *code, int **i_pp1, int **i_pp2)
+{	
+	register int address;
+
+	*i_pp2 = &m_stack[t];
+
+	address = FRAME(code[p].l) + code[p].a;
+
+	if (m_registers[REG_DX] & REG_MEMORY_FLAG)
+	{
+		CHECK_MEMORY(m_stack[FRAME(code[p].l) + code[p].a]);
+		CHECK_STORE(m_stack[address], m_registers[REG_CX]);
+		
+		*i_pp1 = ((int*)m_memory_handles[m_stack[address]]);
+		*i_pp1 += m_registers[REG_CX];
+	}
+	else
+	{
+		*i_pp1 = &m_stack[address];
+	}
+
+	return 1;
+}
+
+/*
+ * Returns pointers to the two integers being worked on by inline operators
+ * (++, --, *= etc).
+ */
+int inline_indirect_operands(decoded_instruction_t *code, int **i_pp1, int **i_pp2)
+{	
+	register int address;
+
+	*i_pp2 = &m_stack[t];
+
+	address = m_stack[FRAME(code[p].l) + code[p].a];
+
+	if (m_registers[REG_DX] & REG_MEMORY_FLAG)
+	{
+		CHECK_MEMORY(m_stack[address]);
+		CHECK_STORE(m_stack[address], m_registers[REG_CX]);
+
+		*i_pp1 = ((int*)m_memory_handles[m_stack[address]]);
+		*i_pp1 += m_registers[REG_CX];
+	}
+	else
+	{
+		*i_pp1 = &m_stack[address];
+	}
+
+	return 1;
+}
+
+/*
+ * Runs a decoded program once with a fresh stack, heap and set of memory
+ * handles.
+ */
+static int run(decoded_instruction_t *decoded_p, int len)
+{
+	int result;
+
+	result = 0;
+
+	if (!stack_create())
+	{
+		printf("*ERROR* %s", "Out of memory for the stack.\n");
+	}
+	else if (!memory_handles_create() || !heap_create())
+	{
+		printf("*ERROR* %s", "Out of memory for the memory handles.\n");
+	}
+	else
+	{
+		result = real_interpret(decoded_p, len);
+	}
+
+	close_maps();
+	free_memory_handles();
+	memory_handles_delete();
+	heap_delete();
+	stack_delete();
+
+	return result;
+}
+
+int interpret(instruction_t* code, int len)
+{
+	decoded_instruction_t *decoded_p;
+
+	if (code == NULL)
+	{
+		return FALSE;
+	}
+
+	decoded_p = decode(code, len);
+
+	if (decoded_p == NULL)
+	{
+		return FALSE;
+	}
+
+	run(decoded_p, len);
+
+	decoded_delete(decoded_p);
+
+	return TRUE;
+}
+
+/*
+ * Runs a program once per request (see server.h).  The program is only
+ * decoded once.
+ *
+ * @param address	Unix socket to listen on or "-" for stdin.
+ */
+int interpret_server(instruction_t* code, int len, const char *address)
+{
+	decoded_instruction_t *decoded_p;
+
+	if (code == NULL)
+	{
+		return FALSE;
+	}
+
+	decoded_p = decode(code, len);
+
+	if (decoded_p == NULL)
+	{
+		return FALSE;
+	}
+
+	if (!server_open(address))
+	{
+		decoded_delete(decoded_p);
+
+		return FALSE;
+	}
+
+	while (server_begin_request())
+	{
+		run(decoded_p, len);
+
+		/*
+		 * Files the program left open belong to this request.
+		 */
+		close_files();
+
+		fflush(stdout);
+
+		server_end_request();
+	}
+
+	server_close();
+	decoded_delete(decoded_p);
+
+	return TRUE;
+}
+
+/*
+ * Dispatch macros for the execution engine.
+ *
+ * With THREADED_CODE every decoded instruction holds the address of its
+ * handler and each handler jumps straight to the handler of the next
+ * instruction.  Otherwise the handlers are the cases of a switch that
+ * is run in a loop.
+ */
+#ifdef THREADED_CODE
+
+#define OPCODE(x)	L_##x:
+
+#define DISPATCH()	\
+	goto *code[p].handler
+
+#else
+
+#define OPCODE(x)	case IOP_##x:
+
+#define DISPATCH()	\
+	goto dispatch
+
+#endif
+
+/*
+ * Superinstruction handlers for a comparison followed by a conditional
+ * jump (the jump is taken when the comparison is false).
+ */
+#define COMPARE_JUMP(x, cmp)	\
+	OPCODE(x)	\
+		t -= 2;	\
+		if (m_stack[t + 1] cmp m_stack[t + 2])	\
+		{	\
+			p += 2;	\
+		}	\
+		else	\
+		{	\
+			p = code[p + 1].a;	\
+		}	\
+		DISPATCH();
+
+#define LOAD_LOAD_COMPARE_JUMP(x, cmp)	\
+	OPCODE(x)	\
+		if (m_stack[FRAME(code[p].l) + code[p].a] cmp m_stack[FRAME(code[p + 1].l) + code[p + 1].a])	\
+		{	\
+			p += 4;	\
+		}	\
+		else	\
+		{	\
+			p = code[p + 3].a;	\
+		}	\
+		DISPATCH();
+
+void print_stack_line()
+{
+	int j;
+
+	for (j = 1; j <= t; j++)
+	{
+		printf("%d ", m_stack[j]);
+	}
+}
+
+/*
+ * Executes a decoded instruction stream until the program returns
+ * to address 0 or terminates.
+ *
+ * @returns 1 if the program finished, 0 if there was an error or -1
+ *			if the program overflowed the stack.
+ */
+static int execute(decoded_instruction_t *code, int count)
+{
+	float *f_p1, *f_p2;
+	int *i_p1, *i_p2, i, j, len;
+	int temp, address;
+
+#ifdef THREADED_CODE
+
+	static const void *handlers[IOP_COUNT] =
+	{
+		[IOP_UNKNOWN] = &&L_UNKNOWN,
+		[IOP_NOP] = &&L_NOP,
+		[IOP_LIT] = &&L_LIT,
+		[IOP_LOD] = &&L_LOD,
+		[IOP_STO] = &&L_STO,
+		[IOP_CAL] = &&L_CAL,
+		[IOP_TAC] = &&L_TAC,
+		[IOP_INC] = &&L_INC,
+		[IOP_JMP] = &&L_JMP,
+		[IOP_JPC] = &&L_JPC,
+		[IOP_STP] = &&L_STP,
+		[IOP_LID] = &&L_LID,
+		[IOP_LDA] = &&L_LDA,
+		[IOP_SID] = &&L_SID,
+		[IOP_DEC] = &&L_DEC,
+		[IOP_CAI] = &&L_CAI,
+		[IOP_CII] = &&L_CII,
+		[IOP_CAS] = &&L_CAS,
+		[IOP_SLD] = &&L_SLD,
+		[IOP_SWS] = &&L_SWS,
+		[IOP_LIS] = &&L_LIS,
+		[IOP_TRM] = &&L_TRM,
+		[IOP_ISL] = &&L_ISL,
+		[IOP_ISR] = &&L_ISR,
+		[IOP_IAD] = &&L_IAD,
+		[IOP_ISU] = &&L_ISU,
+		[IOP_IMU] = &&L_IMU,
+		[IOP_IDI] = &&L_IDI,
+		[IOP_IXO] = &&L_IXO,
+		[IOP_IOR] = &&L_IOR,
+		[IOP_IAN] = &&L_IAN,
+		[IOP_IZL] = &&L_IZL,
+		[IOP_IZR] = &&L_IZR,
+		[IOP_IIA] = &&L_IIA,
+		[IOP_IIS] = &&L_IIS,
+		[IOP_IIM] = &&L_IIM,
+		[IOP_IID] = &&L_IID,
+		[IOP_IIX] = &&L_IIX,
+		[IOP_IIO] = &&L_IIO,
+		[IOP_IIB] = &&L_IIB,
+		[IOP_SRV] = &&L_SRV,
+		[IOP_LRV] = &&L_LRV,
+		[IOP_ENTER] = &&L_ENTER,
+		[IOP_MAL] = &&L_MAL,
+		[IOP_FRE] = &&L_FRE,
+		[IOP_RAL] = &&L_RAL,
+		[IOP_MSZ] = &&L_MSZ,
+		[IOP_MLS] = &&L_MLS,
+		[IOP_MSS] = &&L_MSS,
+		[IOP_MLO] = &&L_MLO,
+		[IOP_MST] = &&L_MST,
+		[IOP_MLI] = &&L_MLI,
+		[IOP_MSI] = &&L_MSI,
+		[IOP_MCP] = &&L_MCP,
+		[IOP_SLC] = &&L_SLC,
+		[IOP_ARF] = &&L_ARF,
+		[IOP_RLS] = &&L_RLS,
+		[IOP_RLM] = &&L_RLM,
+		[IOP_ACK] = &&L_ACK,
+		[IOP_POP] = &&L_POP,
+		[IOP_PUS] = &&L_PUS,
+		[IOP_MOV] = &&L_MOV,
+		[IOP_RIO] = &&L_RIO,
+		[IOP_PAS] = &&L_PAS,
+		[IOP_SRG] = &&L_SRG,
+		[IOP_TME] = &&L_TME,
+		[IOP_WRT] = &&L_WRT,
+		[IOP_WRF] = &&L_WRF,
+		[IOP_WRB] = &&L_WRB,
+		[IOP_DEB] = &&L_DEB,
+		[IOP_CLK] = &&L_CLK,
+		[IOP_CLI] = &&L_CLI,
+		[IOP_ENV] = &&L_ENV,
+		[IOP_REB] = &&L_REB,
+		[IOP_RCH] = &&L_RCH,
+		[IOP_WRA] = &&L_WRA,
+		[IOP_RDL] = &&L_RDL,
+		[IOP_RDB] = &&L_RDB,
+		[IOP_RDA] = &&L_RDA,
+		[IOP_FOF] = &&L_FOF,
+		[IOP_FCF] = &&L_FCF,
+		[IOP_EOF] = &&L_EOF,
+		[IOP_FMP] = &&L_FMP,
+		[IOP_RET] = &&L_RET,
+		[IOP_NOT_I] = &&L_NOT_I,
+		[IOP_ADD_I] = &&L_ADD_I,
+		[IOP_SUB_I] = &&L_SUB_I,
+		[IOP_MUL_I] = &&L_MUL_I,
+		[IOP_DIV_I] = &&L_DIV_I,
+		[IOP_MOD_I] = &&L_MOD_I,
+		[IOP_ODD_I] = &&L_ODD_I,
+		[IOP_NEG_I] = &&L_NEG_I,
+		[IOP_EQL_I] = &&L_EQL_I,
+		[IOP_NEQ_I] = &&L_NEQ_I,
+		[IOP_LES_I] = &&L_LES_I,
+		[IOP_LEQ_I] = &&L_LEQ_I,
+		[IOP_GRE_I] = &&L_GRE_I,
+		[IOP_GRQ_I] = &&L_GRQ_I,
+		[IOP_SHL_I] = &&L_SHL_I,
+		[IOP_SHR_I] = &&L_SHR_I,
+		[IOP_BOR_I] = &&L_BOR_I,
+		[IOP_AND_I] = &&L_AND_I,
+		[IOP_XOR_I] = &&L_XOR_I,
+		[IOP_ADD_F] = &&L_ADD_F,
+		[IOP_SUB_F] = &&L_SUB_F,
+		[IOP_MUL_F] = &&L_MUL_F,
+		[IOP_DIV_F] = &&L_DIV_F,
+		[IOP_EQL_F] = &&L_EQL_F,
+		[IOP_NEQ_F] = &&L_NEQ_F,
+		[IOP_LES_F] = &&L_LES_F,
+		[IOP_LEQ_F] = &&L_LEQ_F,
+		[IOP_GRE_F] = &&L_GRE_F,
+		[IOP_GRQ_F] = &&L_GRQ_F,
+		[IOP_INT_F] = &&L_INT_F,
+		[IOP_FLO_F] = &&L_FLO_F,
+		[IOP_NEG_F] = &&L_NEG_F,
+		[IOP_LIT_CAL] = &&L_LIT_CAL,
+		[IOP_ENTER_LIS] = &&L_ENTER_LIS,
+		[IOP_LOD_STP] = &&L_LOD_STP,
+		[IOP_SRV_RET] = &&L_SRV_RET,
+		[IOP_LOD_LIT] = &&L_LOD_LIT,
+		[IOP_LIT_ADD] = &&L_LIT_ADD,
+		[IOP_LIT_SUB] = &&L_LIT_SUB,
+		[IOP_LIT_EQL] = &&L_LIT_EQL,
+		[IOP_BOOL] = &&L_BOOL,
+		[IOP_LNOT] = &&L_LNOT,
+		[IOP_LOD_LIT_ADD_STO] = &&L_LOD_LIT_ADD_STO,
+		[IOP_EQL_JPC] = &&L_EQL_JPC,
+		[IOP_NEQ_JPC] = &&L_NEQ_JPC,
+		[IOP_LES_JPC] = &&L_LES_JPC,
+		[IOP_LEQ_JPC] = &&L_LEQ_JPC,
+		[IOP_GRE_JPC] = &&L_GRE_JPC,
+		[IOP_GRQ_JPC] = &&L_GRQ_JPC,
+		[IOP_LOD_LOD_EQL_JPC] = &&L_LOD_LOD_EQL_JPC,
+		[IOP_LOD_LOD_NEQ_JPC] = &&L_LOD_LOD_NEQ_JPC,
+		[IOP_LOD_LOD_LES_JPC] = &&L_LOD_LOD_LES_JPC,
+		[IOP_LOD_LOD_LEQ_JPC] = &&L_LOD_LOD_LEQ_JPC,
+		[IOP_LOD_LOD_GRE_JPC] = &&L_LOD_LOD_GRE_JPC,
+		[IOP_LOD_LOD_GRQ_JPC] = &&L_LOD_LOD_GRQ_JPC,
+		[IOP_LOD_LIT_EQL] = &&L_LOD_LIT_EQL,
+		[IOP_INC_U] = &&L_INC_U,
+		[IOP_CAL_U] = &&L_CAL_U,
+		[IOP_LIT_CAL_U] = &&L_LIT_CAL_U,
+		[IOP_MLO_U] = &&L_MLO_U,
+		[IOP_MST_U] = &&L_MST_U,
+		[IOP_HNW] = &&L_HNW,
+		[IOP_HFR] = &&L_HFR,
+		[IOP_HPT] = &&L_HPT,
+		[IOP_HGT] = &&L_HGT,
+		[IOP_HRM] = &&L_HRM,
+		[IOP_HCT] = &&L_HCT,
+	};
+
+	/*
+	 * Thread the instruction stream (including the terminating entry
+	 * added by the decoder).  When tracing or profiling every instruction
+	 * goes through the monitor handler first.
+	 */
+	for (i = 0; i <= count; i++)
+	{
+		code[i].handler = (m_options.trace_stack || m_options.profile_opcodes) ? &&monitor : handlers[code[i].op];
+	}
+
+	/*
+	 * Returning to address 0 ends the program.
+	 */
+	code[0].handler = &&halt;
+
+	if (m_options.profile_opcodes)
+	{
+		profile_record(p, code[p].op);
+	}
+
+	goto *handlers[code[0].op];
+
+monitor:
+
+	if (m_options.trace_stack)
+	{
+		print_stack_line();
+		printf("\n");
+	}
+
+	if (m_options.profile_opcodes)
+	{
+		profile_record(p, code[p].op);
+	}
+
+	goto *handlers[code[p].op];
+
+#else
+
+	if (m_options.profile_opcodes)
+	{
+		profile_record(p, code[p].op);
+	}
+
+	for (;;)
+	{
+		switch (code[p].op)
+		{
+#endif
+		OPCODE(NOP)
+			
+			p++;
+
+			DISPATCH();
+
+		OPCODE(TRM)
+
+			return 0;
+
+		OPCODE(SWS)
+			
+			/*
+			 * Swaps the top two elements on the stack around.
+			 */
+
+			temp = m_stack[t];
+			m_stack[t] = m_stack[t - 1];
+			m_stack[t - 1] = temp;
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(PAS)
+		
+			/*
+			 * Pass stack into a working register (like pop but doesn't pop).
+			 */
+
+			if (code[p].a != 0)
+			{
+				m_registers[code[p].a] = m_stack[t];
+			}
+
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(POP)
+		
+			/*
+			 * Pop onto a working register.
+			 */
+			
+			if (code[p].a == 0)
+			{
+				t--;
+			}
+			else
+			{
+				m_registers[code[p].a] = m_stack[t--];
+			}
+
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(MOV)
+			
+			/*
+			 * Move data from one register to another.
+			 */
+
+			m_registers[code[p].a] = m_registers[code[p].l];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(RIO)
+			
+			/*
+			 * Does a bit-wise OR on a register.
+			 */
+
+			m_registers[code[p].l] |= code[p].a;
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(SRG)
+
+			/*
+			 * Statically set a register.
+			 */
+
+			if (code[p].l != 0)
+			{
+				m_registers[code[p].l] = code[p].a;
+			}
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(PUS)
+
+			/*
+			 * Push off a working register.
+			 */
+			
+			if (code[p].a == 0)
+			{
+				t++;
+			}
+			else
+			{
+				m_stack[++t] = m_registers[code[p].a];
+			}
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(SLD)
+			
+			/*
+			 * Loads up a value from somewhere in the stack.
+			 * The offset is given by code[p].a
+			 */
+
+			m_stack[t + 1] = m_stack[t - code[p].a];
+
+			t++;
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(LIT)
+
+			/*
+			 * Load a literal number.
+			 */
+
+			m_stack[++t] = code[p].a;
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(LIS)
+			
+			/*
+			 * Loads up 'l' number of 'a' integers.
+			 */
+
+			m_temp = t;
+
+			while (t < m_temp + code[p].l)
+			{
+				t++;
+				m_stack[t] = code[p].a;
+			}				
+			
+			p++;
+
+			DISPATCH();
+
+		OPCODE(SRV)
+			
+			/*
+			 * Set the return value.
+			 */
+			
+			m_stack[b - code[p].a] = m_stack[t];
+			
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(LRV)
+			
+			/*
+			 * Load the return value.
+			 */
+			
+			t++;
+			m_stack[t] = m_stack[b - code[p].l];
+			p++;
+
+			DISPATCH();
+
+		OPCODE(RET)
+			
+			/*
+			 * End of program block.
+			 */
+				
+			t = b - 1; /* stack pointer */
+
+			b = m_stack[t + 2]; /* dynamic link */
+			p = m_stack[t + 3]; /* return address */				
+
+			DISPLAY_RETURN();
+
+			DISPATCH();
+
+		OPCODE(NOT_I)
+
+			/*
+			 * Bitwise NOT and pop.
+			 */
+			
+			m_stack[t] = ~m_stack[t];
+			p++;
+
+			DISPATCH();
+
+		OPCODE(ADD_I)
+
+			/*
+			 * Add and pop.
+			 */
+			
+			t--;
+
+			m_stack[t] = m_stack[t] + m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(SUB_I)
+			
+			/*
+			 * Subtract and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] - m_stack[t + 1];
+
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(MUL_I)
+			
+			/*
+			 * Multiply and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] * m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(DIV_I)
+			
+			/*
+			 * Divide and pop.
+			 */
+
+			t--;
+
+			if (m_stack[t + 1] == 0)
+			{
+				INTERPRET_ERROR("Divide by zero error.\n");
+			}
+
+			m_stack[t] = m_stack[t] / m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(ODD_I)
+			
+			/*
+			 * Odd.
+			 */
+			
+			m_stack[t] = (m_stack[t] & 1);
+			
+			p++;
+
+			DISPATCH();
+
+		OPCODE(EQL_I)
+			
+			/*
+			 * Equals and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] == m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(NEQ_I)
+			
+			/*
+			 * Not equls and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] != m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(LES_I)
+
+			/*
+			 * Less than and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] < m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(LEQ_I)
+			
+			/*
+			 * Less than and equal to and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] <= m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(GRE_I)
+
+			/*
+			 * Greater than and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] > m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(GRQ_I)
+			
+			/*
+			 * Greater than and equal to and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = (m_stack[t] >= m_stack[t + 1]);
+			
+			p++;
+			
+			DISPATCH();
+			
+		OPCODE(SHL_I)
+
+			/*
+			 * Shift left and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] << m_stack[t + 1];
+			
+			p++;				
+			
+			DISPATCH();
+
+		OPCODE(SHR_I)
+			
+			/*
+			 * Shift right and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] >> m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(BOR_I)
+			
+			/*
+			 * Bitwise OR and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] | m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(AND_I)
+
+			/*
+			 * Bitwise AND and pop.
+			 */
+
+			t--;
+
+			m_stack[t] = m_stack[t] & m_stack[t + 1];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(XOR_I)
+			
+			t--;
+
+			m_stack[t] = m_stack[t] ^ m_stack[t + 1];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(MOD_I)
+			
+			/*
+			 * Integer MOD and pop.
+			 */
+
+			t--;
+			
+			m_stack[t] = m_stack[t] % m_stack[t + 1];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(NEG_I)
+
+			/*
+			 * Integer negative.
+			 */
+
+			m_stack[t] = -m_stack[t];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(LOD)
+
+			/*
+			 * Loads some stack or heap memory onto the stack.
+			 */
+			
+			t++;
+			
+			/*
+			 * If the REG_DX register is flagged.
+			 */
+
+			m_stack[t] = m_stack[FRAME(code[p].l) + code[p].a];
+			
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(STO)
+
+			/*
+			 * Store the stack onto some stack or heap memory.
+			 */
+
+			/*
+			 * If the REG_DX register is flagged.
+			 */
+
+			m_stack[FRAME(code[p].l) + code[p].a] = m_stack[t];
+			
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(LID)
+			
+			/*
+			 * Load indirectly.
+			 */
+			
+			t++;
+
+			m_stack[t] = m_stack[m_stack[FRAME(code[p].l) + code[p].a]];
+			
+			p++;
+
+			DISPATCH();
+
+		
+		OPCODE(SID)
+
+			/*
+			 * Store indirectly.
+			 */
+
+			m_stack[m_stack[FRAME(code[p].l) + code[p].a]] = m_stack[t];
+
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(TAC)
+
+			/*
+			 * Tail call.
+			 */						
+			
+			j = t;
+			
+			t = b - 1;
+			
+			/* Static link stays the same */
+			/* Dynamic link stays the same */
+			/* Return address stays the same */
+			
+			b = t + 1; 
+
+			memcpy(&m_stack[t + 4], &m_stack[j + 4], param_count * sizeof(int));
+
+			p = code[p].a;
+
+			param_count = 0;
+			
+			DISPATCH();
+
+		OPCODE(CAL)
+			
+			/*
+			 * Call directly.
+			 */
+
+			/*
+			 * Work out static link.
+			 */
+			address = FRAME(code[p].l);
+			
+			if (address == 0)
+			{
+				INTERPRET_ERROR("Null function pointer exception.\n");
+			}
+			else
+			{
+				m_stack[t + 1] = address; /* static link */
+				m_stack[t + 2] = b; /* dynamic link */
+				m_stack[t + 3] = p + 1; /* return address */
+
+				b = t + 1; /* base address for this data segment */
+
+				DISPLAY_CALL(code[p].l);
+
+				p = code[p].a;
+			}
+			
+			param_count = 0;
+
+			DISPATCH();
+
+		OPCODE(CAL_U)
+
+			/*
+			 * CAL in a verified program.  The target is a function's
+			 * entry and the static link comes from the display (which
+			 * only holds frame bases) so it can't be null.
+			 */
+
+			m_stack[t + 1] = FRAME(code[p].l);
+			m_stack[t + 2] = b;
+			m_stack[t + 3] = p + 1;
+
+			b = t + 1;
+
+			DISPLAY_CALL(code[p].l);
+
+			p = code[p].a;
+
+			param_count = 0;
+
+			DISPATCH();
+
+		OPCODE(INC)
+			
+			/*
+			 * Increments the m_stack.
+			 */
+			
+			t += code[p].a;
+
+			if (t + EXPRESSION_STACK_RESERVE >= m_stack_size && !grow_stack(t + EXPRESSION_STACK_RESERVE))
+			{
+				goto stack_overflow;
+			}
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(INC_U)
+
+			/*
+			 * INC in a verified program (the function's entry reserved
+			 * enough stack).
+			 */
+
+			t += code[p].a;
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(ENTER)
+
+			/*
+			 * Function entry.  Increments the m_stack and makes sure there's
+			 * room for the whole frame (code[p].l entries from b).  This is
+			 * the only place the stack can overflow.
+			 */
+
+			t += code[p].a;
+
+			if (b + code[p].l >= m_stack_size && !grow_stack(b + code[p].l))
+			{
+				goto stack_overflow;
+			}
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(DEC)
+			
+			/*				 
+			 * Decrements (pops) the m_stack.
+			 */
+
+			t -= code[p].a;
+			p++;
+
+			DISPATCH();
+
+		OPCODE(JMP)
+
+			/*
+			 * Jump.
+			 */
+
+			p = code[p].a;
+			
+			DISPATCH();
+
+		OPCODE(JPC)
+			
+			/*
+			 * Conditional jump.
+			 */
+
+			if (m_stack[t] == 0)
+			{
+				p = code[p].a;
+			}
+			else
+			{
+				p++;
+			}
+
+			t--;
+			
+			DISPATCH();
+
+		OPCODE(STP)
+
+			/*
+			 * Store parameter.
+			 */
+
+			param_count++;
+
+			m_stack[t + code[p].a] = m_stack[t];
+
+			t--;
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(LDA)
+			
+			/*
+			 * Load address.
+			 */
+
+			t++;
+			m_stack[t] = FRAME(code[p].l) + code[p].a;
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(CAI)
+
+			param_count = 0;
+
+			/*
+			 * Call indirectly.
+			 */
+			
+			address = FRAME(code[p].l);
+
+			if (m_stack[address + code[p].a] == 0)
+			{
+				INTERPRET_ERROR("Null function pointer exception.\n");
+			}
+			else
+			{
+				m_stack[t + 1] = FRAME(code[p].l);
+				m_stack[t + 2] = b;
+				m_stack[t + 3] = p + 1;
+
+				b = t + 1;
+
+				DISPLAY_CALL(code[p].l);
+
+				p = m_stack[address + code[p].a];
+			}
+
+			DISPATCH();
+
+		OPCODE(MLO)
+
+			t++;
+
+			address = m_stack[FRAME(code[p].l) + code[p].a];
+
+			CHECK_MEMORY(address);
+
+			m_stack[t] = MEMORY_LOAD(address, m_registers[REG_CX]);
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(MLO_U)
+
+			/*
+			 * MLO after an ACK checked the handle (verified programs).
+			 */
+
+			t++;
+
+			address = m_stack[FRAME(code[p].l) + code[p].a];
+
+			CHECK_NULL_MEMORY(address);
+
+			m_stack[t] = MEMORY_LOAD(address, m_registers[REG_CX]);
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(MLI)
+
+			t++;
+
+			address = m_stack[m_stack[FRAME(code[p].l) + code[p].a]];
+
+			CHECK_MEMORY(address);
+
+			m_stack[t] = MEMORY_LOAD(address, m_registers[REG_CX]);
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(MST)
+
+			address = FRAME(code[p].l) + code[p].a;
+
+			CHECK_MEMORY(m_stack[FRAME(code[p].l) + code[p].a]);
+			CHECK_STORE(m_stack[address], m_registers[REG_CX]);
+
+			i_p1 = (int*)m_memory_handles[m_stack[address]];
+
+			i_p1 += m_registers[REG_CX];
+
+			*i_p1 = m_stack[t--];
+
+			p++;
+			
+			DISPATCH();
+
+		OPCODE(MST_U)
+
+			/*
+			 * MST after an ACK checked the handle (verified programs).
+			 */
+
+			address = m_stack[FRAME(code[p].l) + code[p].a];
+
+			CHECK_NULL_MEMORY(address);
+			CHECK_STORE(address, m_registers[REG_CX]);
+
+			((int*)m_memory_handles[address])[m_registers[REG_CX]] = m_stack[t--];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(MSI)
+
+			address = m_stack[FRAME(code[p].l) + code[p].a];
+
+			CHECK_MEMORY(m_stack[FRAME(code[p].l) + code[p].a]);
+			CHECK_STORE(m_stack[address], m_registers[REG_CX]);
+
+			i_p1 = (int*)m_memory_handles[m_stack[address]];
+
+			i_p1 += m_registers[REG_CX];
+
+			*i_p1 = m_stack[t--];
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(CAS)
+
+			param_count = 0;
+
+			temp = m_stack[t];
+
+			t--;
+
+			if (temp == 0)
+			{
+				INTERPRET_ERROR("Null function pointer exception.\n");
+			}
+			else
+			{
+				m_stack[t + 1] = FRAME(code[p].l);
+				m_stack[t + 2] = b;
+				m_stack[t + 3] = p + 1;
+
+				b = t + 1;
+
+				DISPLAY_CALL(code[p].l);
+
+				p = temp;
+			}
+
+			DISPATCH();
+
+		OPCODE(CII)
+
+			param_count = 0;
+
+			/*
+			 * Call two level indirectly.
+			 */
+			
+			address = FRAME(code[p].l);
+			
+			if (m_stack[m_stack[address + code[p].a]] == 0)
+			{
+				INTERPRET_ERROR("Null function pointer exception.\n");
+			}
+			else
+			{
+				m_stack[t + 1] = address;
+				m_stack[t + 2] = b;
+				m_stack[t + 3] = p + 1;
+
+				b = t + 1;
+
+				DISPLAY_CALL(code[p].l);
+
+				p = m_stack[m_stack[address + code[p].a]];
+			}
+
+			DISPATCH();
+
+		
+		OPCODE(IAD)
+
+			/*
+			 * Inline adding.
+			 */
+			
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			/*
+			 * If the REG_DX register is flagged then this is a floating operation.
+			 */
+
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 += *(float*)i_p2;
+			}
+			else
+			{				
+				*i_p1 += *i_p2;
+			}
+
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(ISU)
+
+			/*
+			 * Inline substracting.
+			 */
+			
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			/*
+			 * If the REG_DX register is flagged then this is a floating operation.
+			 */			
+
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 -= *(float*)i_p2;
+			}
+			else
+			{
+				*i_p1 -= *i_p2;
+			}
+
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(ISL)
+
+			/*
+			 * Inline shift left.
+			 */
+
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			*i_p1 <<= *i_p2;
+
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(ISR)
+
+			/*
+			 * Inline shift right.
+			 */
+
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			*i_p1 >>= *i_p2;
+
+			p++;
+			t--;
+
+			DISPATCH();
+
+		OPCODE(IZL)
+
+			/*
+			 * Inline indirect shift right.
+			 */
+
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			*i_p1 >>= *i_p2;
 
-		case OC_LRV:
-			
-			/*
-			 * Load the return value.
-			 */
-			
-			t++;
-			m_stack[t] = m_stack[b - code[p].l];
 			p++;
+			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_OPR:
+		OPCODE(IZR)
 
-			switch (code[p].a)
-			{
-				
-			case 0:
-				
-				/*
-				 * End of program block.
-				 */
-					
-				t = b - 1; /* stack pointer */
+			/*
+			 * Inline indirect shift left.
+			 */
 
-				b = m_stack[t + 2]; /* dynamic link */
-				p = m_stack[t + 3]; /* return address */				
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				break;						
+			*i_p1 <<= *i_p2;
 
-			case OPR_NOT:
+			p++;
+			t--;
 
-				/*
-				 * Bitwise NOT and pop.
-				 */
-				
-				m_stack[t] = ~m_stack[t];
-				p++;
+			DISPATCH();
+		
+		OPCODE(IXO)
 
-				break;
+			/*
+			 * Inline XOR.
+			 */
+			
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-			case OPR_ADD:
+			/*
+			 * If the REG_DX register is flagged then this is a floating operation.
+			 */			
 
-				/*
-				 * Add and pop.
-				 */
-				
-				t--;
+			*i_p1 ^= *i_p2;
+			
+			p++;
+			t--;
 
-				m_stack[t] = m_stack[t] + m_stack[t + 1];
-				
-				p++;
-				
-				break;
+			DISPATCH();
 
-			case OPR_SUB:
-				
-				/*
-				 * Subtract and pop.
-				 */
+		OPCODE(IOR)
 
-				t--;
-				
-				m_stack[t] = m_stack[t] - m_stack[t + 1];
+			/*
+			 * Inline OR.
+			 */
+			
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				p++;
-				
-				break;
+			/*
+			 * If the REG_DX register is flagged then this is a floating operation.
+			 */			
 
-			case OPR_MUL:
-				
-				/*
-				 * Multiply and pop.
-				 */
+			*i_p1 |= *i_p2;
+			
+			p++;
+			t--;
 
- 				t--;
-				
-				m_stack[t] = m_stack[t] * m_stack[t + 1];
-				
-				p++;
-				
-				break;
+			DISPATCH();
 
-			case OPR_DIV:
-				
-				/*
-				 * Divide and pop.
-				 */
+		OPCODE(IAN)
 
-				t--;
+			/*	
+			 * Inline AND.
+			 */
+			
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				if (m_stack[t + 1] == 0)
-				{
-					INTERPRET_ERROR("Divide by zero error.\n");
-				}
+			/*
+			 * If the REG_DX register is flagged then this is a floating operation.
+			 */			
 
-				m_stack[t] = m_stack[t] / m_stack[t + 1];
-				
-				p++;
-				
-				break;
+			*i_p1 &= *i_p2;
+			
+			p++;
+			t--;
 
-			case OPR_ODD:
-				
-				/*
-				 * Odd.
-				 */
-				
-				m_stack[t] = (m_stack[t] & 1);
-				
-				p++;
+			DISPATCH();
 
-				break; 
+		OPCODE(IIX)
 
-			case OPR_EQL:
-				
-				/*
-				 * Equals and pop.
-				 */
+			/*
+			 * Inline indirect XOR.
+			 */
+			
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] == m_stack[t + 1]);
-				
-				p++;
-				
-				break;
+			*i_p1 ^= *i_p2;
+							
+			p++;
+			t--;
 
-			case OPR_NEQ:
-				
-				/*
-				 * Not equls and pop.
-				 */
+			DISPATCH();
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] != m_stack[t + 1]);
-				
-				p++;
-				
-				break;
+		OPCODE(IIO)
 
-			case OPR_LES:
+			/*
+			 * Inline indirect OR.
+			 */
+			
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				/*
-				 * Less than and pop.
-				 */
+			*i_p1 |= *i_p2;
+			
+			p++;
+			t--;
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] < m_stack[t + 1]);
-				
-				p++;
-				
-				break;
+			DISPATCH();
 
-			case OPR_LEQ:
-				
-				/*
-				 * Less than and equal to and pop.
-				 */
+		OPCODE(IIB)
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] <= m_stack[t + 1]);
-				
-				p++;
-				
-				break;
+			/*	
+			 * Inline indirect and.
+			 */
+			
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-			case OPR_GRE:
+			*i_p1 &= *i_p2;
+			
+			p++;
+			t--;
 
-				/*
-				 * Greater than and pop.
-				 */
+			DISPATCH();
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] > m_stack[t + 1]);
-				
-				p++;
-				
-				break;
+		OPCODE(IMU)
 
-			case OPR_GRQ:
-				
-				/*
-				 * Greater than and equal to and pop.
-				 */
+			/*
+			 * Inline multiplying.
+			 */
 
-				t--;
-				
-				m_stack[t] = (m_stack[t] >= m_stack[t + 1]);
-				
-				p++;
-				
-				break;
-				
-			case OPR_SHL:
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				/*
-				 * Shift left and pop.
-				 */
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 *= *(float*)i_p2;
+			}
+			else
+			{				
+				*i_p1 *= *i_p2;
+			}
 
-				t--;
-				
-				m_stack[t] = m_stack[t] << m_stack[t + 1];
-				
-				p++;				
-				
-				break;
+			p++;
+			t--;
 
-			case OPR_SHR:
-				
-				/*
-				 * Shift right and pop.
-				 */
+			DISPATCH();
 
-				t--;
-				
-				m_stack[t] = m_stack[t] >> m_stack[t + 1];
-				
-				p++;
-				
-				break;
+		OPCODE(IDI)
 
-			case OPR_BOR:
-				
-				/*
-				 * Bitwise OR and pop.
-				 */
+			/*
+			 * Inline dividing.
+			 */
 
-				t--;
-				
-				m_stack[t] = m_stack[t] | m_stack[t + 1];
-				
-				p++;
-				
-				break;
+			if (!inline_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-			case OPR_AND:
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				if (*(float*)i_p2 == 0)
+				{
+					INTERPRET_ERROR("Floating point divide by zero error.\n");
+				}
 
-				/*
-				 * Bitwise AND and pop.
-				 */
+				*(float*)i_p1 /= *(float*)i_p2;
+			}
+			else
+			{				
+				if (*i_p2 == 0)
+				{
+					INTERPRET_ERROR("Divide by zero error.\n");
+				}
 
-				t--;
+				*i_p1 /= *i_p2;
+			}
 
-				m_stack[t] = m_stack[t] & m_stack[t + 1];
+			p++;
+			t--;
 
-				p++;
+			DISPATCH();
 
-				break;
+		OPCODE(IIA)
 
-			case OPR_XOR:
-				
-				t--;
+			/*
+			 * Inline indirect adding.
+			 */
 
-				m_stack[t] = m_stack[t] ^ m_stack[t + 1];
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				p++;
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 += *(float*)i_p2;
+			}
+			else
+			{				
+				*i_p1 += *i_p2;
+			}
 
-				break;
+			p++;
+			t--;
 
-			case OPR_MOD:
-				
-				/*
-				 * Integer MOD and pop.
-				 */
+			DISPATCH();
 
-				t--;
-				
-				m_stack[t] = m_stack[t] % m_stack[t + 1];
-				
-				p++;
-				
-				break;
+		OPCODE(IIS)
 
-			case OPR_NEG:
+			/*
+			 * Inline indirect substracting.
+			 */
 
-				/*
-				 * Integer negative.
-				 */
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
 
-				m_stack[t] = -m_stack[t];
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 -= *(float*)i_p2;
+			}
+			else
+			{				
+				*i_p1 -= *i_p2;
+			}
 
-				p++;
+			p++;
+			t--;
 
-				break;
-			}
-	
-			break;
+			DISPATCH();
 
-		case OC_LOD:
+		OPCODE(IIM)
 
 			/*
-			 * Loads some stack or heap memory onto the stack.
-			 */
-			
-			t++;
-			
-			/*
-			 * If the REG_DX register is flagged.
+			 * Inline indirect multiplying.
 			 */
 
-			m_stack[t] = m_stack[base(code[p].l, b) + code[p].a];
-			
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				*(float*)i_p1 *= *(float*)i_p2;
+			}
+			else
+			{				
+				*i_p1 *= *i_p2;
+			}
+
 			p++;
-			
-			break;
+			t--;
 
-		case OC_STO:
+			DISPATCH();
 
-			/*
-			 * Store the stack onto some stack or heap memory.
-			 */
+		OPCODE(IID)
 
 			/*
-			 * If the REG_DX register is flagged.
+			 * Inline indirect dividing.
 			 */
 
-			m_stack[base(code[p]. l, b) + code[p].a] = m_stack[t];
-			
+			if (!inline_indirect_operands(code, &i_p1, & i_p2))
+			{
+				return 0;
+			}
+
+			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			{
+				if (*(float*)i_p2 == 0)
+				{
+					INTERPRET_ERROR("Floating point divide by zero error.\n");
+				}
+
+				*(float*)i_p1 /= *(float*)i_p2;
+			}
+			else
+			{
+				if (*i_p2 == 0)
+				{
+					INTERPRET_ERROR("Divide by zero error.\n");
+				}
+
+				*i_p1 /= *i_p2;
+			}
+
 			p++;
 			t--;
 
-			break;
+			DISPATCH();
+
+		OPCODE(WRB)
 
-		case OC_LID:
-			
 			/*
-			 * Load indirectly.
+			 * Write out a byte.
 			 */
-			
-			t++;
 
-			m_stack[t] = m_stack[m_stack[base(code[p].l, b) + code[p].a]];
+			if (m_stack[t - 1] == 0)
+			{					
+				putc(m_stack[t] & 0xff, stdout);
+			}
+			else
+			{
+				putc(m_stack[t], m_files[m_stack[t - 1]]);				
+			}
 			
+			t -= 2;
 			p++;
 
-			break;
-
+			DISPATCH();
 		
-		case OC_SID:
+		OPCODE(REB)
 
-			/*
-			 * Store indirectly.
-			 */
+			if (m_stack[t] == 0)
+			{
+				m_stack[t] = GETCH;
+			}
+			else
+			{				
+				m_stack[t] = STREAM_GETC(m_files[m_stack[t]]);
+			}
+
+			p++;
+
+			DISPATCH();
 
-			m_stack[m_stack[base(code[p].l, b) + code[p].a]] = m_stack[t];
+		OPCODE(RCH)
+			
+			if (m_stack[t] == 0)
+			{
+				m_stack[t] = getchar();
+			}
+			else
+			{
+				m_stack[t] = STREAM_GETC(m_files[m_stack[t]]);				
+			}
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_TAC:
+		OPCODE(MAL)
 
-			/*
-			 * Tail call.
-			 */						
-			
-			j = t;
-			
-			t = b - 1;
-			
-			/* Static link stays the same */
-			/* Dynamic link stays the same */
-			/* Return address stays the same */
-			
-			b = t + 1; 
+			m_size = (m_stack[t] + 1) * sizeof(int);
 
-			memcpy(&m_stack[t + 4], &m_stack[j + 4], param_count * sizeof(int));
+			i_p1 = heap_alloc(m_size);
 
-			p = code[p].a;
+			if (!i_p1)
+			{
+				INTERPRET_ERROR("Out of memory.\n");
+			}
 
-			param_count = 0;
+			*i_p1 = m_stack[t];
+
+			temp = find_free_memory_handle();
+
+			if (!temp)
+			{
+				heap_free(i_p1, m_size);
+
+				return 0;
+			}
+
+			m_memory_handles[temp] = (i_p1 + 1);
 			
-			break;
+			m_stack[t] = temp;
 
-		case OC_CAL:
+			ASSERT(0, "\t*ASSERT* Allocating memory handle (%x)\n", temp);
 			
-			/*
-			 * Call directly.
-			 */
+			p++;
+
+			DISPATCH();
+
+		OPCODE(RAL)
+						
+			address = m_stack[t - 1];
+
+			CHECK_MEMORY(address);
+
+			ASSERT1(0, "\t*ASSERT* Reallocating memory handle (%x) to %d integers\n", address, m_stack[t]);
 
 			/*
-			 * Work out static link.
+			 * Shrinking would take elements from under the handle's slices.
 			 */
-			address = base(code[p].l, b);
-			
-			if (address == 0)
+			if (m_memory_slices[address] && m_stack[t] < MEMORY_SIZE(address)
+				&& !view_detach_slices(address))
 			{
-				INTERPRET_ERROR("Null function pointer exception.\n");
+				INTERPRET_ERROR("Out of memory.\n");
 			}
-			else
+
+			if (m_memory_views[address] && m_stack[t] <= MEMORY_SIZE(address))
 			{
-				m_stack[t + 1] = address; /* static link */
-				m_stack[t + 2] = b; /* dynamic link */
-				m_stack[t + 3] = p + 1; /* return address */
+				/*
+				 * Shrinking a view just drops elements from its end.
+				 */
+				m_memory_views[address]->length = MAX(m_stack[t] - ARRAY_HEADER_SIZE, 0);
+			}
+			else if ((m_memory_views[address] && !view_detach(address))
+				|| !resize_memory_handle(address, m_stack[t]))
+			{
+				INTERPRET_ERROR("Out of memory.\n");
+			}
 
-				b = t + 1; /* base address for this data segment */
+			t -= 2;
+			p++;
 
-				p = code[p].a;
-			}
-			
-			param_count = 0;
+			DISPATCH();
 
-			break;
+		OPCODE(FRE)
 
-		case OC_INC:
-			
 			/*
-			 * Increments the m_stack.
+			 * Frees some memory off the heap (takes a handle to the memory).
 			 */
+
+			address = m_stack[t];
+
+			CHECK_MEMORY(address);
+
+			ASSERT(0, "\t*ASSERT* Freeing memory handle (%x)\n", address);
 			
-			t += code[p].a;
+			FREE_MEMORY_HANDLE(address);
+						
 			p++;
 
-			break;
+			DISPATCH();
 
-		case OC_DEC:
-			
-			/*				 
-			 * Decrements (pops) the m_stack.
-			 */
+		OPCODE(MSZ)
+			
+			address = m_stack[t];
 
-			t -= code[p].a;
-			p++;
+			CHECK_MEMORY(address);
 
-			break;			
+			m_stack[t] = MEMORY_SIZE(address);
 
-		case OC_JMP:
+			p++;
 
+			DISPATCH();
+			
+		OPCODE(MLS)
+			
 			/*
-			 * Jump.
+			 * Loads some memory onto the stack, the handle is given
+			 * by the stack.
 			 */
-
-			p = code[p].a;
 			
-			break;
-
-		case OC_JPC:
+			t++;
 			
 			/*
-			 * Conditional jump.
+			 * If the REG_DX register is flagged.
 			 */
 
-			if (m_stack[t] == 0)
-			{
-				p = code[p].a;
-			}
-			else
-			{
-				p++;
-			}
+			temp = m_stack[t - 1 - code[p].a];
+	
+			/*
+			 * Then this is a memory operation, the REG_CX register
+			 * holds the offset.  The address and level provided is
+			 * for the handle to the memory.
+			 */					
 
-			t--;
+			CHECK_MEMORY(temp);
+
+			m_stack[t] = MEMORY_LOAD(temp, m_registers[REG_CX]);
+						
+			p++;
 			
-			break;
+			DISPATCH();
+				
+		OPCODE(MSS)
 
-		case OC_STP:
+			/*
+			 * Store the stack onto some heap memory.
+			 */
 
 			/*
-			 * Store parameter.
+			 * If the REG_DX register is flagged.
 			 */
 
-			param_count++;
+			CHECK_MEMORY(m_stack[t - code[p].a]);
+			CHECK_STORE(m_stack[t - code[p].a], m_registers[REG_CX]);
 
-			m_stack[t + code[p].a] = m_stack[t];
+			i_p1 = (int*)m_memory_handles[m_stack[t - code[p].a]];
 
-			t--;
-			p++;
-			
-			break;
+			i_p1 += m_registers[REG_CX];
 
-		case OC_LDA:
-			
-			/*
-			 * Load address.
-			 */
+			*i_p1 = m_stack[t];
 
-			t++;
-			m_stack[t] = base(code[p].l, b) + code[p].a;
 			p++;
-			
-			break;
+			t--;
 
-		case OC_CAI:
+			DISPATCH();
 
-			param_count = 0;
+		OPCODE(MCP)
 
 			/*
-			 * Call indirectly.
+			 * Copy some memory garunteeing overlapped copies.
+			 * [dest][dest offset][src][src offset][size]
 			 */
-			
-			address = base(code[p].l, b);
 
-			if (m_stack[address + code[p].a] == 0)
+			CHECK_MEMORY(m_stack[t - 4]);
+			CHECK_MEMORY(m_stack[t - 2]);
+			CHECK_STORE(m_stack[t - 4], m_stack[t - 3] + m_stack[t] - 1);
+
+			i_p1 = (int*)m_memory_handles[m_stack[t - 4]] + m_stack[t - 3];
+
+			if (m_memory_views[m_stack[t - 2]])
 			{
-				INTERPRET_ERROR("Null function pointer exception.\n");
+				for (i = 0; i < m_stack[t]; i++)
+				{
+					i_p1[i] = view_load(m_stack[t - 2], m_stack[t - 1] + i);
+				}
 			}
 			else
 			{
-				m_stack[t + 1] = base(code[p].l, b);
-				m_stack[t + 2] = b;
-				m_stack[t + 3] = p + 1;
+				i_p2 = (int*)m_memory_handles[m_stack[t - 2]] + m_stack[t - 1];
 
-				p = m_stack[address + code[p].a];;
-				
-				b = t + 1;
+				if (m_stack[t - 4] == m_stack[t - 2])
+				{
+					memmove(i_p1, i_p2, m_stack[t] * sizeof(int));
+				}
+				else
+				{
+					memcpy(i_p1, i_p2, m_stack[t] * sizeof(int));
+				}
 			}
 
-			break;		
-
-		case OC_MLO:
-
-			t++;
-
-			address = m_stack[base(code[p]. l, b) + code[p].a];
+			t -= 5;
+			p++;
 
-			CHECK_MEMORY(address);
+			DISPATCH();
 
-			i_p1 = (int*)m_memory_handles[address];
+		OPCODE(SLC)
 
-			i_p1 += m_registers[REG_CX];
-			
-			m_stack[t] = *i_p1;
+			if (!memory_slice())
+			{
+				return 0;
+			}
 
 			p++;
 
-			break;
+			DISPATCH();
 
-		case OC_MLI:
+		OPCODE(ARF)
 
-			t++;
+			/*
+			 * Adds a reference to the memory handle on top of the stack
+			 * (null handles are ignored).
+			 */
 
-			address = m_stack[m_stack[base(code[p].l, b) + code[p].a]];
+			address = m_stack[t];
 
-			CHECK_MEMORY(address);
+			if (address)
+			{
+				CHECK_MEMORY(address);
 
-			i_p1 = (int*)m_memory_handles[address];
+				m_memory_handles[address][MEMORY_REFCOUNT_OFFSET]++;
+			}
 
-			i_p1 += m_registers[REG_CX];
+			t--;
+			p++;
 
-			m_stack[t] = *i_p1;
+			DISPATCH();
 
-			p++;
+		OPCODE(RLS)
 
-			break;
+			/*
+			 * Releases the memory handle on top of the stack.
+			 */
 
-		case OC_MST:
+			address = m_stack[t];
 
-			address = base(code[p]. l, b) + code[p].a;
+			RELEASE_REFERENCE(address);
 
-			CHECK_MEMORY(m_stack[base(code[p]. l, b) + code[p].a]);
+			t--;
+			p++;
 
-			i_p1 = (int*)m_memory_handles[m_stack[address]];
+			DISPATCH();
 
-			i_p1 += m_registers[REG_CX];
+		OPCODE(RLM)
 
-			*i_p1 = m_stack[t--];
+			/*
+			 * Releases l memory handles stored in the current frame
+			 * starting at a (used when a scope exits).
+			 */
 
-			p++;
-			
-			break;
+			for (i = 0; i < code[p].l; i++)
+			{
+				address = m_stack[b + code[p].a + i];
 
-		case OC_MSI:
+				RELEASE_REFERENCE(address);
+			}
 
-			address = m_stack[base(code[p]. l, b) + code[p].a];
+			p++;
 
-			CHECK_MEMORY(m_stack[base(code[p]. l, b) + code[p].a]);
+			DISPATCH();
 
-			i_p1 = (int*)m_memory_handles[m_stack[address]];
+		OPCODE(ACK)
 
-			i_p1 += m_registers[REG_CX];
+			/*
+			 * Array bounds check (see __array_check in array.p++).
+			 * [index][array handle]
+			 *
+			 * Grows the array if the index is past the end of its memory
+			 * and extends the array's length to include the index.  The
+			 * handle is popped and the index is left on the stack.
+			 */
 
-			*i_p1 = m_stack[t--];
+			address = m_stack[t];
 
-			p++;
+			if (address)
+			{
+				CHECK_MEMORY(address);
 
-			break;
+				temp = m_stack[t - 1] + 1;
 
-		case OC_CAS:
+				i_p1 = m_memory_handles[address];
 
-			param_count = 0;
+				if (MEMORY_SIZE(address) < temp + ARRAY_HEADER_SIZE)
+				{
+					/*
+					 * A view can't grow so it becomes ordinary memory.
+					 */
+					if (m_memory_views[address] && !view_detach(address))
+					{
+						INTERPRET_ERROR("Out of memory.\n");
+					}
+
+					i_p1 = resize_memory_handle(address, temp + ARRAY_RESOLUTION + ARRAY_HEADER_SIZE);
+
+					if (!i_p1)
+					{
+						INTERPRET_ERROR("Out of memory.\n");
+					}
+				}
 
-			temp = m_stack[t];
+				if (i_p1[ARRAY_LENGTH_OFFSET] < temp)
+				{
+					i_p1[ARRAY_LENGTH_OFFSET] = temp;
+				}
+			}
 
 			t--;
+			p++;
 
-			if (temp == 0)
-			{
-				INTERPRET_ERROR("Null function pointer exception.\n");
-			}
-			else
-			{
-				m_stack[t + 1] = base(code[p].l, b);
-				m_stack[t + 2] = b;
-				m_stack[t + 3] = p + 1;
+			DISPATCH();
 
-				p = temp;
+		OPCODE(CLI)
 				
-				b = t + 1;
-			}
-
-			break;
+			len = strlen(m_options.command_line);
 
-		case OC_CII:
+			m_size = (len + m_registers[REG_CX] + 1) * sizeof(int);
 
-			param_count = 0;
+			i_p1 = heap_alloc(m_size);
 
-			/*
-			 * Call two level indirectly.
-			 */
-			
-			address = base(code[p].l, b);
-			
-			if (m_stack[m_stack[address + code[p].a]] == 0)
+			if (!i_p1)
 			{
-				INTERPRET_ERROR("Null function pointer exception.\n");
+				INTERPRET_ERROR("Out of memory.\n");
 			}
-			else
+
+			*i_p1 = len + m_registers[REG_CX];
+			i_p1++;
+		
+			temp = find_free_memory_handle();
+
+			if (!temp)
 			{
-				m_stack[t + 1] = address;
-				m_stack[t + 2] = b;
-				m_stack[t + 3] = p + 1;
+				heap_free(i_p1 - 1, m_size);
 
-				p = m_stack[m_stack[address + code[p].a]];
-				
-				b = t + 1;
+				return 0;
 			}
 
-			break;
-
-		
-		case OC_IAD:
+			m_memory_handles[temp] = (i_p1);
+			m_stack[++t] = temp;
+			m_stack[++t] = len;
 
-			/*
-			 * Inline adding.
-			 */
+			ASSERT(0, "*ASSERT* Allocating memory handle for command line args (%x)\n", temp);
 			
-			if (!inline_operands(code, &i_p1, & i_p2))
+			i_p1 += m_registers[REG_CX];
+
+			for (j = 0; j < len; j++)
 			{
-				return 0;
+				i_p1[j] = m_options.command_line[j];
 			}
+			
+			p++;
+
+			DISPATCH();
+							
+		OPCODE(ADD_F)
 
 			/*
-			 * If the REG_DX register is flagged then this is a floating operation.
+			 * Floating point add and pop.
 			 */
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_ADD, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{				
-				*i_p1 += *i_p2;
-			}
+			t--;
+
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = *f_p1 + *f_p2;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_ISU:
+		OPCODE(SUB_F)
 
 			/*
-			 * Inline substracting.
+			 * Floating point subtract and pop.
 			 */
-			
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
 
-			/*
-			 * If the REG_DX register is flagged then this is a floating operation.
-			 */			
+			t--;
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_SUB, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{
-				*i_p1 -= *i_p2;
-			}
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = *f_p1 - *f_p2;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_ISL:
+		OPCODE(MUL_F)
 
 			/*
-			 * Inline shift left.
+			 * Floating point multiply and pop.
 			 */
 
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			t--;
 
-			*i_p1 <<= *i_p2;
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = *f_p1 * *f_p2;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_ISR:
+		OPCODE(DIV_F)
 
 			/*
-			 * Inline shift right.
+			 * Floating point divide and pop.
 			 */
 
-			if (!inline_operands(code, &i_p1, & i_p2))
+			t--;
+
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			if (*f_p2 == 0)
 			{
-				return 0;
+				INTERPRET_ERROR("Floating point divide by zero error.\n");
 			}
 
-			*i_p1 >>= *i_p2;
+			*f_p1 = *f_p1 / *f_p2;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IZL:
+		OPCODE(EQL_F)
 
 			/*
-			 * Inline indirect shift right.
+			 * Floating point equals and pop.
 			 */
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			t--;
 
-			*i_p1 >>= *i_p2;
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = (float)(*f_p1 == *f_p2);
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IZR:
+		OPCODE(NEQ_F)
 
 			/*
-			 * Inline indirect shift left.
+			 * Floating point not equals and pop.
 			 */
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			t--;
 
-			*i_p1 <<= *i_p2;
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = (float)(*f_p1 != *f_p2);
 
 			p++;
-			t--;
 
-			break;
-		
-		case OC_IXO:
+			DISPATCH();
+
+		OPCODE(LES_F)
 
 			/*
-			 * Inline XOR.
+			 * Floating point less than and pop.
 			 */
-			
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
 
-			/*
-			 * If the REG_DX register is flagged then this is a floating operation.
-			 */			
+			t--;
+
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
+
+			*f_p1 = (float)(*f_p1 < *f_p2);
 
-			*i_p1 ^= *i_p2;
-			
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IOR:
+		OPCODE(LEQ_F)
 
 			/*
-			 * Inline OR.
+			 * Floating point less than and equal to and pop.
 			 */
-			
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
-
-			/*
-			 * If the REG_DX register is flagged then this is a floating operation.
-			 */			
 
-			*i_p1 |= *i_p2;
-			
-			p++;
 			t--;
 
-			break;
-
-		case OC_IAN:
-
-			/*	
-			 * Inline AND.
-			 */
-			
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
 
-			/*
-			 * If the REG_DX register is flagged then this is a floating operation.
-			 */			
+			*f_p1 = (float)(*f_p1 <= *f_p2);
 
-			*i_p1 &= *i_p2;
-			
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IIX:
+		OPCODE(GRE_F)
 
 			/*
-			 * Inline indirect XOR.
+			 * Floating point greater than and pop.
 			 */
-			
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
 
-			*i_p1 ^= *i_p2;
-							
-			p++;
 			t--;
 
-			break;
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
 
-		case OC_IIO:
+			*f_p1 = (float)(*f_p1 > *f_p2);
+
+			p++;
+
+			DISPATCH();
+
+		OPCODE(GRQ_F)
 
 			/*
-			 * Inline indirect OR.
+			 * Floating point greater than and equal to and pop.
 			 */
-			
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
 
-			*i_p1 |= *i_p2;
-			
-			p++;
 			t--;
 
-			break;
-
-		case OC_IIB:
+			f_p1 = (float*)&m_stack[t];
+			f_p2 = (float*)&m_stack[t + 1];
 
-			/*	
-			 * Inline indirect and.
-			 */
-			
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			*f_p1 = (float)(*f_p1 >= *f_p2);
 
-			*i_p1 &= *i_p2;
-			
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IMU:
+		OPCODE(INT_F)
 
 			/*
-			 * Inline multiplying.
+			 * Floating point to integer.
 			 */
 
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			f_p1 = (float*)&m_stack[t];
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_MUL, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{				
-				*i_p1 *= *i_p2;
-			}
+			m_stack[t] = (int)*f_p1;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IDI:
+		OPCODE(FLO_F)
 
 			/*
-			 * Inline dividing.
+			 * Integer to floating point.
 			 */
 
-			if (!inline_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
-
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_DIV, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{				
-				if (*i_p2 == 0)
-				{
-					INTERPRET_ERROR("Divide by zero error.\n");
-				}
+			f_p1 = (float*)&m_stack[t];
 
-				*i_p1 /= *i_p2;
-			}
+			*f_p1 = (float)m_stack[t];
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IIA:
+		OPCODE(NEG_F)
 
 			/*
-			 * Inline indirect adding.
+			 * Floating point negative.
 			 */
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			f_p1 = (float*)&m_stack[t];
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_ADD, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{				
-				*i_p1 += *i_p2;
-			}
+			*f_p1 = -*f_p1;
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IIS:
+		OPCODE(WRT)
 
 			/*
-			 * Inline indirect substracting.
+			 * Write a number.
 			 */
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
-
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			if (m_stack[t - 1] == 0)
 			{
-				fop(FOP_SUB, (float*)i_p1, (float*)i_p2, NULL);
+				printf("%d",m_stack[t]);
 			}
 			else
-			{				
-				*i_p1 -= *i_p2;
+			{
+				fprintf(m_files[m_stack[t - 1]], "%d", m_stack[t]);
 			}
-
+			
+			t -= 2;
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IIM:
+		OPCODE(WRF)
 
 			/*
-			 * Inline indirect multiplying.
+			 * Write a number.
 			 */
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+			f_p1 = (float*)&m_stack[t];
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
+			if (m_stack[t - 1] == 0)
 			{
-				fop(FOP_MUL, (float*)i_p1, (float*)i_p2, NULL);
+				printf("%f", *f_p1);
 			}
 			else
-			{				
-				*i_p1 *= *i_p2;
+			{
+				fprintf(m_files[m_stack[t - 1]], "%f", *f_p1);
 			}
-
+			
+			
+			t -= 2;
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
 
-		case OC_IID:
+		OPCODE(TME)
 
 			/*
-			 * Inline indirect dividing.
+			 * Pushes the time onto the m_stack.
 			 */
+			
+			m_stack[++t] = (int)time(NULL);
+			p++;
+			
+			DISPATCH();
 
-			if (!inline_indirect_operands(code, &i_p1, & i_p2))
-			{
-				return 0;
-			}
+		OPCODE(CLK)
 
-			if (m_registers[REG_DX] & REG_FLOAT_FLAG)
-			{
-				fop(FOP_DIV, (float*)i_p1, (float*)i_p2, NULL);
-			}
-			else
-			{
-				if (*i_p2 == 0)
-				{
-					INTERPRET_ERROR("Divide by zero error.\n");
-				}
+			m_stack[++t] = (int)clock();
+			p++;
 
-				*i_p1 /= *i_p2;
-			}
+			DISPATCH();
+
+		OPCODE(DEB)
+			
+			/*
+			 * Debugging.
+			 */
+
+			printf("[%d]\n", (int)code[p].a);
 
 			p++;
-			t--;
-
-			break;
 
-		case OC_WRB:
-		case OC_WCH:
+			DISPATCH();
 
-			/*
-			 * Write out a byte.
-			 */
+		OPCODE(WRA)
 
-			if (m_stack[t - 1] == 0)
-			{					
-				putc(m_stack[t] & 0xff, stdout);
-			}
-			else
+			if (!file_write_array(&code[p]))
 			{
-				putc(m_stack[t], m_files[m_stack[t - 1]]);				
+				return 0;
 			}
-			
-			t -= 2;
+
 			p++;
 
-			break;
-		
-		case OC_REB:
+			DISPATCH();
 
-			if (m_stack[t] == 0)
+		OPCODE(RDL)
+		OPCODE(RDB)
+		OPCODE(RDA)
+
+			if (!file_read_array(&code[p]))
 			{
-				m_stack[t] = GETCH;
-			}
-			else
-			{				
-				m_stack[t] = getc(m_files[m_stack[t]]);
+				return 0;
 			}
 
 			p++;
 
-			break;
+			DISPATCH();
 
-		case OC_RCH:
-			
-			if (m_stack[t] == 0)
-			{
-				m_stack[t] = getchar();
-			}
-			else
+		OPCODE(ENV)
+
+			if (!environment_variable(&code[p]))
 			{
-				m_stack[t] = getc(m_files[m_stack[t]]);				
+				return 0;
 			}
 
 			p++;
 
-			break;
-
-		case OC_MAL:
-
-			m_size = (m_stack[t] + 1) * sizeof(int);
+			DISPATCH();
 
-			i_p1 = calloc(m_size, 1);
-			*i_p1 = m_stack[t];
+		OPCODE(FMP)
 
-			temp = find_free_memory_handle();
-			m_memory_handles[temp] = (i_p1 + 1);
-			
-			m_stack[t] = temp;
+			if (!file_map(&code[p]))
+			{
+				return 0;
+			}
 
-			ASSERT(0, "\t*ASSERT* Allocating memory handle (%x)\n", temp);
-			
 			p++;
 
-			break;
-
-		case OC_RAL:
-						
-			address = m_stack[t - 1];
+			DISPATCH();
 
-			CHECK_MEMORY(address);
+		OPCODE(FOF)
 
-			i_p1 = m_memory_handles[address];
+			file_open(code);
 
-			i_p1--;
-			
-			temp = (*i_p1 + 1) * sizeof(int);
+			p++;
 
-			m_size = (m_stack[t] + 1) * sizeof(int);
+			DISPATCH();
 
-			ASSERT1(0, "\t*ASSERT* Reallocating memory handle (%x) to %d integers\n", address, m_stack[t]);
+		OPCODE(FCF)
 
-			i_p2 = realloc(i_p1, m_size);
-							
-			*i_p2 = m_stack[t];
-							
-			if (m_size > temp)
-			{	
-				memset(((char*)i_p2) + temp, 0, m_size - temp);
-			}
-			
-			m_memory_handles[address] = i_p2 + 1;
+			file_close(&code[p]);
 
-			t -= 2;
 			p++;
 
-			break;
+			DISPATCH();
 
-		case OC_FRE:
+		OPCODE(EOF)
 
 			/*
-			 * Frees some memory off the heap (takes a handle to the memory).
+			 * Top of the stack holds the stream handle.
+			 * Overwrite it with whether the stream has ended.
 			 */
 
-			address = m_stack[t];
+			if (m_stack[t])
+			{
+				m_stack[t] = feof(m_files[m_stack[t]]) ? 1 : 0;
+			}
+			else
+			{
+				m_stack[t] = 0;
+			}
 
-			CHECK_MEMORY(address);
+			p++;
 
-			i_p1 = (int*)m_memory_handles[address];
+			DISPATCH();
 
-			i_p1--;
+		OPCODE(HNW)
 
-			ASSERT(0, "\t*ASSERT* Freeing memory handle (%x)\n", address);
-			
-			free(i_p1);
+			if (!map_new())
+			{
+				return 0;
+			}
 
-			m_memory_handles[address] = 0;
-						
 			p++;
 
-			break;
+			DISPATCH();
 
-		case OC_MSZ:
-			
-			address = m_stack[t];
+		OPCODE(HFR)
 
-			CHECK_MEMORY(address);
+			if (!map_free())
+			{
+				return 0;
+			}
 
-			i_p1 = m_memory_handles[address];
+			p++;
 
-			i_p1--;
+			DISPATCH();
 
-			m_stack[t] = (*i_p1);
+		OPCODE(HPT)
 
-			p++;
+			if (!map_put())
+			{
+				return 0;
+			}
 
-			break;
-			
-		case OC_MLS:
-			
-			/*
-			 * Loads some memory onto the stack, the handle is given
-			 * by the stack.
-			 */
-			
-			t++;
-			
-			/*
-			 * If the REG_DX register is flagged.
-			 */
+			p++;
 
-			temp = m_stack[t - 1 - code[p].a];
-	
-			/*
-			 * Then this is a memory operation, the REG_CX register
-			 * holds the offset.  The address and level provided is
-			 * for the handle to the memory.
-			 */					
+			DISPATCH();
 
-			CHECK_MEMORY(temp);
+		OPCODE(HGT)
 
-			i_p1 = (int*)m_memory_handles[temp];
+			if (!map_get())
+			{
+				return 0;
+			}
 
-			i_p1 += m_registers[REG_CX];
-			
-			m_stack[t] = *i_p1;
-						
 			p++;
-			
-			break;
-				
-		case OC_MSS:
 
-			/*
-			 * Store the stack onto some heap memory.
-			 */
+			DISPATCH();
 
-			/*
-			 * If the REG_DX register is flagged.
-			 */
+		OPCODE(HRM)
 
-			CHECK_MEMORY(m_stack[t - code[p].a]);
+			if (!map_remove())
+			{
+				return 0;
+			}
 
-			i_p1 = (int*)m_memory_handles[m_stack[t - code[p].a]];
+			p++;
 
-			i_p1 += m_registers[REG_CX];
+			DISPATCH();
 
-			*i_p1 = m_stack[t];
+		OPCODE(HCT)
+
+			if (!map_count())
+			{
+				return 0;
+			}
 
 			p++;
-			t--;
 
-			break;
+			DISPATCH();
+
+		/*
+		 * Superinstructions.  Each one does the work of the sequence
+		 * of instructions starting at p (see decoder.c).
+		 */
 
-		case OC_MCP:
+		OPCODE(LIT_CAL)
 
 			/*
-			 * Copy some memory garunteeing overlapped copies.
-			 * [dest][dest offset][src][src offset][size]
+			 * LIT; CAL (push the return value and call directly).
 			 */
 
-			CHECK_MEMORY(m_stack[t - 4]);
-			CHECK_MEMORY(m_stack[t - 2]);
+			m_stack[++t] = code[p].a;
 
-			i_p1 = (int*)m_memory_handles[m_stack[t - 4]] + m_stack[t - 3];
-			i_p2 = (int*)m_memory_handles[m_stack[t - 2]] + m_stack[t - 1];
+			address = FRAME(code[p + 1].l);
 
-			if (m_stack[t - 4] == m_stack[t - 2])
-			{
-				memmove(i_p1, i_p2, m_stack[t] * sizeof(int));
-			}
-			else
+			if (address == 0)
 			{
-				memcpy(i_p1, i_p2, m_stack[t] * sizeof(int));
+				INTERPRET_ERROR("Null function pointer exception.\n");
 			}
 
-			t -= 5;
-			p++;
-
-			break;
+			m_stack[t + 1] = address;
+			m_stack[t + 2] = b;
+			m_stack[t + 3] = p + 2;
 
-		case OC_CLI:
-				
-			len = strlen(m_options.command_line);
+			b = t + 1;
 
-			m_size = (len + m_registers[REG_CX] + 1) * sizeof(int);
+			DISPLAY_CALL(code[p + 1].l);
 
-			i_p1 = calloc(m_size, 1);
-			*i_p1 = len + m_registers[REG_CX];
-			i_p1++;
-		
-			temp = find_free_memory_handle();
-			m_memory_handles[temp] = (i_p1);
-			m_stack[++t] = temp;
-			m_stack[++t] = len;
+			p = code[p + 1].a;
 
-			ASSERT(0, "*ASSERT* Allocating memory handle for command line args (%x)\n", temp);
-			
-			i_p1 += m_registers[REG_CX];
+			param_count = 0;
 
-			for (j = 0; j < len; j++)
-			{
-				i_p1[j] = m_options.command_line[j];
-			}
-			
-			p++;
+			DISPATCH();
 
-			break;
-							
-		case OC_FOP:
+		OPCODE(LIT_CAL_U)
 
 			/*
-			 * If this is an operation that works on two values off the m_stack.
+			 * LIT; CAL in a verified program (see CAL_U).
 			 */
 
-			if (code[p].a != FOP_INT && code[p].a != FOP_FLO && code[p].a != FOP_NEG)
-			{
-				/*
-				 * Decrease the m_stack position.
-				 */
-				t--;
-			}
+			m_stack[++t] = code[p].a;
 
-			if (!fop(code[p].a, (float*)&m_stack[t], (float*)&m_stack[t + 1], (float*)&m_stack[t]))
-			{
-				return 0;
-			}
+			m_stack[t + 1] = FRAME(code[p + 1].l);
+			m_stack[t + 2] = b;
+			m_stack[t + 3] = p + 2;
 
-			p++;
-		
-			break;
-		
-		case OC_WRT:
+			b = t + 1;
 
-			/*
-			 * Write a number.
-			 */
+			DISPLAY_CALL(code[p + 1].l);
 
-			if (m_stack[t - 1] == 0)
-			{
-				printf("%d",m_stack[t]);
-			}
-			else
-			{
-				fprintf(m_files[m_stack[t - 1]], "%d", m_stack[t]);
-			}
-			
-			t -= 2;
-			p++;
+			p = code[p + 1].a;
 
-			break;
+			param_count = 0;
 
-		case OC_WRF:
+			DISPATCH();
+
+		OPCODE(ENTER_LIS)
 
 			/*
-			 * Write a number.
+			 * ENTER; LIS (function prologue).
 			 */
 
-			f_p1 = (float*)&m_stack[t];
+			t += code[p].a;
 
-			if (m_stack[t - 1] == 0)
+			if (b + code[p].l >= m_stack_size && !grow_stack(b + code[p].l))
 			{
-				printf("%f", *f_p1);
+				goto stack_overflow;
 			}
-			else
+
+			m_temp = t;
+
+			while (t < m_temp + code[p + 1].l)
 			{
-				fprintf(m_files[m_stack[t - 1]], "%f", *f_p1);
+				t++;
+				m_stack[t] = code[p + 1].a;
 			}
-			
-			
-			t -= 2;
-			p++;
 
-			break;
+			p += 2;
 
-		case OC_TME:
+			DISPATCH();
 
-			/*
-			 * Pushes the time onto the m_stack.
-			 */
-			
-			m_stack[++t] = (int)time(NULL);
-			p++;
-			
-			break;
+		OPCODE(LOD_STP)
+
+			/*
+			 * LOD; STP (pass a variable as a parameter).
+			 */
 
-		case OC_CLK:
+			param_count++;
 
-			m_stack[++t] = (int)clock();
-			p++;
+			m_stack[t + 1 + code[p + 1].a] = m_stack[FRAME(code[p].l) + code[p].a];
 
-			break;
+			p += 2;
+
+			DISPATCH();
+
+		OPCODE(SRV_RET)
 
-		case OC_DEB:
-			
 			/*
-			 * Debugging.
+			 * SRV; RET (return a value).
 			 */
 
-			printf("[%d]\n", (int)code[p].a);
-
-			p++;
+			m_stack[b - code[p].a] = m_stack[t];
 
-			break;
+			t = b - 1;
 
-		case OC_FOF:
+			b = m_stack[t + 2];
+			p = m_stack[t + 3];
 
-			file_open(code);
+			DISPLAY_RETURN();
 
-			p++;
+			DISPATCH();
 
-			break;
+		OPCODE(LOD_LIT)
 
-		case OC_FCF:
+			/*
+			 * LOD; LIT.
+			 */
 
-			file_close(&code[p]);
+			m_stack[t + 1] = m_stack[FRAME(code[p].l) + code[p].a];
+			m_stack[t + 2] = code[p + 1].a;
 
-			p++;
+			t += 2;
+			p += 2;
 
-			break;
+			DISPATCH();
 
-		case OC_EOF:
+		OPCODE(LIT_ADD)
 
 			/*
-			 * Top of the stack holds the stream handle.
-			 * Overwrite it with whether the stream has ended.
+			 * LIT; OPR ADD.
 			 */
 
-			if (m_stack[t])
-			{
-				m_stack[t] = feof(m_files[m_stack[t]]) ? 1 : 0;
-			}
-			else
-			{
-				m_stack[t] = 0;
-			}
+			m_stack[t] += code[p].a;
 
-			p++;
+			p += 2;
 
-			break;
+			DISPATCH();
 
-		default:
+		OPCODE(LIT_SUB)
 
-			INTERPRET_ERROR("Unknown instruction.\n");
+			/*
+			 * LIT; OPR SUB.
+			 */
 
-			p++;
-	}
+			m_stack[t] -= code[p].a;
 
-	return 1;
-}
+			p += 2;
 
-void print_stack_line()
-{
-	int j;
+			DISPATCH();
 
-	for (j = 1; j <= t; j++)
-	{
-		printf("%d ", m_stack[j]);
-	}
-}
+		OPCODE(LIT_EQL)
 
-/*
- * Interpret some code.
- */
-int real_interpret(instruction_t* code)
-{
-	memset(m_registers, 0, sizeof(m_registers));
-	memset(m_memory_handles, 0, sizeof(m_memory_handles));
-	memset(m_files, 0, sizeof(m_files));
+			/*
+			 * LIT; OPR EQL.
+			 */
 
-	t = 0;
-	b = 1;
-	p = 0;
+			m_stack[t] = (m_stack[t] == code[p].a);
 
-	m_stack[1] = 0;
-	m_stack[2] = 0;
-	m_stack[3] = 0;
+			p += 2;
+
+			DISPATCH();
+
+		OPCODE(LOD_LIT_EQL)
 
-	if (m_options.trace_stack)
-	{
-		do
-		{
 			/*
-			 * Conservative stack overflow error checking.
+			 * LOD; LIT; OPR EQL.
 			 */
 
-			if (t >= STACK_SIZE - 2)
-			{
-				INTERPRET_ERROR("\n\nStack overflow error.\n");
-			}
+			m_stack[++t] = (m_stack[FRAME(code[p].l) + code[p].a] == code[p + 1].a);
 
-			if (!single_interpret(code))
-			{
-				break;
-			}
+			p += 3;
 
-			print_stack_line();
+			DISPATCH();
+
+		OPCODE(BOOL)
 
-			printf("\n");
-		}
-		while (p!=0);
-	}
-	else
-	{
-		do
-		{
 			/*
-			 * Conservative stack overflow error checking.
+			 * LIT 0; OPR EQL; OPR NOT; LIT 1; OPR AND (make the top 1
+			 * if it's non zero and 0 otherwise).
 			 */
-			if (t >= STACK_SIZE - 2)
-			{
-				INTERPRET_ERROR("\n\nStack overflow error.\n");
-			}
 
-			if (!single_interpret(code))
-			{
-				break;
-			}			
-		}
-		while (p!=0);
-	}
+			m_stack[t] = (m_stack[t] != 0);
 
-	if(!all_handles_free())
-	{
-		printf("Possible memory leaks.");
-	}
-	
-	return 1;
-}
+			p += 5;
 
-/*
- * Do floating point operation.
- */
-int fop(int op, float *f1_p, float *f2_p, float *result_p)
-{
-	int *i1_p;
+			DISPATCH();
 
-	switch (op)
-	{
-		case FOP_ADD:
+		OPCODE(LNOT)
 
-			*f1_p = *f1_p + *f2_p;
+			/*
+			 * LIT 0; OPR EQL; LIT 1; OPR AND (logical not).
+			 */
 
-			break;
+			m_stack[t] = (m_stack[t] == 0);
 
-		case FOP_SUB:
+			p += 4;
 
-			*f1_p = *f1_p - *f2_p;
+			DISPATCH();
 
-			break;
+		OPCODE(LOD_LIT_ADD_STO)
 
-		case FOP_MUL:
-			
-			*f1_p = *f1_p * *f2_p;
+			/*
+			 * LOD; LIT; OPR ADD; STO (x := y + n).
+			 */
 
-			break;
+			m_stack[FRAME(code[p + 3].l) + code[p + 3].a] = m_stack[FRAME(code[p].l) + code[p].a] + code[p + 1].a;
 
-		case FOP_DIV:
+			p += 4;
 
-			if (*f2_p == 0)
-			{
-				INTERPRET_ERROR("Floating point divide by zero error.\n");
-			}
+			DISPATCH();
 
-			*f1_p = *f1_p / *f2_p;
+		COMPARE_JUMP(EQL_JPC, ==)
+		COMPARE_JUMP(NEQ_JPC, !=)
+		COMPARE_JUMP(LES_JPC, <)
+		COMPARE_JUMP(LEQ_JPC, <=)
+		COMPARE_JUMP(GRE_JPC, >)
+		COMPARE_JUMP(GRQ_JPC, >=)
 
-			break;
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_EQL_JPC, ==)
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_NEQ_JPC, !=)
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_LES_JPC, <)
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_LEQ_JPC, <=)
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_GRE_JPC, >)
+		LOAD_LOAD_COMPARE_JUMP(LOD_LOD_GRQ_JPC, >=)
 
-		case FOP_EQL:
-			
-			*result_p = (float)(*f1_p == *f2_p);
+		OPCODE(UNKNOWN)
 
-			break;
+			INTERPRET_ERROR("Unknown instruction.\n");
 
-		case FOP_NEQ:
+			p++;
 
-			*result_p = (float)(*f1_p != *f2_p);
+			DISPATCH();
+#ifndef THREADED_CODE
+		}
 
-			break;
+dispatch:
 
-		case FOP_LES:
+		if (m_options.trace_stack)
+		{
+			print_stack_line();
+			printf("\n");
+		}
 
-			*result_p = (float)(*f1_p < *f2_p);
-			
-			break;
+		/*
+		 * Returning to address 0 ends the program.
+		 */
+		if (p == 0)
+		{
+			goto halt;
+		}
 
-		case FOP_LEQ:
+		if (m_options.profile_opcodes)
+		{
+			profile_record(p, code[p].op);
+		}
 
-			*result_p = (float)(*f1_p <= *f2_p);
+	}
+#endif
 
-			break;
+halt:
 
-		case FOP_GRE:
+#ifdef THREADED_CODE
+	if (m_options.trace_stack)
+	{
+		print_stack_line();
+		printf("\n");
+	}
+#endif
 
-			*result_p = (float)(*f1_p > *f2_p);
+	return 1;
 
-			break;
+stack_overflow:
 
-		case FOP_GRQ:
+	printf("*ERROR* %s", "\n\nStack overflow error.\n");
 
-			*result_p = (float)(*f1_p >= *f2_p);
+	return -1;
+}
 
-			break;
+/*
+ * Interpret some decoded code.
+ */
+int real_interpret(decoded_instruction_t *code, int count)
+{
+	int result;
 
-		case FOP_INT:
+	memset(m_registers, 0, sizeof(m_registers));
+	memset(m_files, 0, sizeof(m_files));
 
-			i1_p = ((int*)f1_p);
+	t = 0;
+	b = 1;
+	p = 0;
 
-			*i1_p = ((int)*f1_p);
+#ifndef NO_DISPLAY_REGISTERS
+	m_level = 0;
+	m_display[0] = b;
 
-			break;
+	/*
+	 * The main program block returns without having been called.
+	 */
+	m_display_saves[0].level = 0;
+	m_display_saves[0].display = b;
+	m_call_depth = 1;
+#endif
 
-		case FOP_FLO:
+	m_stack[1] = 0;
+	m_stack[2] = 0;
+	m_stack[3] = 0;
 
-			i1_p = ((int*)f1_p);
+	if (m_options.profile_opcodes)
+	{
+		profile_reset();
+	}
 
-			*f1_p = (float)*i1_p;
-			
-			break;
+	result = execute(code, count);
 
-		case FOP_NEG:
+	if (m_options.profile_opcodes)
+	{
+		profile_print();
+	}
+
+	if (m_options.heap_statistics)
+	{
+		heap_print_statistics();
+	}
 
-			*f1_p = -*f1_p;
-	}	
+	if (result < 0)
+	{
+		return 0;
+	}
 
+	if(!all_handles_free())
+	{
+		printf("Possible memory leaks.");
+	}
+	
 	return 1;
 }
 
@@ -2411,12 +4842,114 @@ void print_out_code(instruction_t* instructions, int len)
 
 			break;
 
+		case OC_WRA:
+
+			printf("WRA  ");
+
+			break;
+
+		case OC_RDL:
+
+			printf("RDL  ");
+
+			break;
+
+		case OC_RDB:
+
+			printf("RDB  ");
+
+			break;
+
+		case OC_RDA:
+
+			printf("RDA  ");
+
+			break;
+
+		case OC_FMP:
+
+			printf("FMP  ");
+
+			break;
+
+		case OC_HNW:
+
+			printf("HNW  ");
+
+			break;
+
+		case OC_HFR:
+
+			printf("HFR  ");
+
+			break;
+
+		case OC_HPT:
+
+			printf("HPT  ");
+
+			break;
+
+		case OC_HGT:
+
+			printf("HGT  ");
+
+			break;
+
+		case OC_HRM:
+
+			printf("HRM  ");
+
+			break;
+
+		case OC_HCT:
+
+			printf("HCT  ");
+
+			break;
+
+		case OC_ENV:
+
+			printf("ENV  ");
+
+			break;
+
 		case OC_MSZ:
 
 			printf("MSZ  ");
 
 			break;
 
+		case OC_SLC:
+
+			printf("SLC  ");
+
+			break;
+
+		case OC_ARF:
+
+			printf("ARF  ");
+
+			break;
+
+		case OC_RLS:
+
+			printf("RLS  ");
+
+			break;
+
+		case OC_RLM:
+
+			printf("RLM  ");
+
+			break;
+
+		case OC_ACK:
+
+			printf("ACK  ");
+
+			break;
+
 		case OC_IIA:
 			
 			printf("IIA  ");
@@ -2530,3 +5063,35 @@ void print_out_code(instruction_t* instructions, int len)
 		printf("0x%x\n", (int)instructions[i].a);
 	}
 }
+
+/*
+ * Prints each function's address, frame (header, parameters and locals)
+ * and the most stack it uses (what its entry reserves).
+ */
+void print_out_functions(compiler_results_t *results)
+{
+	int i, address, frame;
+
+	printf("%-32s %8s %8s %8s\n", "Function", "Address", "Frame", "Stack");
+
+	for (i = 0; i < results->symbols_num; i++)
+	{
+		address = results->symbols[i].address;
+		frame = 0;
+
+		if (address >= 0 && address < results->opcodes_generated
+			&& results->instructions[address].f == OC_INC)
+		{
+			frame = (int)results->instructions[address].a;
+
+			if (address + 1 < results->opcodes_generated
+				&& results->instructions[address + 1].f == OC_LIS)
+			{
+				frame += results->instructions[address + 1].l;
+			}
+		}
+
+		printf("%-32s %8x %8d %8d\n", results->symbol_names + results->symbols[i].name,
+			address, frame, results->symbols[i].stack_size);
+	}
+}
@@ -1,4 +1,6 @@
 #include "compiler.h"
 
-int interpret(instruction_t* code);
+int interpret(instruction_t* code, int len);
+int interpret_server(instruction_t* code, int len, const char *address);
 void print_out_code(instruction_t* instructions, int len);
+void print_out_functions(compiler_results_t *results);
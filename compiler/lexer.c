@@ -0,0 +1,295 @@
+/*
+ * @file lexer.c
+ *
+ * @description
+ *
+ * Keyword and operator tables used by the scanner.
+ */
+
+#include "string.h"
+#include "symbols.h"
+#include "lexer.h"
+
+typedef struct tag_lexeme lexeme_t;
+
+struct tag_lexeme
+{
+	const char *name;
+	int symbol;
+};
+
+/*
+ * Keywords of the P++ language.
+ */
+static const lexeme_t m_keywords[] =
+{
+	{"begin",			SYM_BEGIN},
+	{"end",				SYM_END},
+	{"call",			SYM_CALL},
+	{"const",			SYM_CONST},
+	{"do",				SYM_DO},
+	{"if",				SYM_IF},
+	{"else",			SYM_ELSE},
+	{"odd",				SYM_ODD},
+	{"procedure",		SYM_PROCEDURE},
+	{"then",			SYM_THEN},
+	{"var",				SYM_VAR},
+	{"while",			SYM_WHILE},
+	{"integer",			SYM_INTEGER},
+	{"for",				SYM_FOR},
+	{"to",				SYM_TO},
+	{"step",			SYM_STEP},
+	{"exit",			SYM_EXIT},
+	{"function",		SYM_FUNCTION},
+	{"return",			SYM_RETURN},
+	{"goto",			SYM_GOTO},
+	{"include",			SYM_INCLUDE},
+	{"using",			SYM_INCLUDE},
+	{"lambda",			SYM_LAMBDA},
+	{"repeat",			SYM_REPEAT},
+	{"which",			SYM_WHICH},
+	{"case",			SYM_CASE},
+	{"ref",				SYM_REF},
+	{"val",				SYM_VAL},
+	{"asm",				SYM_ASM},
+	{"machine_code",	SYM_ASM},
+	{"float",			SYM_FLOAT},
+	{"void",			SYM_VOID},
+	{"handle",			SYM_HANDLE},
+	{"string",			SYM_STRING},
+	{"bignumber",		SYM_BIGNUMBER},
+	{"array",			SYM_ARRAY},
+	{"byte",			SYM_INTEGER},
+	{"biginteger",		SYM_BIGNUMBER},
+	{"character",		SYM_CHARACTER},
+	{"boolean",			SYM_BOOLEAN},
+	{"not",				SYM_EXCLAMATION},
+	{"or",				SYM_LOR},
+	{"and",				SYM_LAND},
+	{"pragma",			SYM_PRAGMA},
+	{"option",			SYM_PRAGMA},
+	{"boundary_check",	SYM_BOUNDARY_CHECK},
+	{"optimize",		SYM_OPTIMIZE},
+	{"continue",		SYM_CONTINUE},
+	{"null",			SYM_NULL},
+	{"declare",			SYM_DECLARE},
+	{"type",			SYM_TYPE},
+	{"clean",			SYM_CLEAN},
+	{"abs",				SYM_ABS}
+};
+
+/*
+ * Number of slots in the keyword hash (must be a power of 2).
+ */
+#define KEYWORD_SLOTS		0x80
+
+/*
+ * Hashes a keyword (or an identifier) to its slot.
+ *
+ * The multipliers were picked so that no two keywords share a slot.  When
+ * a keyword is added new ones have to be found and m_keyword_slots
+ * rebuilt.
+ */
+#define KEYWORD_HASH(name, len)	\
+	(((unsigned char)(name)[0] * 41 + (unsigned char)(name)[1] * 42	\
+	+ (unsigned char)(name)[(len) - 1] * 59 + (len)) & (KEYWORD_SLOTS - 1))
+
+/*
+ * Index (plus one) into m_keywords of the keyword in each slot, 0 for an
+ * empty slot.
+ */
+static const unsigned char m_keyword_slots[KEYWORD_SLOTS] =
+{
+	 0,  0, 10,  0,  0, 44,  0, 45,  0, 29,  0,  0,  0,  0,  0,  0,
+	26,  6,  0, 41,  0,  0, 24, 23,  0, 11,  0,  0, 25, 17,  0, 46,
+	 0, 53,  0,  1, 43, 36,  0,  0,  0,  0, 13, 21, 32,  3,  0,  0,
+	 7,  0, 30,  0, 19,  0, 34, 28, 49, 51, 39, 35, 38,  0,  8,  0,
+	 0,  0,  0, 42,  0,  0,  0, 16,  2, 40,  0,  0,  0,  0, 20, 31,
+	 0,  5,  4,  0,  0, 14,  0, 37,  0, 27,  0,  0,  0, 22,  0, 33,
+	48, 15,  0,  0, 50,  0,  0,  0,  0,  0, 18, 12,  0,  0,  0,  0,
+	 0,  0, 52,  0,  9,  0, 47,  0,  0,  0,  0,  0,  0,  0,  0,  0
+};
+
+/*
+ * Operators (none alphabetal symbols), sorted by their characters' values.
+ * An operator must come straight before the operators it is a prefix of.
+ */
+static const lexeme_t m_operators[] =
+{
+	{"!",		SYM_EXCLAMATION},
+	{"!=",		SYM_NOT_EQL},
+	{"$!=",		SYM_STR_NEQUALS},
+	{"$=",		SYM_STR_EQUALS},
+	{"%",		SYM_PERCENT},
+	{"&",		SYM_AMPERSAND},
+	{"&&",		SYM_LAND},
+	{"&=",		SYM_AMPERSAND_EQL},
+	{"'",		SYM_APOS},
+	{"(",		SYM_LPAREN},
+	{")",		SYM_RPAREN},
+	{"*",		SYM_STAR},
+	{"*/",		SYM_RBLOCKCOMMENT},
+	{"*=",		SYM_STAR_EQL},
+	{"+",		SYM_PLUS},
+	{"++",		SYM_PLUS_PLUS},
+	{"+=",		SYM_PLUS_EQL},
+	{",",		SYM_COMMA},
+	{"-",		SYM_MINUS},
+	{"--",		SYM_MINUS_MINUS},
+	{"-=",		SYM_MINUS_EQL},
+	{".",		SYM_PERIOD},
+	{"..",		SYM_DOTDOT},
+	{"/",		SYM_SLASH},
+	{"/*",		SYM_LBLOCKCOMMENT},
+	{"//",		SYM_LINECOMMENT},
+	{"/=",		SYM_SLASH_EQL},
+	{":",		SYM_COLON},
+	{":=",		SYM_BECOMES},
+	{";",		SYM_SEMICOLON},
+	{"<",		SYM_LESS},
+	{"<-",		SYM_LESSMINUS},
+	{"<<",		SYM_LCHEVRON},
+	{"<<=",		SYM_LCHEVRON_EQL},
+	{"<=",		SYM_LES_EQL},
+	{"=",		SYM_EQL},
+	{"=>",		SYM_EQMORE},
+	{">",		SYM_GREATER},
+	{">=",		SYM_GRE_EQL},
+	{">>",		SYM_RCHEVRON},
+	{">>=",		SYM_RCHEVRON_EQL},
+	{"?",		SYM_QMARK},
+	{"@",		SYM_AT},
+	{"[",		SYM_LBRACKET},
+	{"]",		SYM_RBRACKET},
+	{"^",		SYM_HAT},
+	{"^=",		SYM_HAT_EQL},
+	{"{",		SYM_BEGIN},
+	{"|",		SYM_PIPE},
+	{"|=",		SYM_PIPE_EQL},
+	{"||",		SYM_LOR},
+	{"}",		SYM_END},
+	{"~",		SYM_TILD}
+};
+
+#define NUMBER_OF_OPERATORS	(int)(sizeof(m_operators) / sizeof(m_operators[0]))
+
+/*
+ * Returns the symbol of a keyword or SYM_NOSYM if name (of len characters)
+ * isn't one.
+ */
+int keyword_symbol(const char *name, int len)
+{
+	int slot;
+
+	if (len < 2)
+	{
+		return SYM_NOSYM;
+	}
+
+	slot = m_keyword_slots[KEYWORD_HASH(name, len)];
+
+	if (slot == 0 || strcmp(m_keywords[slot - 1].name, name) != 0)
+	{
+		return SYM_NOSYM;
+	}
+
+	return m_keywords[slot - 1].symbol;
+}
+
+/*
+ * Starts a node at the root of the operator trie (no characters read).
+ */
+void operator_node_init(operator_node_t *node_p)
+{
+	node_p->lo = 0;
+	node_p->hi = NUMBER_OF_OPERATORS;
+	node_p->depth = 0;
+}
+
+/*
+ * Moves a node to its child for the next character.  Returns FALSE (and
+ * leaves the node alone) if no operator continues with that character.
+ */
+BOOL operator_node_next(operator_node_t *node_p, char c)
+{
+	int lo, hi, mid, first;
+	unsigned char ch = (unsigned char)c;
+
+	/*
+	 * The operators in a node's range share its first depth characters so
+	 * they're sorted by the next one.  Find the first operator whose next
+	 * character isn't below c...
+	 */
+	lo = node_p->lo;
+	hi = node_p->hi;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+
+		if ((unsigned char)m_operators[mid].name[node_p->depth] < ch)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	first = lo;
+
+	/*
+	 * ...and the first one past it whose next character is above c.
+	 */
+	hi = node_p->hi;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+
+		if ((unsigned char)m_operators[mid].name[node_p->depth] <= ch)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	if (first == lo || ch == 0)
+	{
+		return 0;
+	}
+
+	node_p->lo = first;
+	node_p->hi = lo;
+	node_p->depth++;
+
+	return 1;
+}
+
+/*
+ * Tests to see if there are any operators longer than the characters read
+ * so far that start with them.
+ */
+BOOL operator_node_extends(const operator_node_t *node_p)
+{
+	return node_p->hi - node_p->lo > 1
+		|| m_operators[node_p->lo].name[node_p->depth] != 0;
+}
+
+/*
+ * Returns the symbol of the operator made of the characters read so far
+ * or SYM_NOSYM if they're only the start of one.
+ */
+int operator_node_symbol(const operator_node_t *node_p)
+{
+	if (node_p->depth == 0 || m_operators[node_p->lo].name[node_p->depth] != 0)
+	{
+		return SYM_NOSYM;
+	}
+
+	return m_operators[node_p->lo].symbol;
+}
@@ -0,0 +1,49 @@
+/*
+ * @file lexer.h
+ *
+ * @description
+ *
+ * Keyword and operator tables used by the scanner (get_symbol).
+ *
+ * Both tables are static data so nothing has to be built when the
+ * compiler starts.
+ *
+ * Keywords are found with a perfect hash: no two keywords share a slot,
+ * so a lookup is one hash and at most one strcmp.
+ *
+ * Operators are kept sorted, which makes the table a trie.  The operators
+ * that start with the characters read so far are always a contiguous range
+ * of it (an operator_node_t) and each further character narrows the range.
+ * The scanner reads an operator one character at a time until no longer
+ * operator can follow, so "<", "<<" and "<<=" are told apart.
+ */
+
+#ifndef __LEXER_H
+#define __LEXER_H
+
+#include "types.h"
+
+typedef struct tag_operator_node operator_node_t;
+
+struct tag_operator_node
+{
+	/*
+	 * Range of the operator table ([lo, hi)) that starts with the
+	 * characters read so far.
+	 */
+	int lo;
+	int hi;
+
+	/*
+	 * Number of characters read so far.
+	 */
+	int depth;
+};
+
+int keyword_symbol(const char *name, int len);
+void operator_node_init(operator_node_t *node_p);
+BOOL operator_node_next(operator_node_t *node_p, char c);
+BOOL operator_node_extends(const operator_node_t *node_p);
+int operator_node_symbol(const operator_node_t *node_p);
+
+#endif
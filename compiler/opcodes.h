@@ -82,6 +82,19 @@
 #define OC_MLI				0xA140
 #define OC_MSI				0xA150
 #define OC_MCP				0xA160
+#define OC_SLC				0xA170
+
+/*
+ * Reference counting opcodes (used when memory.p++ is included).
+ */
+#define OC_ARF				0xA200
+#define OC_RLS				0xA210
+#define OC_RLM				0xA220
+
+/*
+ * Array opcodes (used when array.p++ is included).
+ */
+#define OC_ACK				0xA300
 
 /*
  * Register opcodes
@@ -106,6 +119,11 @@
 #define OC_REB				0xC070
 #define OC_RCH				0xC080
 #define OC_WCH				0xC090
+#define OC_WRA				0xC0A0
+#define OC_RDL				0xC0B0
+#define OC_RDB				0xC0C0
+#define OC_RDA				0xC0D0
+#define OC_ENV				0xC0E0
 
 /*
  * File/Stream opcodes.
@@ -113,6 +131,17 @@
 #define OC_FOF				0xD000
 #define OC_FCF				0xD010
 #define OC_EOF				0xD020
+#define OC_FMP				0xD030
+
+/*
+ * Map opcodes (integer keys to integer values, see map.p++).
+ */
+#define OC_HNW				0xE000
+#define OC_HFR				0xE010
+#define OC_HPT				0xE020
+#define OC_HGT				0xE030
+#define OC_HRM				0xE040
+#define OC_HCT				0xE050
 
 /*
  * OC_OPR integer operators.
@@ -171,3 +200,4 @@
 #define F_CREATE			0x80
 #define F_TEXT				0x100
 #define F_BINARY			0x200
+#define F_READ_AHEAD		0x400
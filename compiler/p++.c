@@ -1,6 +1,7 @@
 #include "types.h"
 #include "time.h"
 #include "string.h"
+#include "stdlib.h"
 #include "compiler.h"
 #include "hashtable.h"
 #include "interpretor.h"
@@ -22,14 +23,22 @@ void print_help()
 	printf("(-/+)v\t Verbose output\n");
 	printf("(-/+)o\t Write output binary (.pins)\n");
 	printf("(-/+)Z1\t Optimize\n");
+	printf("(-/+)Z2\t Fuse common instruction sequences when interpreting\n");
+	printf("(-/+)vf\t Verify programs and skip the runtime checks verification makes redundant\n");
 	printf("(-/+)i\t Interpret after compiling\n");
-	printf("(-/+)lc\t List opcodes after compiling\n");
+	printf("(-/+)lc\t List opcodes and each function's frame and stack use after compiling\n");
 	printf("(-/+)ts\t Trace the stack\n");
+	printf("(-/+)pr\t Profile executed opcode sequences\n");
+	printf("(-/+)hs\t Print heap statistics after interpreting\n");
+	printf("(-/+)bc\t Report array subscripts that keep their bounds check\n");
+	printf("(-/+)ra\t Read files opened for reading ahead on another thread\n");
 	printf("(-/+)ls\t List source code while compiling\n");	
 	printf("(-/+)se\t Suppress all errors\n");	
 	printf("(-/+)q\t Quiet compiling\n");
 	printf("(-/+)p\t Pause after each step\n");	
 	printf("(-/+)h\t Help\n");	
+	printf("+stacksize <n>\t Maximum size of the stack in integers (default %d)\n", DEFAULT_MAX_STACK_SIZE);
+	printf("+server <socket>\t Run the program once per request from a Unix socket (or - for stdin)\n");
 	printf("\n\nExample:\n\n");
 	printf("p++ +v +i -lc -ls quicksort.p++\n");
 	printf("\nWill compile quicksort.p++ and interpret with verbose mode on and no opcode or sourcecode listing\n\n");
@@ -55,10 +64,18 @@ int main(int argc, char* argv[])
 	m_options.pause = FALSE;
 	m_options.array_check_boundaries = TRUE;
 	m_options.optimize = TRUE;
+	m_options.superinstructions = TRUE;
+	m_options.verify = TRUE;
+	m_options.profile_opcodes = FALSE;
+	m_options.heap_statistics = FALSE;
+	m_options.report_bounds_checks = FALSE;
+	m_options.read_ahead = FALSE;
 	m_options.quiet = TRUE;
 	m_options.source_path[0] = 0;
 	m_options.command_line[0] = 0;
+	m_options.server_address[0] = 0;
 	m_options.write_binary = FALSE;	
+	m_options.max_stack_size = DEFAULT_MAX_STACK_SIZE;
 	
 	for (i = 1; i < argc - 1; i++)
 	{
@@ -94,6 +111,22 @@ int main(int argc, char* argv[])
 		{
 			m_options.optimize = FALSE;
 		}
+		else if (strcmp(argv[i], "+Z2") == 0)
+		{
+			m_options.superinstructions = TRUE;
+		}
+		else if (strcmp(argv[i], "-Z2") == 0)
+		{
+			m_options.superinstructions = FALSE;
+		}
+		else if (strcmp(argv[i], "+vf") == 0)
+		{
+			m_options.verify = TRUE;
+		}
+		else if (strcmp(argv[i], "-vf") == 0)
+		{
+			m_options.verify = FALSE;
+		}
 		else if (strcmp(argv[i], "+lc") == 0)
 		{
 			m_options.list_opcodes = TRUE;
@@ -110,6 +143,38 @@ int main(int argc, char* argv[])
 		{
 			m_options.trace_stack = FALSE;
 		}
+		else if (strcmp(argv[i], "+pr") == 0)
+		{
+			m_options.profile_opcodes = TRUE;
+		}
+		else if (strcmp(argv[i], "-pr") == 0)
+		{
+			m_options.profile_opcodes = FALSE;
+		}
+		else if (strcmp(argv[i], "+hs") == 0)
+		{
+			m_options.heap_statistics = TRUE;
+		}
+		else if (strcmp(argv[i], "-hs") == 0)
+		{
+			m_options.heap_statistics = FALSE;
+		}
+		else if (strcmp(argv[i], "+bc") == 0)
+		{
+			m_options.report_bounds_checks = TRUE;
+		}
+		else if (strcmp(argv[i], "-bc") == 0)
+		{
+			m_options.report_bounds_checks = FALSE;
+		}
+		else if (strcmp(argv[i], "+ra") == 0)
+		{
+			m_options.read_ahead = TRUE;
+		}
+		else if (strcmp(argv[i], "-ra") == 0)
+		{
+			m_options.read_ahead = FALSE;
+		}
 		else if (strcmp(argv[i], "+ls") == 0)
 		{
 			m_options.list_source = TRUE;
@@ -163,6 +228,31 @@ int main(int argc, char* argv[])
 				i++;
 			}
 		}
+		else if (strcmp(argv[i], "+server") == 0)
+		{
+			if (i < argc - 1)
+			{
+				strncpy(m_options.server_address, argv[i + 1], sizeof(m_options.server_address) - 1);
+
+				i++;
+			}
+		}
+		else if (strcmp(argv[i], "+stacksize") == 0)
+		{
+			if (i < argc - 1)
+			{
+				m_options.max_stack_size = atoi(argv[i + 1]);
+
+				if (m_options.max_stack_size < 0x100)
+				{
+					printf("Invalid stack size [%s]\n", argv[i + 1]);
+
+					m_options.max_stack_size = DEFAULT_MAX_STACK_SIZE;
+				}
+
+				i++;
+			}
+		}
 		else if (strchr(argv[i], '-') == argv[i] || strchr(argv[i], '+') == argv[i])
 		{
 			printf("Unknown option [%s]\n", argv[i]);
@@ -246,6 +336,8 @@ int main(int argc, char* argv[])
 	{
 		print_out_code(m_compiler_results.instructions, m_compiler_results.opcodes_generated);
 		printf("\n");	
+		print_out_functions(&m_compiler_results);
+		printf("\n");
 	}
 
 	if (m_options.interpret)
@@ -265,7 +357,14 @@ int main(int argc, char* argv[])
 			}
 		}
 
-		interpret(m_compiler_results.instructions);
+		if (m_options.server_address[0])
+		{
+			interpret_server(m_compiler_results.instructions, m_compiler_results.opcodes_generated, m_options.server_address);
+		}
+		else
+		{
+			interpret(m_compiler_results.instructions, m_compiler_results.opcodes_generated);
+		}
 
 		if (!m_options.quiet)
 		{
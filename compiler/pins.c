@@ -0,0 +1,300 @@
+/*
+ * @file pins.c
+ *
+ * @description
+ *
+ * Reading and writing .pins binary images.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "types.h"
+#include "pins.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * Rounds an offset up so the section that starts there is aligned for
+ * 64 bit constants.
+ */
+#define PINS_ALIGN(x)			(((x) + 7) & ~7)
+
+/*
+ * Returns TRUE if an operand can be stored in an instruction rather than
+ * the constant pool.
+ */
+static BOOL pins_narrow(LONGLONG a)
+{
+	return (LONGLONG)(int)a == a;
+}
+
+/*
+ * Writes a compiled program out as a .pins image.  The whole image is
+ * built in memory and written with a single fwrite.
+ */
+BOOL pins_write(const char *path, compiler_results_t *results)
+{
+	int i, size, constants_num;
+	char *image;
+	FILE *pf;
+	pins_header_t *header_p;
+	pins_instruction_t *instruction_p;
+	long long *constant_p;
+
+	constants_num = 0;
+
+	for (i = 0; i < results->opcodes_generated; i++)
+	{
+		if (results->instructions[i].f < 0 || (results->instructions[i].f & PINS_WIDE_OPERAND))
+		{
+			return FALSE;
+		}
+
+		if (!pins_narrow(results->instructions[i].a))
+		{
+			constants_num++;
+		}
+	}
+
+	size = sizeof(pins_header_t);
+
+	size = PINS_ALIGN(size + results->opcodes_generated * (int)sizeof(pins_instruction_t));
+	size += constants_num * sizeof(long long);
+	size += results->symbols_num * sizeof(function_symbol_t);
+	size += results->symbol_names_size;
+
+	image = calloc(1, size);
+
+	if (!image)
+	{
+		return FALSE;
+	}
+
+	header_p = (pins_header_t *)image;
+
+	memcpy(header_p->magic, PINS_MAGIC, sizeof(header_p->magic));
+	header_p->version = PINS_VERSION;
+
+	header_p->instructions_offset = sizeof(pins_header_t);
+	header_p->instructions_num = results->opcodes_generated;
+
+	header_p->constants_offset = PINS_ALIGN(header_p->instructions_offset
+		+ header_p->instructions_num * (int)sizeof(pins_instruction_t));
+	header_p->constants_num = constants_num;
+
+	header_p->symbols_offset = header_p->constants_offset + constants_num * sizeof(long long);
+	header_p->symbols_num = results->symbols_num;
+
+	header_p->names_offset = header_p->symbols_offset + results->symbols_num * sizeof(function_symbol_t);
+	header_p->names_size = results->symbol_names_size;
+
+	instruction_p = (pins_instruction_t *)(image + header_p->instructions_offset);
+	constant_p = (long long *)(image + header_p->constants_offset);
+
+	constants_num = 0;
+
+	for (i = 0; i < results->opcodes_generated; i++)
+	{
+		instruction_p[i].f = results->instructions[i].f;
+		instruction_p[i].l = results->instructions[i].l;
+
+		if (pins_narrow(results->instructions[i].a))
+		{
+			instruction_p[i].a = (int)results->instructions[i].a;
+		}
+		else
+		{
+			instruction_p[i].f |= PINS_WIDE_OPERAND;
+			instruction_p[i].a = constants_num;
+
+			constant_p[constants_num++] = results->instructions[i].a;
+		}
+	}
+
+	memcpy(image + header_p->symbols_offset, results->symbols, results->symbols_num * sizeof(function_symbol_t));
+	memcpy(image + header_p->names_offset, results->symbol_names, results->symbol_names_size);
+
+	pf = fopen(path, "w+b");
+
+	if (!pf)
+	{
+		free(image);
+
+		return FALSE;
+	}
+
+	i = fwrite(image, size, 1, pf) == 1;
+
+	fclose(pf);
+	free(image);
+
+	return i;
+}
+
+/*
+ * Checks that a section lies inside the image.
+ */
+static BOOL pins_section_valid(int offset, int num, int element_size, int size)
+{
+	return offset >= (int)sizeof(pins_header_t) && num >= 0 && offset <= size
+		&& num <= (size - offset) / element_size;
+}
+
+/*
+ * Loads a .pins image into the instruction, symbol and name buffers
+ * results points at (which must be able to hold MAX_INSTRUCTIONS,
+ * MAX_FUNCTION_SYMBOLS and MAX_SYMBOL_NAMES respectively).  The file is
+ * mapped and each section is checked against the file size before it's
+ * copied out, so a truncated or corrupt image is rejected rather than
+ * producing bogus instructions.
+ */
+BOOL pins_read(const char *path, compiler_results_t *results)
+{
+	int i, size, f;
+	char *image;
+	BOOL valid;
+	pins_header_t *header_p;
+	pins_instruction_t *instruction_p;
+	long long *constant_p;
+#ifdef _WIN32
+	FILE *pf;
+#else
+	int fd;
+	struct stat st;
+#endif
+
+#ifdef _WIN32
+	pf = fopen(path, "rb");
+
+	if (!pf)
+	{
+		return FALSE;
+	}
+
+	fseek(pf, 0, SEEK_END);
+	size = ftell(pf);
+	fseek(pf, 0, SEEK_SET);
+
+	image = size > 0 ? malloc(size) : NULL;
+
+	if (image && fread(image, size, 1, pf) != 1)
+	{
+		free(image);
+		image = NULL;
+	}
+
+	fclose(pf);
+#else
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return FALSE;
+	}
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size > 0x7FFFFFFF)
+	{
+		close(fd);
+
+		return FALSE;
+	}
+
+	size = (int)st.st_size;
+
+	image = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+
+	if (image == MAP_FAILED)
+	{
+		image = NULL;
+	}
+
+	close(fd);
+#endif
+
+	if (!image)
+	{
+		return FALSE;
+	}
+
+	header_p = (pins_header_t *)image;
+
+	valid = size >= (int)sizeof(pins_header_t)
+		&& !memcmp(header_p->magic, PINS_MAGIC, sizeof(header_p->magic))
+		&& header_p->version == PINS_VERSION
+		&& header_p->instructions_num <= MAX_INSTRUCTIONS
+		&& header_p->symbols_num <= MAX_FUNCTION_SYMBOLS
+		&& header_p->names_size <= MAX_SYMBOL_NAMES
+		&& (header_p->symbols_num == 0 || header_p->names_size > 0)
+		&& !(header_p->constants_offset & 7)
+		&& pins_section_valid(header_p->instructions_offset, header_p->instructions_num, sizeof(pins_instruction_t), size)
+		&& pins_section_valid(header_p->constants_offset, header_p->constants_num, sizeof(long long), size)
+		&& pins_section_valid(header_p->symbols_offset, header_p->symbols_num, sizeof(function_symbol_t), size)
+		&& pins_section_valid(header_p->names_offset, header_p->names_size, 1, size);
+
+	if (valid)
+	{
+		instruction_p = (pins_instruction_t *)(image + header_p->instructions_offset);
+		constant_p = (long long *)(image + header_p->constants_offset);
+
+		for (i = 0; i < header_p->instructions_num && valid; i++)
+		{
+			f = instruction_p[i].f;
+
+			results->instructions[i].l = instruction_p[i].l;
+
+			if (f & PINS_WIDE_OPERAND)
+			{
+				valid = instruction_p[i].a >= 0 && instruction_p[i].a < header_p->constants_num;
+
+				if (valid)
+				{
+					results->instructions[i].a = (LONGLONG)constant_p[instruction_p[i].a];
+				}
+
+				f &= ~PINS_WIDE_OPERAND;
+			}
+			else
+			{
+				results->instructions[i].a = instruction_p[i].a;
+			}
+
+			results->instructions[i].f = f;
+		}
+	}
+
+	if (valid)
+	{
+		memcpy(results->symbols, image + header_p->symbols_offset, header_p->symbols_num * sizeof(function_symbol_t));
+		memcpy(results->symbol_names, image + header_p->names_offset, header_p->names_size);
+
+		results->opcodes_generated = header_p->instructions_num;
+		results->symbols_num = header_p->symbols_num;
+		results->symbol_names_size = header_p->names_size;
+
+		for (i = 0; i < results->symbols_num; i++)
+		{
+			if (results->symbols[i].name < 0 || results->symbols[i].name >= results->symbol_names_size)
+			{
+				results->symbols[i].name = 0;
+			}
+		}
+
+		if (results->symbol_names_size > 0)
+		{
+			results->symbol_names[results->symbol_names_size - 1] = 0;
+		}
+	}
+
+#ifdef _WIN32
+	free(image);
+#else
+	munmap(image, size);
+#endif
+
+	return valid;
+}
@@ -0,0 +1,66 @@
+/*
+ * @file pins.h
+ *
+ * @description
+ *
+ * Binary image format for compiled programs (.pins files).
+ *
+ * A .pins file is laid out the way the loader wants it in memory so it can
+ * be mapped and copied out section by section rather than parsed:
+ *
+ *   header			magic ("PINS"), version and the offset and length of
+ *					every section
+ *   instructions	packed 12 byte instructions (f, l, a)
+ *   constants		64 bit operands that don't fit in an instruction's a
+ *   symbols		function names, their code addresses and the most stack
+ *					they use
+ *   names			NUL terminated symbol names
+ *
+ * An instruction whose operand doesn't fit in 32 bits has PINS_WIDE_OPERAND
+ * set in f and its a is an index into the constant pool.  Everything is
+ * stored in the byte order of the machine that wrote it (a file from a
+ * machine with the other byte order fails the version check).
+ */
+
+#ifndef __PINS_H
+#define __PINS_H
+
+#include "compiler.h"
+
+#define PINS_MAGIC				"PINS"
+#define PINS_VERSION			2
+
+/*
+ * Set in an instruction's f when its operand is in the constant pool.
+ */
+#define PINS_WIDE_OPERAND		0x40000000
+
+typedef struct tag_pins_header pins_header_t;
+typedef struct tag_pins_instruction pins_instruction_t;
+
+struct tag_pins_header
+{
+	char magic[4];
+	int version;
+
+	int instructions_offset;
+	int instructions_num;
+	int constants_offset;
+	int constants_num;
+	int symbols_offset;
+	int symbols_num;
+	int names_offset;
+	int names_size;
+};
+
+struct tag_pins_instruction
+{
+	int f;
+	int l;
+	int a;
+};
+
+BOOL pins_write(const char *path, compiler_results_t *results);
+BOOL pins_read(const char *path, compiler_results_t *results);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * @file profiler.c
+ *
+ * @description
+ *
+ * Opcode n-gram profiler.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "types.h"
+#include "decoder.h"
+#include "profiler.h"
+
+/*
+ * Number of slots in the n-gram table (must be a power of 2).
+ */
+#define PROFILE_TABLE_SIZE		0x4000
+
+/*
+ * Each opcode takes 8 bits of an n-gram's packed opcodes.
+ */
+#define PROFILE_OP_BITS			8
+
+typedef struct tag_profile_entry profile_entry_t;
+
+struct tag_profile_entry
+{
+	/*
+	 * Length of the n-gram (0 for an unused entry).
+	 */
+	int n;
+	unsigned int ops;
+	double count;
+};
+
+static profile_entry_t m_profile_table[PROFILE_TABLE_SIZE];
+
+/*
+ * The last few instructions executed in sequence (packed opcodes).
+ */
+static unsigned int m_profile_window;
+static int m_profile_window_length;
+static int m_profile_last_address;
+
+static double m_profile_instructions;
+static int m_profile_overflow;
+
+void profile_reset()
+{
+	memset(m_profile_table, 0, sizeof(m_profile_table));
+
+	m_profile_window = 0;
+	m_profile_window_length = 0;
+	m_profile_last_address = -1;
+	m_profile_instructions = 0;
+	m_profile_overflow = 0;
+}
+
+/*
+ * Adds one to the count of an n-gram.
+ */
+static void profile_count(int n, unsigned int ops)
+{
+	unsigned int i;
+
+	i = ((ops + n) * 2654435761u) & (PROFILE_TABLE_SIZE - 1);
+
+	while (m_profile_table[i].n != 0 && (m_profile_table[i].n != n || m_profile_table[i].ops != ops))
+	{
+		i = (i + 1) & (PROFILE_TABLE_SIZE - 1);
+	}
+
+	if (m_profile_table[i].n == 0)
+	{
+		/*
+		 * Always leave some room so that lookups terminate.
+		 */
+		if (m_profile_overflow >= PROFILE_TABLE_SIZE - PROFILE_TABLE_SIZE / 4)
+		{
+			return;
+		}
+
+		m_profile_overflow++;
+		m_profile_table[i].n = n;
+		m_profile_table[i].ops = ops;
+	}
+
+	m_profile_table[i].count++;
+}
+
+/*
+ * Records the execution of the instruction at an address.
+ */
+void profile_record(int address, int op)
+{
+	int n;
+	unsigned int mask;
+
+	m_profile_instructions++;
+
+	/*
+	 * Only instructions that follow each other in the instruction stream
+	 * form a sequence (a fused instruction can't span a jump).
+	 */
+	if (address != m_profile_last_address + 1)
+	{
+		m_profile_window_length = 0;
+		m_profile_window = 0;
+	}
+
+	m_profile_last_address = address;
+
+	m_profile_window = (m_profile_window << PROFILE_OP_BITS) | (unsigned int)op;
+
+	if (m_profile_window_length < PROFILE_MAX_GRAM)
+	{
+		m_profile_window_length++;
+	}
+
+	for (n = 1; n <= m_profile_window_length; n++)
+	{
+		mask = n < PROFILE_MAX_GRAM ? (1u << (PROFILE_OP_BITS * n)) - 1 : ~0u;
+
+		profile_count(n, m_profile_window & mask);
+	}
+}
+
+static int profile_compare(const void *a, const void *b)
+{
+	const profile_entry_t *e1 = (const profile_entry_t*)a;
+	const profile_entry_t *e2 = (const profile_entry_t*)b;
+
+	if (e1->count != e2->count)
+	{
+		return e1->count < e2->count ? 1 : -1;
+	}
+
+	return e1->ops < e2->ops ? -1 : e1->ops > e2->ops;
+}
+
+/*
+ * Prints the hottest n-grams of each length.
+ */
+void profile_print()
+{
+	int i, j, n, printed;
+	unsigned int ops;
+	profile_entry_t *sorted_p;
+
+	sorted_p = (profile_entry_t*)malloc(sizeof(m_profile_table));
+
+	if (!sorted_p)
+	{
+		return;
+	}
+
+	memcpy(sorted_p, m_profile_table, sizeof(m_profile_table));
+	qsort(sorted_p, PROFILE_TABLE_SIZE, sizeof(profile_entry_t), profile_compare);
+
+	printf("\n--------------------------------------------------------------------------------\n");
+	printf("Opcode profile: %.0f instructions executed.\n", m_profile_instructions);
+
+	for (n = 1; n <= PROFILE_MAX_GRAM; n++)
+	{
+		printf("\n%d-grams:\n", n);
+
+		printed = 0;
+
+		for (i = 0; i < PROFILE_TABLE_SIZE && printed < PROFILE_TOP_COUNT; i++)
+		{
+			if (sorted_p[i].n != n)
+			{
+				continue;
+			}
+
+			ops = sorted_p[i].ops;
+
+			printf("%12.0f %5.1f%% ", sorted_p[i].count, 100 * sorted_p[i].count / m_profile_instructions);
+
+			for (j = n - 1; j >= 0; j--)
+			{
+				printf(" %s", decoded_opcode_name((ops >> (PROFILE_OP_BITS * j)) & ((1 << PROFILE_OP_BITS) - 1)));
+			}
+
+			printf("\n");
+
+			printed++;
+		}
+	}
+
+	printf("--------------------------------------------------------------------------------\n");
+
+	free(sorted_p);
+}
@@ -0,0 +1,33 @@
+/*
+ * @file profiler.h
+ *
+ * @description
+ *
+ * Opcode n-gram profiler.
+ *
+ * When profiling is enabled (+pr) the interpretor reports every internal
+ * instruction it executes.  Runs of instructions that execute one after
+ * the other in the instruction stream are counted as n-grams (up to
+ * PROFILE_MAX_GRAM long) and the hottest ones are printed when the
+ * program finishes.  This is what the decoder's superinstructions are
+ * chosen from.
+ */
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+/*
+ * Longest sequence of instructions that is counted.
+ */
+#define PROFILE_MAX_GRAM		4
+
+/*
+ * How many of the hottest sequences of each length are printed.
+ */
+#define PROFILE_TOP_COUNT		15
+
+void profile_reset();
+void profile_record(int address, int op);
+void profile_print();
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ * @file readahead.c
+ *
+ * @description
+ *
+ * Double buffered read ahead streams.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "readahead.h"
+
+#if defined(__GLIBC__) && !defined(NO_READ_AHEAD)
+
+#include <pthread.h>
+
+/*
+ * Size (in bytes) of the stdio buffer on the stream handed to the
+ * interpretor (it's refilled from the read ahead buffers).
+ */
+#define READ_AHEAD_STREAM_BUFFER_SIZE	0x10000
+
+typedef struct tag_read_ahead read_ahead_t;
+
+struct tag_read_ahead
+{
+	FILE *file;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	char *buffers[2];
+
+	/*
+	 * Number of bytes in each buffer or -1 if it's waiting to be filled
+	 * (a full buffer with 0 bytes marks the end of the file).
+	 */
+	int lengths[2];
+
+	/*
+	 * The buffer being consumed and how far into it the reader is.
+	 */
+	int current;
+	int position;
+
+	/*
+	 * Set when the stream is closed.
+	 */
+	int stop;
+};
+
+/*
+ * Helper thread that fills whichever buffer is empty.
+ */
+static void *read_ahead_thread(void *arg)
+{
+	int next, len;
+	read_ahead_t *ra_p = arg;
+
+	next = 0;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&ra_p->lock);
+
+		while (ra_p->lengths[next] >= 0 && !ra_p->stop)
+		{
+			pthread_cond_wait(&ra_p->cond, &ra_p->lock);
+		}
+
+		if (ra_p->stop)
+		{
+			pthread_mutex_unlock(&ra_p->lock);
+
+			break;
+		}
+
+		pthread_mutex_unlock(&ra_p->lock);
+
+		/*
+		 * The buffer belongs to this thread until its length is set.
+		 */
+		len = fread(ra_p->buffers[next], 1, READ_AHEAD_BUFFER_SIZE, ra_p->file);
+
+		pthread_mutex_lock(&ra_p->lock);
+		ra_p->lengths[next] = len;
+		pthread_cond_broadcast(&ra_p->cond);
+		pthread_mutex_unlock(&ra_p->lock);
+
+		if (len == 0)
+		{
+			break;
+		}
+
+		next ^= 1;
+	}
+
+	return NULL;
+}
+
+static ssize_t read_ahead_read(void *cookie, char *buffer, size_t size)
+{
+	int len;
+	read_ahead_t *ra_p = cookie;
+
+	pthread_mutex_lock(&ra_p->lock);
+
+	while (ra_p->lengths[ra_p->current] < 0)
+	{
+		pthread_cond_wait(&ra_p->cond, &ra_p->lock);
+	}
+
+	pthread_mutex_unlock(&ra_p->lock);
+
+	len = ra_p->lengths[ra_p->current] - ra_p->position;
+
+	if (len <= 0)
+	{
+		/*
+		 * End of the file (the buffer is left full so every read after
+		 * this one sees the end too).
+		 */
+		return 0;
+	}
+
+	if ((size_t)len > size)
+	{
+		len = size;
+	}
+
+	memcpy(buffer, ra_p->buffers[ra_p->current] + ra_p->position, len);
+
+	ra_p->position += len;
+
+	if (ra_p->position == ra_p->lengths[ra_p->current])
+	{
+		/*
+		 * Hand the buffer back to the helper thread and move on to the
+		 * other one.
+		 */
+		pthread_mutex_lock(&ra_p->lock);
+		ra_p->lengths[ra_p->current] = -1;
+		pthread_cond_broadcast(&ra_p->cond);
+		pthread_mutex_unlock(&ra_p->lock);
+
+		ra_p->current ^= 1;
+		ra_p->position = 0;
+	}
+
+	return len;
+}
+
+static int read_ahead_close(void *cookie)
+{
+	int retval;
+	read_ahead_t *ra_p = cookie;
+
+	pthread_mutex_lock(&ra_p->lock);
+	ra_p->stop = 1;
+	pthread_cond_broadcast(&ra_p->cond);
+	pthread_mutex_unlock(&ra_p->lock);
+
+	pthread_join(ra_p->thread, NULL);
+
+	retval = fclose(ra_p->file);
+
+	pthread_cond_destroy(&ra_p->cond);
+	pthread_mutex_destroy(&ra_p->lock);
+
+	free(ra_p->buffers[0]);
+	free(ra_p->buffers[1]);
+	free(ra_p);
+
+	return retval;
+}
+
+/*
+ * Opens a file for reading with a helper thread reading ahead of the
+ * program.  Files opened for writing are opened normally.
+ *
+ * @returns NULL if the file couldn't be opened.
+ */
+FILE *read_ahead_open(const char *filename, const char *mode)
+{
+	FILE *file;
+	read_ahead_t *ra_p;
+	cookie_io_functions_t functions;
+
+	if (strcmp(mode, "r") != 0 && strcmp(mode, "rb") != 0 && strcmp(mode, "rt") != 0)
+	{
+		return fopen(filename, mode);
+	}
+
+	file = fopen(filename, "rb");
+
+	if (!file)
+	{
+		return NULL;
+	}
+
+	ra_p = calloc(1, sizeof(read_ahead_t));
+
+	if (ra_p)
+	{
+		ra_p->buffers[0] = malloc(READ_AHEAD_BUFFER_SIZE);
+		ra_p->buffers[1] = malloc(READ_AHEAD_BUFFER_SIZE);
+	}
+
+	if (!ra_p || !ra_p->buffers[0] || !ra_p->buffers[1])
+	{
+		if (ra_p)
+		{
+			free(ra_p->buffers[0]);
+			free(ra_p->buffers[1]);
+			free(ra_p);
+		}
+
+		return file;
+	}
+
+	ra_p->file = file;
+	ra_p->lengths[0] = -1;
+	ra_p->lengths[1] = -1;
+
+	/*
+	 * The helper thread does its own buffering.
+	 */
+	setvbuf(file, NULL, _IONBF, 0);
+
+	pthread_mutex_init(&ra_p->lock, NULL);
+	pthread_cond_init(&ra_p->cond, NULL);
+
+	if (pthread_create(&ra_p->thread, NULL, read_ahead_thread, ra_p) != 0)
+	{
+		pthread_cond_destroy(&ra_p->cond);
+		pthread_mutex_destroy(&ra_p->lock);
+
+		free(ra_p->buffers[0]);
+		free(ra_p->buffers[1]);
+		free(ra_p);
+
+		setvbuf(file, NULL, _IOFBF, BUFSIZ);
+
+		return file;
+	}
+
+	functions.read = read_ahead_read;
+	functions.write = NULL;
+	functions.seek = NULL;
+	functions.close = read_ahead_close;
+
+	file = fopencookie(ra_p, "r", functions);
+
+	if (!file)
+	{
+		read_ahead_close(ra_p);
+
+		return NULL;
+	}
+
+	setvbuf(file, NULL, _IOFBF, READ_AHEAD_STREAM_BUFFER_SIZE);
+
+	return file;
+}
+
+#else
+
+FILE *read_ahead_open(const char *filename, const char *mode)
+{
+	return fopen(filename, mode);
+}
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * @file readahead.h
+ *
+ * @description
+ *
+ * Read ahead streams for files opened with F_READ_AHEAD (or everything
+ * opened for reading when the +ra option is given).
+ *
+ * A helper thread reads the file into one of two buffers while the
+ * interpretor consumes the other, so the program doesn't sit waiting on
+ * the disk between reads.  The stream is handed back as an ordinary FILE
+ * so the stream opcodes don't need to know about it.
+ *
+ * Read ahead needs fopencookie and POSIX threads.  Everywhere else the file
+ * is just opened normally.
+ */
+
+#ifndef __READAHEAD_H
+#define __READAHEAD_H
+
+#include "stdio.h"
+
+/*
+ * Size (in bytes) of each of a stream's two buffers.
+ */
+#define READ_AHEAD_BUFFER_SIZE	0x100000
+
+FILE *read_ahead_open(const char *filename, const char *mode);
+
+#endif
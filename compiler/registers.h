@@ -4,5 +4,7 @@
 #define REG_DX			4
 #define REG_EX			5
 
+#define NUMBER_OF_REGISTERS	6
+
 #define REG_FLOAT_FLAG	0x1
 #define REG_MEMORY_FLAG	0x4
\ No newline at end of file
@@ -0,0 +1,341 @@
+/*
+ * @file server.c
+ *
+ * @description
+ *
+ * Request framing and transport for server mode.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "server.h"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ * Largest environment block or stdin a request can carry.
+ */
+#define SERVER_MAX_REQUEST_SIZE		0x4000000
+
+static int m_listen_fd = -1;
+
+/*
+ * Where the current request came from and where its response goes.
+ */
+static FILE *m_request_in;
+static FILE *m_request_out;
+
+/*
+ * The process's own stdin and stdout (swapped out while a request runs).
+ */
+static FILE *m_stdin;
+static FILE *m_stdout;
+
+static char *m_request_stdin;
+static char *m_response;
+static size_t m_response_size;
+
+/*
+ * Reads a "<n>\n" framed block.
+ *
+ * @returns The block (NUL terminated) or NULL at the end of the input or
+ * on a malformed frame.
+ */
+static char *read_frame(FILE *file, int *len_p)
+{
+	int c, len;
+	char *block_p;
+
+	len = 0;
+
+	while ((c = getc(file)) != '\n')
+	{
+		if (c < '0' || c > '9' || len > SERVER_MAX_REQUEST_SIZE / 10)
+		{
+			return NULL;
+		}
+
+		len = len * 10 + c - '0';
+	}
+
+	if (len > SERVER_MAX_REQUEST_SIZE)
+	{
+		return NULL;
+	}
+
+	block_p = malloc(len + 1);
+
+	if (!block_p)
+	{
+		return NULL;
+	}
+
+	if ((int)fread(block_p, 1, len, file) != len)
+	{
+		free(block_p);
+
+		return NULL;
+	}
+
+	block_p[len] = 0;
+	*len_p = len;
+
+	return block_p;
+}
+
+/*
+ * Replaces the process's environment with a request's.
+ */
+static void set_environment(char *env_p, int len)
+{
+	char *end_p, *value_p;
+
+	clearenv();
+
+	end_p = env_p + len;
+
+	while (env_p < end_p)
+	{
+		value_p = strchr(env_p, '=');
+
+		if (value_p)
+		{
+			*value_p = 0;
+			setenv(env_p, value_p + 1, 1);
+			*value_p = '=';
+		}
+
+		env_p += strlen(env_p) + 1;
+	}
+}
+
+/*
+ * Starts listening for requests.
+ *
+ * @param address	Path of the Unix socket to listen on or "-" to read
+ *					requests from stdin.  A socket left at the path
+ *					by an earlier server is removed, anything else
+ *					there is an error.
+ *
+ * @returns 0 on error.
+ */
+int server_open(const char *address)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+
+	m_stdin = stdin;
+	m_stdout = stdout;
+
+	if (strcmp(address, "-") == 0)
+	{
+		return 1;
+	}
+
+	if (strlen(address) >= sizeof(addr.sun_path))
+	{
+		printf("*ERROR* Socket path too long [%s].\n", address);
+
+		return 0;
+	}
+
+	if (lstat(address, &st) == 0)
+	{
+		if (!S_ISSOCK(st.st_mode))
+		{
+			printf("*ERROR* [%s] exists and is not a socket.\n", address);
+
+			return 0;
+		}
+
+		unlink(address);
+	}
+
+	m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (m_listen_fd < 0)
+	{
+		printf("*ERROR* Unable to create socket.\n");
+
+		return 0;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, address);
+
+	/*
+	 * A client going away shouldn't take the server with it.
+	 */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (bind(m_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(m_listen_fd, 16) < 0)
+	{
+		printf("*ERROR* Unable to listen on [%s].\n", address);
+
+		close(m_listen_fd);
+		m_listen_fd = -1;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+void server_close()
+{
+	if (m_listen_fd >= 0)
+	{
+		close(m_listen_fd);
+		m_listen_fd = -1;
+	}
+}
+
+/*
+ * Waits for the next request and makes its environment, stdin and stdout
+ * the process's.
+ *
+ * @returns 0 when there are no more requests.
+ */
+int server_begin_request()
+{
+	int fd, env_len, stdin_len;
+	char *env_p;
+
+	for (;;)
+	{
+		if (m_listen_fd >= 0)
+		{
+			fd = accept(m_listen_fd, NULL, NULL);
+
+			if (fd < 0)
+			{
+				return 0;
+			}
+
+			m_request_in = fdopen(fd, "r+");
+
+			if (!m_request_in)
+			{
+				close(fd);
+
+				continue;
+			}
+
+			m_request_out = m_request_in;
+		}
+		else
+		{
+			m_request_in = m_stdin;
+			m_request_out = m_stdout;
+		}
+
+		env_p = read_frame(m_request_in, &env_len);
+		m_request_stdin = env_p ? read_frame(m_request_in, &stdin_len) : NULL;
+
+		if (m_request_stdin)
+		{
+			break;
+		}
+
+		free(env_p);
+
+		if (m_listen_fd < 0)
+		{
+			return 0;
+		}
+
+		/*
+		 * Drop malformed requests.
+		 */
+		fclose(m_request_in);
+	}
+
+	set_environment(env_p, env_len);
+	free(env_p);
+
+	stdin = fmemopen(m_request_stdin, stdin_len, "r");
+
+	m_response = NULL;
+	m_response_size = 0;
+	stdout = open_memstream(&m_response, &m_response_size);
+
+	if (!stdin || !stdout)
+	{
+		printf("*ERROR* Out of memory for the request.\n");
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Sends the response to the current request and restores the process's
+ * stdin and stdout.
+ *
+ * @returns 0 if the response couldn't be sent.
+ */
+int server_end_request()
+{
+	int result;
+
+	fclose(stdin);
+	fclose(stdout);
+
+	stdin = m_stdin;
+	stdout = m_stdout;
+
+	free(m_request_stdin);
+	m_request_stdin = NULL;
+
+	result = fprintf(m_request_out, "%d\n", (int)m_response_size) > 0
+		&& fwrite(m_response, 1, m_response_size, m_request_out) == m_response_size
+		&& fflush(m_request_out) == 0;
+
+	free(m_response);
+	m_response = NULL;
+
+	if (m_listen_fd >= 0)
+	{
+		fclose(m_request_in);
+	}
+
+	return result;
+}
+
+#else
+
+int server_open(const char *address)
+{
+	printf("*ERROR* Server mode isn't supported on this platform.\n");
+
+	return 0;
+}
+
+void server_close()
+{
+}
+
+int server_begin_request()
+{
+	return 0;
+}
+
+int server_end_request()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * @file server.h
+ *
+ * @description
+ *
+ * Server mode (+server).  The program is compiled and decoded once and then
+ * run once per request, with the request's environment, stdin and stdout.
+ *
+ * Requests come from a Unix socket (one request per connection) or, if the
+ * address is "-", one after the other on stdin.  Both use the same framing:
+ *
+ *   request:	<n>\n <n bytes of NAME=VALUE\0 environment entries>
+ *				<m>\n <m bytes of stdin>
+ *   response:	<k>\n <k bytes of stdout>
+ *
+ * The interpretor's stack, heap and memory handles are rebuilt for every
+ * request so nothing leaks from one request to the next.
+ */
+
+#ifndef __SERVER_H
+#define __SERVER_H
+
+int server_open(const char *address);
+void server_close();
+int server_begin_request();
+int server_end_request();
+
+#endif
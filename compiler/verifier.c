@@ -0,0 +1,610 @@
+/*
+ * @file verifier.c
+ *
+ * @description
+ *
+ * Verifies decoded instruction streams before they're run.
+ */
+
+#include "stdlib.h"
+#include "string.h"
+#include "types.h"
+#include "symbols.h"
+#include "verifier.h"
+
+/*
+ * Depth of an instruction that hasn't been reached yet.
+ */
+#define UNREACHED		-1
+
+/*
+ * Returns how much an instruction changes the stack depth by.  reach_p
+ * is set to how far above the top of the stack the instruction writes
+ * (the parameters and links of a call are written there before the
+ * callee's entry reserves its frame).
+ */
+static int stack_effect(const decoded_instruction_t *ip, int *reach_p)
+{
+	*reach_p = 0;
+
+	switch (ip->op)
+	{
+	case IOP_LIT: case IOP_LOD: case IOP_LID: case IOP_LDA:
+	case IOP_MLO: case IOP_MLI: case IOP_MLS: case IOP_SLD:
+	case IOP_LRV: case IOP_PUS: case IOP_TME: case IOP_CLK:
+	case IOP_HNW:
+
+		return 1;
+
+	case IOP_CLI:
+
+		return 2;
+
+	case IOP_LIS:
+
+		return ip->l;
+
+	case IOP_INC:
+	case IOP_ENTER:
+
+		return ip->a;
+
+	case IOP_DEC:
+
+		return -ip->a;
+
+	case IOP_STP:
+
+		*reach_p = ip->a;
+
+		return -1;
+
+	case IOP_CAL:
+	case IOP_CAI:
+	case IOP_CII:
+
+		/*
+		 * The callee returns with the stack where it was.
+		 */
+		*reach_p = 3;
+
+		return 0;
+
+	case IOP_CAS:
+
+		*reach_p = 2;
+
+		return -1;
+
+	case IOP_STO: case IOP_SID: case IOP_MST: case IOP_MSI:
+	case IOP_MSS: case IOP_SRV: case IOP_POP: case IOP_JPC:
+	case IOP_ARF: case IOP_RLS: case IOP_ACK:
+	case IOP_FCF: case IOP_RDB: case IOP_ENV: case IOP_FMP:
+	case IOP_HFR: case IOP_HRM:
+	case IOP_ISL: case IOP_ISR: case IOP_IAD: case IOP_ISU: case IOP_IMU:
+	case IOP_IDI: case IOP_IXO: case IOP_IOR: case IOP_IAN:
+	case IOP_IZL: case IOP_IZR: case IOP_IIA: case IOP_IIS: case IOP_IIM:
+	case IOP_IID: case IOP_IIX: case IOP_IIO: case IOP_IIB:
+	case IOP_ADD_I: case IOP_SUB_I: case IOP_MUL_I: case IOP_DIV_I:
+	case IOP_MOD_I: case IOP_EQL_I: case IOP_NEQ_I: case IOP_LES_I:
+	case IOP_LEQ_I: case IOP_GRE_I: case IOP_GRQ_I: case IOP_SHL_I:
+	case IOP_SHR_I: case IOP_BOR_I: case IOP_AND_I: case IOP_XOR_I:
+	case IOP_ADD_F: case IOP_SUB_F: case IOP_MUL_F: case IOP_DIV_F:
+	case IOP_EQL_F: case IOP_NEQ_F: case IOP_LES_F: case IOP_LEQ_F:
+	case IOP_GRE_F: case IOP_GRQ_F:
+
+		return -1;
+
+	case IOP_RAL: case IOP_WRT: case IOP_WRF: case IOP_WRB: case IOP_FOF:
+	case IOP_HGT: case IOP_SLC:
+
+		return -2;
+
+	case IOP_HPT:
+
+		return -3;
+
+	case IOP_WRA:
+
+		return -4;
+
+	case IOP_MCP:
+
+		return -5;
+	}
+
+	/*
+	 * NOP, SWS, PAS, MOV, RIO, SRG, NOT_I, ODD_I, NEG_I, INT_F, FLO_F,
+	 * NEG_F, MAL, FRE, MSZ, RLM, REB, RCH, DEB, RDL, RDA, EOF, HCT, JMP.
+	 */
+	return 0;
+}
+
+/*
+ * Checks an instruction's register and level operands.
+ */
+static const char *check_operands(const decoded_instruction_t *ip)
+{
+	switch (ip->op)
+	{
+	case IOP_PAS: case IOP_POP: case IOP_PUS:
+
+		if (ip->a < 0 || ip->a >= NUMBER_OF_REGISTERS)
+		{
+			return "invalid register";
+		}
+
+		break;
+
+	case IOP_MOV:
+
+		if (ip->a < 0 || ip->a >= NUMBER_OF_REGISTERS || ip->l < 0 || ip->l >= NUMBER_OF_REGISTERS)
+		{
+			return "invalid register";
+		}
+
+		break;
+
+	case IOP_SRG: case IOP_RIO:
+
+		/*
+		 * The decoder puts the register in l.
+		 */
+		if (ip->l < 0 || ip->l >= NUMBER_OF_REGISTERS)
+		{
+			return "invalid register";
+		}
+
+		break;
+
+	case IOP_LOD: case IOP_STO: case IOP_LID: case IOP_SID: case IOP_LDA:
+	case IOP_MLO: case IOP_MLI: case IOP_MST: case IOP_MSI:
+	case IOP_CAL: case IOP_CAI: case IOP_CII: case IOP_CAS: case IOP_TAC:
+	case IOP_ISL: case IOP_ISR: case IOP_IAD: case IOP_ISU: case IOP_IMU:
+	case IOP_IDI: case IOP_IXO: case IOP_IOR: case IOP_IAN:
+	case IOP_IZL: case IOP_IZR: case IOP_IIA: case IOP_IIS: case IOP_IIM:
+	case IOP_IID: case IOP_IIX: case IOP_IIO: case IOP_IIB:
+
+		if (ip->l < 0 || ip->l >= MAX_LEVEL)
+		{
+			return "invalid level";
+		}
+
+		break;
+
+	case IOP_INC: case IOP_ENTER: case IOP_DEC:
+
+		if (ip->a < 0 || ip->l < 0)
+		{
+			return "negative stack adjustment";
+		}
+
+		break;
+
+	case IOP_LIS:
+
+		/*
+		 * a is the value loaded, l how many times.
+		 */
+		if (ip->l < 0)
+		{
+			return "negative stack adjustment";
+		}
+
+		break;
+	}
+
+	return NULL;
+}
+
+/*
+ * Tests if an instruction leaves every memory handle and variable alone
+ * (so a handle checked before it is still good after it).
+ */
+static int keeps_handles(int op)
+{
+	switch (op)
+	{
+	case IOP_NOP: case IOP_LIT: case IOP_LOD: case IOP_LDA: case IOP_LID:
+	case IOP_MLO: case IOP_MLI: case IOP_MLS: case IOP_SLD: case IOP_SWS:
+	case IOP_PAS: case IOP_POP: case IOP_PUS: case IOP_MOV: case IOP_RIO:
+	case IOP_SRG: case IOP_ACK:
+	case IOP_NOT_I: case IOP_ADD_I: case IOP_SUB_I: case IOP_MUL_I:
+	case IOP_DIV_I: case IOP_MOD_I: case IOP_ODD_I: case IOP_NEG_I:
+	case IOP_EQL_I: case IOP_NEQ_I: case IOP_LES_I: case IOP_LEQ_I:
+	case IOP_GRE_I: case IOP_GRQ_I: case IOP_SHL_I: case IOP_SHR_I:
+	case IOP_BOR_I: case IOP_AND_I: case IOP_XOR_I:
+	case IOP_ADD_F: case IOP_SUB_F: case IOP_MUL_F: case IOP_DIV_F:
+	case IOP_EQL_F: case IOP_NEQ_F: case IOP_LES_F: case IOP_LEQ_F:
+	case IOP_GRE_F: case IOP_GRQ_F: case IOP_INT_F: case IOP_FLO_F:
+	case IOP_NEG_F:
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Finds the MLO and MST instructions whose memory handle has just been
+ * checked by an array bounds check (LOD x; ACK ... MLO/MST x) with
+ * nothing in between that can change x or free memory.  ACK lets a null
+ * handle through, so only the null test is left for these.
+ */
+static void find_checked_handles(decoded_instruction_t *code_p, int len, const char *targets_p, char *handles_checked_p)
+{
+	int i, j;
+
+	for (i = 1; i < len; i++)
+	{
+		if (code_p[i].op != IOP_ACK || code_p[i - 1].op != IOP_LOD || targets_p[i])
+		{
+			continue;
+		}
+
+		for (j = i + 1; j < len && !targets_p[j]; j++)
+		{
+			if ((code_p[j].op == IOP_MLO || code_p[j].op == IOP_MST)
+				&& code_p[j].l == code_p[i - 1].l && code_p[j].a == code_p[i - 1].a)
+			{
+				handles_checked_p[j] = 1;
+
+				break;
+			}
+
+			if (!keeps_handles(code_p[j].op))
+			{
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * State shared by the walks over each function.
+ */
+typedef struct tag_walk walk_t;
+
+struct tag_walk
+{
+	decoded_instruction_t *code_p;
+	int len;
+
+	/*
+	 * Range of stack depths each instruction can run at (relative to its
+	 * function's frame) and the entry of the function it belongs to.
+	 */
+	int *lows_p;
+	int *highs_p;
+	int *owners_p;
+
+	int *work_p;
+	char *queued_p;
+
+	/*
+	 * Set for every instruction that's jumped to.
+	 */
+	char *targets_p;
+
+	/*
+	 * FALSE when the code is a single function on its own, whose calls
+	 * go outside it and can't be checked.
+	 */
+	BOOL check_calls;
+};
+
+static BOOL walk_init(walk_t *walk_p, decoded_instruction_t *code_p, int len, BOOL check_calls)
+{
+	int i;
+
+	walk_p->code_p = code_p;
+	walk_p->len = len;
+	walk_p->check_calls = check_calls;
+
+	walk_p->lows_p = MALLOC(int, len);
+	walk_p->highs_p = MALLOC(int, len);
+	walk_p->owners_p = MALLOC(int, len);
+	walk_p->work_p = MALLOC(int, len);
+	walk_p->queued_p = CALLOC(char, len);
+	walk_p->targets_p = CALLOC(char, len + 1);
+
+	if (!walk_p->lows_p || !walk_p->highs_p || !walk_p->owners_p
+		|| !walk_p->work_p || !walk_p->queued_p || !walk_p->targets_p)
+	{
+		return FALSE;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		walk_p->lows_p[i] = UNREACHED;
+	}
+
+	return TRUE;
+}
+
+static void walk_free(walk_t *walk_p)
+{
+	free(walk_p->lows_p);
+	free(walk_p->highs_p);
+	free(walk_p->owners_p);
+	free(walk_p->work_p);
+	free(walk_p->queued_p);
+	free(walk_p->targets_p);
+}
+
+/*
+ * Tests if a call's target is a function entry.
+ */
+static BOOL walk_call_valid(walk_t *walk_p, int target)
+{
+	return !walk_p->check_calls
+		|| (target >= 0 && target < walk_p->len && walk_p->code_p[target].op == IOP_ENTER);
+}
+
+/*
+ * Walks a function from its entry keeping track of the range of stack
+ * depths each of its instructions can run at.  The range rather than a
+ * single depth is kept because the compiler doesn't balance the stack on
+ * paths that only meet again at a return (which resets it).
+ *
+ * @param limit		Most stack the function may use.
+ * @param max_p		Set to the most stack the function uses (including
+ *					what it writes above the top of the stack for calls).
+ * @param address_p	Set to the instruction that failed.
+ *
+ * @returns NULL if the function is fine or the reason it isn't.
+ */
+static const char *walk_function(walk_t *walk_p, int entry, int limit, int *max_p, int *address_p)
+{
+	int i, j, k, low, high, reach, count, successors[2];
+	decoded_instruction_t *code_p = walk_p->code_p;
+	int *lows_p = walk_p->lows_p, *highs_p = walk_p->highs_p;
+	const char *reason = NULL;
+
+	lows_p[entry] = highs_p[entry] = 0;
+	walk_p->owners_p[entry] = entry;
+	walk_p->work_p[0] = entry;
+	count = 1;
+	*max_p = 0;
+
+	while (count > 0 && !reason)
+	{
+		i = walk_p->work_p[--count];
+		walk_p->queued_p[i] = 0;
+		*address_p = i;
+
+		if (code_p[i].op == IOP_UNKNOWN)
+		{
+			return "unknown instruction";
+		}
+
+		reason = check_operands(&code_p[i]);
+
+		if (reason)
+		{
+			return reason;
+		}
+
+		k = stack_effect(&code_p[i], &reach);
+		low = lows_p[i] + k;
+		high = highs_p[i] + k;
+
+		if (low < 0)
+		{
+			return "stack underflow";
+		}
+
+		if (highs_p[i] + reach > high)
+		{
+			k = highs_p[i] + reach;
+		}
+		else
+		{
+			k = high;
+		}
+
+		/*
+		 * Stopping here also bounds the ranges, so the walk ends.
+		 */
+		if (k > limit)
+		{
+			return "function uses more stack than its entry reserves";
+		}
+
+		if (k > *max_p)
+		{
+			*max_p = k;
+		}
+
+		/*
+		 * Work out where control goes next.
+		 */
+		j = 0;
+
+		switch (code_p[i].op)
+		{
+		case IOP_RET:
+		case IOP_TAC:
+		case IOP_TRM:
+
+			if (code_p[i].op == IOP_TAC && !walk_call_valid(walk_p, code_p[i].a))
+			{
+				return "call to something that isn't a function";
+			}
+
+			break;
+
+		case IOP_JMP:
+
+			successors[j++] = code_p[i].a;
+
+			break;
+
+		case IOP_JPC:
+
+			successors[j++] = code_p[i].a;
+			successors[j++] = i + 1;
+
+			break;
+
+		case IOP_CAL:
+
+			if (!walk_call_valid(walk_p, code_p[i].a))
+			{
+				return "call to something that isn't a function";
+			}
+
+			successors[j++] = i + 1;
+
+			break;
+
+		default:
+
+			successors[j++] = i + 1;
+		}
+
+		while (j > 0)
+		{
+			j--;
+
+			k = successors[j];
+
+			if (k <= 0 || k >= walk_p->len)
+			{
+				return "jump out of the program";
+			}
+
+			if (code_p[k].op == IOP_ENTER)
+			{
+				/*
+				 * Only calls enter a function (the main program jumps
+				 * to its block's entry with nothing on the stack).
+				 */
+				if (low != 0 || high != 0)
+				{
+					return "jump into a function";
+				}
+
+				continue;
+			}
+
+			walk_p->targets_p[k] |= k != i + 1;
+
+			if (lows_p[k] == UNREACHED)
+			{
+				lows_p[k] = low;
+				highs_p[k] = high;
+				walk_p->owners_p[k] = entry;
+			}
+			else if (walk_p->owners_p[k] != entry)
+			{
+				return "code shared by two functions";
+			}
+			else if (low < lows_p[k] || high > highs_p[k])
+			{
+				lows_p[k] = low < lows_p[k] ? low : lows_p[k];
+				highs_p[k] = high > highs_p[k] ? high : highs_p[k];
+			}
+			else
+			{
+				continue;
+			}
+
+			if (!walk_p->queued_p[k])
+			{
+				walk_p->queued_p[k] = 1;
+				walk_p->work_p[count++] = k;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Verifies a decoded instruction stream (before superinstructions are
+ * fused).  Each function is walked from its entry and mustn't use more
+ * stack than the entry reserves.  The main program starts at instruction
+ * 0 with an empty stack.
+ *
+ * @param handles_checked_p	len zeroed flags, set for the MLO and MST
+ *							instructions whose memory handle doesn't need
+ *							checking again.
+ * @param address_p			Set to the instruction that failed.
+ *
+ * @returns NULL if the program is verified or the reason it isn't.
+ */
+const char *verify(decoded_instruction_t *code_p, int len, char *handles_checked_p, int *address_p)
+{
+	int i, entry, max;
+	walk_t walk;
+	const char *reason = NULL;
+
+	*address_p = 0;
+
+	if (!walk_init(&walk, code_p, len, TRUE))
+	{
+		walk_free(&walk);
+
+		return "out of memory";
+	}
+
+	for (entry = 0; entry < len && !reason; entry++)
+	{
+		if (entry != 0 && code_p[entry].op != IOP_ENTER)
+		{
+			continue;
+		}
+
+		/*
+		 * The main program can't use any stack before its block's entry.
+		 */
+		reason = walk_function(&walk, entry, entry == 0 ? 0 : code_p[entry].l, &max, address_p);
+	}
+
+	if (!reason)
+	{
+		/*
+		 * Return addresses are jumped to as well.
+		 */
+		for (i = 0; i < len; i++)
+		{
+			switch (code_p[i].op)
+			{
+			case IOP_CAL: case IOP_CAI: case IOP_CII: case IOP_CAS:
+
+				walk.targets_p[i + 1] = 1;
+			}
+		}
+
+		find_checked_handles(code_p, len, walk.targets_p, handles_checked_p);
+	}
+
+	walk_free(&walk);
+
+	return reason;
+}
+
+/*
+ * Works out how much stack a function compiled on its own uses: the
+ * deepest the stack gets above its frame, counting the parameters and
+ * links it writes for the calls it makes.  code_p starts at the
+ * function's entry and its jumps are relative to it.
+ *
+ * @returns The function's stack use or -1 if it can't be worked out.
+ */
+int stack_use(decoded_instruction_t *code_p, int len)
+{
+	int max, address;
+	walk_t walk;
+	const char *reason = "out of memory";
+
+	if (walk_init(&walk, code_p, len, FALSE))
+	{
+		reason = walk_function(&walk, 0, DECODED_L_MAX, &max, &address);
+	}
+
+	walk_free(&walk);
+
+	return reason ? -1 : max;
+}
@@ -0,0 +1,32 @@
+/*
+ * @file verifier.h
+ *
+ * @description
+ *
+ * Load time verifier for decoded instruction streams.
+ *
+ * Before a program is run the verifier checks that:
+ *
+ *   - every reachable instruction is a known one
+ *   - jumps land inside the program and calls land on a function entry
+ *   - register and level operands are in range
+ *   - the stack depth is the same on every path into an instruction,
+ *     never drops below the frame and never goes past the stack the
+ *     function's entry (ENTER) reserves
+ *
+ * A verified program is run with unchecked variants of the instructions
+ * whose runtime checks the verification makes redundant (see decode).
+ *
+ * The compiler uses the same walk (stack_use) to work out how much stack
+ * each function needs, which its entry then reserves.
+ */
+
+#ifndef __VERIFIER_H
+#define __VERIFIER_H
+
+#include "decoder.h"
+
+const char *verify(decoded_instruction_t *code_p, int len, char *handles_checked_p, int *address_p);
+int stack_use(decoded_instruction_t *code_p, int len);
+
+#endif